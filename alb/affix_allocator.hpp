@@ -77,6 +77,11 @@ namespace alb {
       using prefix = Prefix;
       using sufix = Sufix;
 
+      const Allocator &parent() const noexcept
+      {
+        return allocator_;
+      }
+
       static constexpr size_t prefix_size =
         std::is_same<Prefix, affix_helper::no_affix>::value ? 0 : internal::round_to_alignment(alignment, sizeof(Prefix));
 
@@ -271,6 +276,17 @@ namespace alb {
           return allocator.outer_to_sufix(b);
         }
       };
+
+      /**
+       * This trait defines the allocator that is used to store per allocation
+       * state of type T in front of the blocks of the given Allocator. By default
+       * this is an affix_allocator with T as Prefix. Allocators that keep
+       * their per block data out of band specialize it.
+       * \ingroup group_traits
+       */
+      template <class Allocator, typename T> struct per_allocation_store {
+        using type = affix_allocator<Allocator, T>;
+      };
     }
   }
   using namespace v_100;
@@ -12,6 +12,12 @@
 #include "allocator_base.hpp"
 #include "internal/reallocator.hpp"
 
+#ifdef _MSC_VER
+#include <malloc.h>
+#else
+#include <stdlib.h>
+#endif
+
 namespace alb {
   inline namespace v_100 {
     /**
@@ -25,12 +31,6 @@ namespace alb {
      * \ingroup group_allocators group_shared
      */
     template <unsigned DefaultAlignment = 16> class aligned_mallocator {
-      static constexpr unsigned int alignment = DefaultAlignment;
-
-      static constexpr size_t good_size(size_t n) {
-        return internal::round_to_alignment(alignment, n);
-      }
-
 #ifdef _MSC_VER
       bool aligned_reallocate(block &b, size_t n) noexcept
       {
@@ -43,32 +43,29 @@ namespace alb {
         return false;
       }
 #else
-      // On posix there is no _aligned_realloc so we try a normal realloc
-      // if the result is still aligned we are fine
-      // otherwise we have to do it by hand
+      // On posix there is no _aligned_realloc and ::realloc does not keep the
+      // alignment, so we have to do it by hand
       bool aligned_reallocate(block &b, size_t n) noexcept
       {
-        block reallocatedBlock(::realloc(b.ptr, n));
-        if (reallocatedBlock) {
-          if (static_cast<size_t>(b.ptr) % alignment != 0) {
-            auto newAlignedBlock = allocate(n);
-            if (!newAlignedBlock) {
-              return false;
-            }
-            internal::block_copy(b, newAlignedBlock);
-          }
-          else {
-            b = reallocatedBlock;
-          }
-
-          return true;
+        auto newAlignedBlock = allocate(n);
+        if (!newAlignedBlock) {
+          return false;
         }
-        return false;
+        internal::block_copy(b, newAlignedBlock);
+        deallocate(b);
+        b = newAlignedBlock;
+        return true;
       }
 #endif
 
     public:
+      static constexpr unsigned int alignment = DefaultAlignment;
       static constexpr bool supports_truncated_deallocation = false;
+
+      static constexpr size_t good_size(size_t n) {
+        return internal::round_to_alignment(alignment, n);
+      }
+
       /**
        * Allocates rounded up to the defined alignment the number of bytes.
        * If the system cannot allocate the specified amount of memory then
@@ -79,7 +76,11 @@ namespace alb {
 #ifdef _MSC_VER
         return block{ _aligned_malloc(n, alignment), n };
 #else
-        return block{ (void *)memalign(alignment, n), n };
+        void *result = nullptr;
+        if (::posix_memalign(&result, alignment, n) != 0) {
+          return{};
+        }
+        return block{ result, n };
 #endif
       }
 
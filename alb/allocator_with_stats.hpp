@@ -16,21 +16,26 @@
 #include "allocator_base.hpp"
 #include "affix_allocator.hpp"
 #include "internal/traits.hpp"
-#include "internal/noatomic.hpp"
+#include "internal/call_site_table.hpp"
+#include "internal/compact_allocation_registry.hpp"
+#include "internal/shm_stats.hpp"
+#include "internal/stats_shards.hpp"
+#include "internal/tsc_clock.hpp"
+#include <algorithm>
 #include <atomic>
 #include <chrono>
+#include <cstring>
+#include <utility>
 
 namespace alb {
 
 /// Use this macro if you want to store the caller information
 #define ALLOCATE(A, N) A.allocate(N, __FILE__, __FUNCTION__, __LINE__)
 
-/// Simple way to define member and accessors
+/// Simple way to define accessors to the counters
 #define MEMBER_ACCESSOR(X)                                                     \
-private:                                                                       \
-  statistic_type X##_;                                                         \
 public:                                                                        \
-  size_t X() const noexcept { return X##_.load(); }                            \
+  size_t X() const noexcept { return counters_.load(X##_); }                   \
 
 
 inline namespace v_100 {
@@ -137,8 +142,11 @@ enum StatsOptions : unsigned {
   BytesMoved = 1u << 14,
   /**
   * Measures the sum of extra bytes allocated beyond the bytes requested, i.e.
-  * the http://goo.gl/YoKffF, internal fragmentation). This is the current
-  * effective number of slack bytes, and it goes up and down with time.
+  * the http://goo.gl/YoKffF, internal fragmentation) by all successful calls
+  * of alb::allocator_with_stats::allocate and
+  * alb::allocator_with_stats::reallocate. The requested size of a block is not
+  * known anymore when it is freed, so this number always grows like
+  * bytesAllocated.
   */
   BytesSlack = 1u << 15,
   /**
@@ -182,14 +190,100 @@ enum StatsOptions : unsigned {
   /**
   * Combines all flags above.
   */
-  All = (1u << 22) - 1
+  All = (1u << 22) - 1,
+  /**
+  * The following histograms are not part of All, because each needs a table
+  * with one counter per size class, resp. per thread in shared mode.
+  * Counts the requests of alb::allocator_with_stats::allocate and
+  * alb::allocator_with_stats::reallocate per log2 class of the requested bytes.
+  */
+  SizeHistogram = 1u << 22,
+  /**
+  * Sums up the slack bytes per log2 class of the requested bytes.
+  */
+  SlackHistogram = 1u << 23,
+  /**
+  * Measures every alb::allocator_with_stats_base::latency_sampling_rate-th call
+  * of allocate, deallocate and reallocate with the alb::internal::tsc_clock and
+  * counts the calls per log2 class of the measured ticks.
+  */
+  LatencyHistogram = 1u << 24,
+  /**
+  * Chooses all histograms.
+  */
+  HistogramAll = SizeHistogram | SlackHistogram | LatencyHistogram,
+  /**
+  * Aggregates the live bytes, live count, peak and total bytes per call site,
+  * i.e. per file and line, in a hash table. It can be queried by
+  * alb::allocator_with_stats_base::top_call_sites() in the time of the number
+  * of call sites instead of the number of allocations. It needs CallerFile and
+  * CallerLine, which identify the call site of a block on its deallocation.
+  */
+  CallSites = 1u << 25,
+  /**
+  * Stores the enabled callerXxx information in a compact form. Instead of an
+  * AllocationInfo only a 32 bit index is prepended to each block (rounded up to
+  * the alignment of the allocator). It refers to a 20 byte record with an
+  * interned call site id, the requested size (clamped to 32 bits) and the
+  * allocation time in seconds since the creation of the allocator. So caller
+  * tracking can be used for pools of small objects as well.
+  * At most 65536 allocations are tracked at once, further ones are counted
+  * by alb::allocator_with_stats_base::number_of_untracked_allocations().
+  */
+  CompactCallerInfo = 1u << 26,
+  /**
+  * Places the counters and the high tide in a slot of the POSIX shared memory
+  * segment "/alb.<pid>" of the process, so that they can be watched from the
+  * outside, e.g. with the alb-top tool, without stopping or locking anything.
+  * The slot can be named by alb::allocator_with_stats_base::set_stats_name()
+  * or alb::name_stats_nodes(). There are 64 slots per process, further
+  * allocators keep their counters privately.
+  */
+  SharedMemoryCounters = 1u << 27
+};
+
+/**
+* The operations, for which alb::allocator_with_stats measures the latency.
+*
+* \ingroup group_stats
+*/
+enum class stats_operation : unsigned {
+  allocate,
+  deallocate,
+  reallocate
+};
+
+/**
+* Copy of all counters of an alb::allocator_with_stats at one point in time.
+* See alb::allocator_with_stats_base::snapshot()
+*
+* \ingroup group_stats
+*/
+struct stats_snapshot {
+  size_t num_owns;
+  size_t num_allocate;
+  size_t num_allocate_ok;
+  size_t num_expand;
+  size_t num_expand_ok;
+  size_t num_reallocate;
+  size_t num_reallocate_ok;
+  size_t num_reallocate_in_place;
+  size_t num_deallocate;
+  size_t num_deallocate_all;
+  size_t bytes_allocated;
+  size_t bytes_deallocated;
+  size_t bytes_expanded;
+  size_t bytes_contracted;
+  size_t bytes_moved;
+  size_t bytes_slack;
+  size_t bytes_high_tide;
 };
 
 /**
 * This Allocator serves as a facade in front of the specified allocator to
 * collect statistics during runtime about all operations done on this instance.
-* This is an implementation that is not intended to be used in a shared
-* environment when statistics for file, line or time is enabled
+* In the shared variant all counters are kept per thread, see
+* alb::shared_allocator_with_stats.
 *
 * In case that caller information shall be collected, the Allocator
 * parameter is encapsulated with an ALB::affix_allocator. In this case
@@ -197,7 +291,9 @@ enum StatsOptions : unsigned {
 * caller information is prepended to every allocated block.
 * Be aware that collecting of caller informations adds on top of each
 * allocation
-* sizeof(AllocatorWithStats::AllocationInfo) bytes!
+* sizeof(AllocatorWithStats::AllocationInfo) bytes! With the option
+* CompactCallerInfo only a 32 bit index is prepended and the information is
+* kept in a table of 20 byte records.
 * With a good optimizing compiler only the code for the enabled
 * statistic information is created.
 * \tparam Allocator The allocator that performs all allocations
@@ -219,6 +315,7 @@ public:
     const char *callerFile;
     const char *callerFunction;
     int callerLine;
+    unsigned shard;
 
     /* The comparison does not take the allocation time into account
     * It is a template to be able to compare the AllocationInfo from different
@@ -320,13 +417,62 @@ public:
   static const bool HasPerAllocationState =
       (Flags & (StatsOptions::CallerTime | StatsOptions::CallerFile |
                 StatsOptions::CallerLine)) != 0;
-  
-  static_assert(HasPerAllocationState && !Shared,
-    "Currently it is not supported to collect per file/line/time stats in shared mode!");
 
-  using statistic_type = typename traits::type_switch<std::atomic<size_t>, internal::no_atomic<size_t>, Shared>::type;
+  static const bool HasCompactAllocationState =
+      HasPerAllocationState && (Flags & StatsOptions::CompactCallerInfo) != 0;
+
+  /**
+  * The prefix of each block in case of CompactCallerInfo
+  *
+  * \ingroup group_stats
+  */
+  struct CompactAllocationInfo {
+    uint32_t record;
+  };
+
+  static_assert(!(Flags & StatsOptions::CallSites) ||
+                  ((Flags & StatsOptions::CallerFile) && (Flags & StatsOptions::CallerLine)),
+    "CallSites needs CallerFile and CallerLine!");
+
+private:
+  using info_type = typename traits::type_switch<CompactAllocationInfo, AllocationInfo,
+                                                 HasCompactAllocationState>::type;
 
-// Simplification for defining all members and accessors.
+  /**
+  * Depending on setting that caller information shall be collected
+  * an affix_allocator (or an other per allocation store, see
+  * alb::traits::per_allocation_store) or the specified Allocator directly is used.
+  */
+  using inner_allocator =
+    typename traits::type_switch<typename traits::per_allocation_store<Allocator, info_type>::type,
+                                 Allocator, HasPerAllocationState>::type;
+
+
+  /**
+  * Indices of all counters within the counter storage
+  */
+  enum counter : unsigned {
+    num_owns_,
+    num_allocate_,
+    num_allocate_ok_,
+    num_expand_,
+    num_expand_ok_,
+    num_reallocate_,
+    num_reallocate_ok_,
+    num_reallocate_in_place_,
+    num_deallocate_,
+    num_deallocate_all_,
+    bytes_allocated_,
+    bytes_deallocated_,
+    bytes_expanded_,
+    bytes_contracted_,
+    bytes_moved_,
+    bytes_slack_,
+    number_of_counters
+  };
+
+public:
+// Simplification for defining all accessors.
 #define MEMBER_ACCESSORS                                                       \
   MEMBER_ACCESSOR(num_owns)                                                    \
   MEMBER_ACCESSOR(num_allocate)                                                \
@@ -343,37 +489,104 @@ public:
   MEMBER_ACCESSOR(bytes_expanded)                                              \
   MEMBER_ACCESSOR(bytes_contracted)                                            \
   MEMBER_ACCESSOR(bytes_moved)                                                 \
-  MEMBER_ACCESSOR(bytes_slack)                                                 \
-  MEMBER_ACCESSOR(bytes_high_tide)
+  MEMBER_ACCESSOR(bytes_slack)
 
   MEMBER_ACCESSORS
 
 #undef MEMBER_ACCESSOR
 #undef MEMBER_ACCESSORS
 
+  size_t bytes_high_tide() const noexcept { return high_tide_.load(); }
+
   static constexpr bool supports_truncated_deallocation =
       Allocator::supports_truncated_deallocation;
   static constexpr bool has_per_allocation_state = HasPerAllocationState;
+  static constexpr unsigned flags = Flags;
   static constexpr unsigned alignment = Allocator::alignment;
 
-  allocator_with_stats_base() noexcept : num_owns_(0),
-                                         num_allocate_(0),
-                                         num_allocate_ok_(0),
-                                         num_expand_(0),
-                                         num_expand_ok_(0),
-                                         num_reallocate_(0),
-                                         num_reallocate_ok_(0),
-                                         num_reallocate_in_place_(0),
-                                         num_deallocate_(0),
-                                         num_deallocate_all_(0),
-                                         bytes_allocated_(0),
-                                         bytes_deallocated_(0),
-                                         bytes_expanded_(0),
-                                         bytes_contracted_(0),
-                                         bytes_moved_(0),
-                                         bytes_slack_(0),
-                                         bytes_high_tide_(0),
-                                         root_(nullptr) {}
+  /**
+  * Only every latency_sampling_rate-th operation of a thread is measured
+  */
+  static constexpr unsigned latency_sampling_rate = 64;
+
+  allocator_with_stats_base() noexcept {}
+
+  /**
+  * Returns the good size of the underlying Allocator.
+  * This is only available if the Allocator implements good_size()
+  */
+  template <typename U = inner_allocator>
+  auto good_size(size_t n) const noexcept -> decltype(std::declval<const U &>().good_size(n)) {
+    return allocator_.good_size(n);
+  }
+
+  /**
+  * Sets the boundaries of the underlying Allocator, e.g. of a alb::freelist
+  * within a alb::bucketizer. This is only available if the Allocator implements
+  * it and no per allocation information is prepended.
+  */
+  template <typename U = inner_allocator>
+  auto set_min_max(size_t minSize, size_t maxSize) noexcept
+    -> decltype(std::declval<U &>().set_min_max(minSize, maxSize)) {
+    return allocator_.set_min_max(minSize, maxSize);
+  }
+
+  template <typename U = inner_allocator>
+  auto min_size() const noexcept -> decltype(std::declval<const U &>().min_size()) {
+    return allocator_.min_size();
+  }
+
+  template <typename U = inner_allocator>
+  auto max_size() const noexcept -> decltype(std::declval<const U &>().max_size()) {
+    return allocator_.max_size();
+  }
+
+  /**
+  * Sets the name under which the counters appear in the shared memory
+  * segment. It is truncated to 63 characters. This has only an effect with the
+  * option SharedMemoryCounters. (The name is no part of the state of the
+  * allocator, so this is possible on a const allocator as well.)
+  */
+  void set_stats_name(const char *name) const noexcept {
+    internal::set_counters_name(counters_, name);
+  }
+
+  /**
+  * Returns the underlying Allocator, e.g. to visit the statistic of composed
+  * allocators, see alb::for_each_stats_node. If per allocation information is
+  * collected, then this is the store of this information, e.g. an
+  * alb::affix_allocator over the Allocator.
+  */
+  const inner_allocator &allocator() const noexcept {
+    return allocator_;
+  }
+
+  /**
+  * Returns the number of requests with a size of [2^sizeClass, 2^(sizeClass+1))
+  * bytes. This is only collected with the option SizeHistogram.
+  */
+  size_t size_histogram(unsigned sizeClass) const noexcept {
+    return size_histogram_.load(sizeClass);
+  }
+
+  /**
+  * Returns the slack bytes of all requests with a size of
+  * [2^sizeClass, 2^(sizeClass+1)) bytes. This is only collected with the option
+  * SlackHistogram.
+  */
+  size_t slack_histogram(unsigned sizeClass) const noexcept {
+    return slack_histogram_.load(sizeClass);
+  }
+
+  /**
+  * Returns the number of sampled calls of the given operation that took
+  * [2^tickClass, 2^(tickClass+1)) ticks of the alb::internal::tsc_clock.
+  * This is only collected with the option LatencyHistogram.
+  */
+  size_t latency_histogram(stats_operation op, unsigned tickClass) const noexcept {
+    return latency_histogram_.load(static_cast<unsigned>(op) * internal::number_of_size_classes +
+                                   tickClass);
+  }
 
   /**
   * The number of specified bytes gets allocated by the underlying Allocator.
@@ -390,36 +603,20 @@ public:
   block allocate(size_t n, const char *file = nullptr,
                  const char *function = nullptr, int line = 0) noexcept {
 
+    const auto start = start_measurement();
     auto result = allocator_.allocate(n);
+    stop_measurement(stats_operation::allocate, start);
     up(StatsOptions::NumAllocate, num_allocate_);
     upOK(StatsOptions::NumAllocateOK, num_allocate_ok_, n > 0 && result);
     add(StatsOptions::BytesAllocated, bytes_allocated_, result.length);
-    update_high_tide();
+    update_high_tide(result.length);
+    if (result) {
+      record_request(n, result.length);
+    }
 
     if (has_per_allocation_state) {
       if (result) {
-        AllocationInfo *stat =
-            traits::affix_extractor<decltype(allocator_),
-                                    AllocationInfo>::prefix(allocator_, result);
-
-        set(StatsOptions::CallerSize, stat->callerSize, n);
-        set(StatsOptions::CallerFile, stat->callerFile, file);
-        set(StatsOptions::CallerFunction, stat->callerFunction, function);
-        set(StatsOptions::CallerLine, stat->callerLine, line);
-        set(StatsOptions::CallerTime, stat->callerTime,
-            std::chrono::system_clock::now());
-
-        // push into caller info stack
-        if (root_) {
-          root_->previous = stat;
-          stat->next = root_;
-          stat->previous = nullptr;
-          root_ = stat;
-        } else { // create the new stack
-          stat->previous = nullptr;
-          stat->next = nullptr;
-          root_ = stat;
-        }
+        track(info_of(result), n, result.length, file, function, line);
       }
     }
     return result;
@@ -434,87 +631,40 @@ public:
   void deallocate(block &b) noexcept {
     up(StatsOptions::NumDeallocate, num_deallocate_);
     add(StatsOptions::BytesDeallocated, bytes_deallocated_, b.length);
+    update_high_tide(-static_cast<ptrdiff_t>(b.length));
 
     if (has_per_allocation_state) {
       if (b) {
-        auto stat =
-            traits::affix_extractor<decltype(allocator_),
-                                    AllocationInfo>::prefix(allocator_, b);
-        if (stat->previous) {
-          stat->previous->next = stat->next;
-        }
-        if (stat->next) {
-          stat->next->previous = stat->previous;
-        }
-        if (stat == root_) {
-          root_ = stat->previous;
-        }
+        untrack(info_of(b), b.length);
       }
     }
+    const auto start = start_measurement();
     allocator_.deallocate(b);
+    stop_measurement(stats_operation::deallocate, start);
   }
 
   /**
   * The specified block gets reallocated by the underlaying Allocator
   * Depending on the specified Flag, the reallocating statistic information
   * is stored.
+  * In shared mode the list of the allocating thread is locked during the
+  * reallocation, because the underlying allocator moves the per allocation
+  * information.
   * \param b The block that should be reallocated.
   * \param n The new size. If zero, then a deallocation takes place
   * \return True, if the operation was successful
   */
   bool reallocate(block &b, size_t n) noexcept {
-    auto originalBlock = b;
-    auto wasRootBlock(false);
     if (has_per_allocation_state) {
       if (b) {
-        wasRootBlock =
-            root_ ==
-            traits::affix_extractor<decltype(allocator_),
-                                    AllocationInfo>::prefix(allocator_, b);
-      }
-    }
-    up(StatsOptions::NumReallocate, num_reallocate_);
-
-    if (!allocator_.reallocate(b, n)) {
-      return false;
-    }
-    up(StatsOptions::NumReallocateOK, num_reallocate_ok_);
-    std::make_signed<size_t>::type delta = b.length - originalBlock.length;
-    if (b.ptr == originalBlock.ptr) {
-      up(StatsOptions::NumReallocateInPlace, num_reallocate_in_place_);
-      if (delta > 0) {
-        add(StatsOptions::BytesAllocated, bytes_allocated_, delta);
-        add(StatsOptions::BytesExpanded, bytes_expanded_, delta);
-      } else {
-        add(StatsOptions::BytesDeallocated, bytes_deallocated_, -delta);
-        add(StatsOptions::BytesContracted, bytes_contracted_, -delta);
-      }
-    } // was moved to a new location
-    else {
-      add(StatsOptions::BytesAllocated, bytes_allocated_, b.length);
-      add(StatsOptions::BytesMoved, bytes_moved_, originalBlock.length);
-      add(StatsOptions::BytesDeallocated, bytes_deallocated_,
-          originalBlock.length);
-
-      if (has_per_allocation_state) {
-        if (b) {
-          auto stat =
-              traits::affix_extractor<decltype(allocator_),
-                                      AllocationInfo>::prefix(allocator_, b);
-          if (stat->next) {
-            stat->next->previous = stat;
-          }
-          if (stat->previous) {
-            stat->previous->next = stat;
-          }
-          if (wasRootBlock) {
-            root_ = stat;
-          }
+        if (n == 0) {
+          untrack(info_of(b), b.length);
+          return reallocate_and_count(b, n);
         }
+        return reallocate_tracked(info_of(b), b, n);
       }
     }
-    update_high_tide();
-    return true;
+    return reallocate_and_count(b, n);
   }
 
   /**
@@ -551,51 +701,303 @@ public:
       up(StatsOptions::NumExpandOK, num_expand_ok_);
       add(StatsOptions::BytesExpanded, bytes_expanded_, b.length - oldLength);
       add(StatsOptions::BytesAllocated, bytes_allocated_, b.length - oldLength);
-      update_high_tide();
-      // if (b && has_per_allocation_state) {
-      //   auto stat = traits::AffixExtractor<
-      //       decltype(allocator_), AllocationInfo>::prefix(allocator_, b);
-      // }
+      update_high_tide(b.length - oldLength);
+      if (has_per_allocation_state && oldLength > 0) {
+        resized(info_of(b), oldLength, b.length);
+      }
     }
     return result;
   }
 
+  /**
+  * Frees all memory of the underlying Allocator. This method is only available
+  * if the Allocator implements it and no per allocation information is
+  * collected, because this would still refer to the freed blocks.
+  */
+  template <typename U = inner_allocator>
+  typename std::enable_if<traits::has_deallocate_all<U>::value && !HasPerAllocationState,
+                          void>::type
+  deallocate_all() noexcept {
+    up(StatsOptions::NumDeallocateAll, num_deallocate_all_);
+    allocator_.deallocate_all();
+  }
+
+  /**
+  * Calls f(const call_site_stats&) for each call site. This is only collected
+  * with the option CallSites.
+  */
+  template <typename Function>
+  void for_each_call_site(Function &&f) const {
+    call_sites_.for_each(std::forward<Function>(f));
+  }
+
+  /**
+  * Copies the k call sites with the most live bytes, sorted descending, into
+  * result. It takes O(number of call sites * k) and does not lock anything.
+  * This is only collected with the option CallSites.
+  * \param result Array of at least k elements
+  * \param k The maximum number of call sites that are returned
+  * \return The number of returned call sites
+  */
+  size_t top_call_sites(call_site_stats *result, size_t k) const {
+    size_t found = 0;
+    call_sites_.for_each([&](const call_site_stats &s) {
+      auto i = found < k ? found++ : k;
+      while (i > 0 && result[i - 1].live_bytes < s.live_bytes) {
+        if (i < k) {
+          result[i] = result[i - 1];
+        }
+        --i;
+      }
+      if (i < k) {
+        result[i] = s;
+      }
+    });
+    return found;
+  }
+
+  /**
+  * Returns the number of call sites that could not be tracked, because the
+  * table of call sites was full.
+  */
+  size_t number_of_dropped_call_sites() const noexcept {
+    return call_sites_.number_of_dropped_sites();
+  }
+
+  /**
+  * Returns all statistic information at once. The counters of the
+  * deallocating operations are read before the ones of the allocating
+  * operations, so that in shared mode e.g. bytes_deallocated never exceeds
+  * bytes_allocated, even if other threads are working in parallel.
+  */
+  stats_snapshot snapshot() const noexcept {
+    stats_snapshot result;
+    result.num_deallocate_all = num_deallocate_all();
+    result.num_deallocate = num_deallocate();
+    result.bytes_deallocated = bytes_deallocated();
+    result.bytes_contracted = bytes_contracted();
+    result.bytes_moved = bytes_moved();
+    result.num_reallocate_in_place = num_reallocate_in_place();
+    result.num_reallocate_ok = num_reallocate_ok();
+    result.num_reallocate = num_reallocate();
+    result.num_expand_ok = num_expand_ok();
+    result.num_expand = num_expand();
+    result.bytes_expanded = bytes_expanded();
+    result.bytes_slack = bytes_slack();
+    result.bytes_high_tide = bytes_high_tide();
+    result.bytes_allocated = bytes_allocated();
+    result.num_allocate_ok = num_allocate_ok();
+    result.num_allocate = num_allocate();
+    result.num_owns = num_owns();
+    return result;
+  }
+
   /**
   * Accessor to all currently outstanding memory allocations. The ownership
   * of all elements belong to this class.
+  * This is only available in the not shared mode without CompactCallerInfo.
+  * Use for_each_allocation() otherwise.
   * \return A container with all AllocationInfos
   */
-  Allocations allocations() const noexcept { return Allocations(root_); }
+  template <bool S = Shared, bool C = HasCompactAllocationState>
+  typename std::enable_if<!S && !C, Allocations>::type allocations() const noexcept {
+    return Allocations(registry_.root());
+  }
+
+  /**
+  * Calls f with each AllocationInfo of all currently outstanding memory
+  * allocations. In shared mode the allocations of a thread cannot be freed
+  * while they are visited, so f should not take long.
+  * With CompactCallerInfo f gets a temporary AllocationInfo that is filled
+  * from the compact record. Its list pointers are not set.
+  * \param f A callable with the signature void(const AllocationInfo&)
+  */
+  template <typename Function>
+  void for_each_allocation(Function &&f) const {
+    if (HasCompactAllocationState) {
+      records_.for_each([this, &f](const auto &r) {
+        AllocationInfo info{};
+        const char *file, *function;
+        int line;
+        call_sites_.site(r.site, file, function, line);
+        set(StatsOptions::CallerSize, info.callerSize, static_cast<size_t>(r.size));
+        set(StatsOptions::CallerFile, info.callerFile, file);
+        set(StatsOptions::CallerFunction, info.callerFunction, function);
+        set(StatsOptions::CallerLine, info.callerLine, line);
+        set(StatsOptions::CallerTime, info.callerTime,
+            start_ + std::chrono::seconds(r.time));
+        f(static_cast<const AllocationInfo &>(info));
+      });
+    }
+    else {
+      registry_.for_each(std::forward<Function>(f));
+    }
+  }
+
+  /**
+  * Returns the number of allocations, whose caller information could not be
+  * stored, because all compact records were in use. This is only collected with
+  * the option CompactCallerInfo.
+  */
+  size_t number_of_untracked_allocations() const noexcept {
+    return records_.number_of_dropped_records();
+  }
 
 private:
+  info_type *info_of(const block &b) noexcept {
+    return traits::affix_extractor<decltype(allocator_), info_type>::prefix(allocator_, b);
+  }
+
+  void track(AllocationInfo *stat, size_t n, size_t length, const char *file,
+             const char *function, int line) noexcept {
+    set(StatsOptions::CallerSize, stat->callerSize, n);
+    set(StatsOptions::CallerFile, stat->callerFile, file);
+    set(StatsOptions::CallerFunction, stat->callerFunction, function);
+    set(StatsOptions::CallerLine, stat->callerLine, line);
+    set(StatsOptions::CallerTime, stat->callerTime,
+        std::chrono::system_clock::now());
+
+    // push into caller info stack
+    registry_.insert(stat);
+    if (Flags & StatsOptions::CallSites) {
+      call_sites_.allocated(call_sites_.intern(file, function, line), length);
+    }
+  }
+
+  void track(CompactAllocationInfo *stat, size_t n, size_t length, const char *file,
+             const char *function, int line) noexcept {
+    const auto site = call_sites_.intern((Flags & StatsOptions::CallerFile) ? file : "",
+                                         (Flags & StatsOptions::CallerFunction) ? function : nullptr,
+                                         (Flags & StatsOptions::CallerLine) ? line : 0);
+    uint32_t time = 0;
+    if (Flags & StatsOptions::CallerTime) {
+      time = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::seconds>(
+                                     std::chrono::system_clock::now() - start_).count());
+    }
+    const auto size = (Flags & StatsOptions::CallerSize) ?
+      static_cast<uint32_t>(std::min<size_t>(n, ~uint32_t(0))) : 0;
+    stat->record = records_.insert(site, size, time);
+    if (Flags & StatsOptions::CallSites) {
+      call_sites_.allocated(site, length);
+    }
+  }
+
+  void untrack(AllocationInfo *stat, size_t length) noexcept {
+    call_sites_.deallocated(stat->callerFile, stat->callerLine, length);
+    registry_.erase(stat);
+  }
+
+  void untrack(CompactAllocationInfo *stat, size_t length) noexcept {
+    if (stat->record != records_.invalid_index) {
+      if (Flags & StatsOptions::CallSites) {
+        call_sites_.deallocated(records_[stat->record].site, length);
+      }
+      records_.erase(stat->record);
+    }
+  }
+
+  void resized(AllocationInfo *stat, size_t oldLength, size_t newLength) noexcept {
+    call_sites_.resized(stat->callerFile, stat->callerLine, oldLength, newLength);
+  }
+
+  void resized(CompactAllocationInfo *stat, size_t oldLength, size_t newLength) noexcept {
+    if ((Flags & StatsOptions::CallSites) && stat->record != records_.invalid_index) {
+      call_sites_.resized(records_[stat->record].site, oldLength, newLength);
+    }
+  }
+
   /**
-  * Increases the given value by one if the passed option is set
+  * In shared mode the list of the allocating thread is locked during the
+  * reallocation, because the underlying allocator moves the AllocationInfo.
   */
-  template <typename T> 
-  inline void up(StatsOptions option, T &value) const noexcept {
+  bool reallocate_tracked(AllocationInfo *stat, block &b, size_t n) noexcept {
+    const auto file = stat->callerFile;
+    const auto line = stat->callerLine;
+    const auto originalBlock = b;
+    auto lock = registry_.lock(stat);
+    if (!reallocate_and_count(b, n)) {
+      return false;
+    }
+    call_sites_.resized(file, line, originalBlock.length, b.length);
+    if (b.ptr != originalBlock.ptr) {
+      registry_.replace(stat, info_of(b));
+    }
+    return true;
+  }
+
+  /**
+  * The compact records stay in their table, so only the moved index has to be
+  * followed.
+  */
+  bool reallocate_tracked(CompactAllocationInfo *, block &b, size_t n) noexcept {
+    const auto oldLength = b.length;
+    if (!reallocate_and_count(b, n)) {
+      return false;
+    }
+    resized(info_of(b), oldLength, b.length);
+    return true;
+  }
+
+  bool reallocate_and_count(block &b, size_t n) noexcept {
+    auto originalBlock = b;
+    up(StatsOptions::NumReallocate, num_reallocate_);
+
+    const auto start = start_measurement();
+    const auto reallocated = allocator_.reallocate(b, n);
+    stop_measurement(stats_operation::reallocate, start);
+    if (!reallocated) {
+      return false;
+    }
+    up(StatsOptions::NumReallocateOK, num_reallocate_ok_);
+    if (b) {
+      record_request(n, b.length);
+    }
+    std::make_signed<size_t>::type delta = b.length - originalBlock.length;
+    if (b.ptr == originalBlock.ptr) {
+      up(StatsOptions::NumReallocateInPlace, num_reallocate_in_place_);
+      if (delta > 0) {
+        add(StatsOptions::BytesAllocated, bytes_allocated_, delta);
+        add(StatsOptions::BytesExpanded, bytes_expanded_, delta);
+      } else {
+        add(StatsOptions::BytesDeallocated, bytes_deallocated_, -delta);
+        add(StatsOptions::BytesContracted, bytes_contracted_, -delta);
+      }
+    } // was moved to a new location
+    else {
+      add(StatsOptions::BytesAllocated, bytes_allocated_, b.length);
+      add(StatsOptions::BytesMoved, bytes_moved_, originalBlock.length);
+      add(StatsOptions::BytesDeallocated, bytes_deallocated_,
+          originalBlock.length);
+    }
+    update_high_tide(delta);
+    return true;
+  }
+
+  /**
+  * Increases the given counter by one if the passed option is set
+  */
+  inline void up(StatsOptions option, counter c) const noexcept {
     if (Flags & option)
-      ++value;
+      counters_.add(c, 1);
   }
 
   /**
-  * Increases the given value by one if the passed option is set and the bool
+  * Increases the given counter by one if the passed option is set and the bool
   * is set to true
   */
-  template <typename T>
-  inline void upOK(StatsOptions option, T &value, bool ok) const noexcept {
+  inline void upOK(StatsOptions option, counter c, bool ok) const noexcept {
     if (Flags & option && ok)
-      ++value;
+      counters_.add(c, 1);
   }
 
   /**
-  * Adds the given delta value to the passed value, if the given option is
+  * Adds the given delta value to the passed counter, if the given option is
   * set. Delta can be negative
   */
-  template <typename T>
-  void inline add(StatsOptions option, T &value,
-                  typename std::make_signed<typename T::type>::type delta) const noexcept {
+  void inline add(StatsOptions option, counter c,
+                  std::make_signed<size_t>::type delta) const noexcept {
     if (Flags & option)
-      value += delta;
+      counters_.add(c, static_cast<size_t>(delta));
   }
 
   /**
@@ -608,26 +1010,80 @@ private:
   }
 
   /**
-  * If the high tide information shall be collected, it is recalculated
+  * If the high tide information shall be collected, the currently allocated
+  * bytes are changed by delta and the maximum is recalculated
   */
-  void update_high_tide() noexcept {
+  void update_high_tide(std::make_signed<size_t>::type delta) noexcept {
     if (Flags & StatsOptions::BytesHighTide) {
-      const size_t currentlyAllocated = bytes_allocated_ - bytes_deallocated_;
-      if (bytes_high_tide_ < currentlyAllocated) {
-        bytes_high_tide_ = currentlyAllocated;
-      }
+      high_tide_.add(static_cast<size_t>(delta));
+      internal::publish_high_tide(counters_, high_tide_.load());
     }
   }
 
   /**
-  * Depending on setting that caller information shall be collected
-  * an affix_allocator or the specified Allocator directly is used.
+  * Counts the request, and its slack, in the histograms
   */
-  typename traits::type_switch<affix_allocator<Allocator, AllocationInfo>,
-                               Allocator,
-                               HasPerAllocationState>::type allocator_;
+  void record_request(size_t n, size_t length) noexcept {
+    const auto slack = length > n ? length - n : 0;
+    add(StatsOptions::BytesSlack, bytes_slack_, slack);
+    if (Flags & (StatsOptions::SizeHistogram | StatsOptions::SlackHistogram)) {
+      const auto sizeClass = internal::size_class(n);
+      size_histogram_.add(sizeClass, 1);
+      slack_histogram_.add(sizeClass, slack);
+    }
+  }
 
-  AllocationInfo *root_;
+  /**
+  * Returns the current ticks, if this call shall be measured, otherwise zero
+  */
+  internal::tsc_clock::ticks start_measurement() const noexcept {
+    if ((Flags & StatsOptions::LatencyHistogram) &&
+        internal::sample_this_call<latency_sampling_rate>()) {
+      return internal::tsc_clock::now();
+    }
+    return 0;
+  }
+
+  void stop_measurement(stats_operation op, internal::tsc_clock::ticks start) noexcept {
+    if ((Flags & StatsOptions::LatencyHistogram) && start != 0) {
+      const auto duration = internal::tsc_clock::now() - start;
+      latency_histogram_.add(static_cast<unsigned>(op) * internal::number_of_size_classes +
+                               internal::size_class(duration), 1);
+    }
+  }
+
+  template <unsigned Option, size_t N>
+  using histogram_type =
+    typename traits::type_switch<internal::stats_counters<Shared, N>, internal::no_counters,
+                                 (Flags & Option) != 0>::type;
+
+  mutable typename traits::type_switch<internal::shm_stats_counters<Shared, number_of_counters>,
+                                       internal::stats_counters<Shared, number_of_counters>,
+                                       (Flags & StatsOptions::SharedMemoryCounters) != 0>::type
+    counters_;
+  internal::high_tide<Shared> high_tide_;
+  histogram_type<StatsOptions::SizeHistogram, internal::number_of_size_classes> size_histogram_;
+  histogram_type<StatsOptions::SlackHistogram, internal::number_of_size_classes> slack_histogram_;
+  histogram_type<StatsOptions::LatencyHistogram, 3 * internal::number_of_size_classes>
+    latency_histogram_;
+  typename traits::type_switch<internal::call_site_table<Shared>, internal::no_call_site_table,
+                               (Flags & StatsOptions::CallSites) != 0 ||
+                                 HasCompactAllocationState>::type call_sites_;
+
+  inner_allocator allocator_;
+
+  internal::allocation_registry<Shared, AllocationInfo> registry_;
+
+  struct no_records {
+    static constexpr uint32_t invalid_index = 0;
+    size_t number_of_dropped_records() const noexcept { return 0; }
+    template <typename Function> void for_each(Function &&) const {}
+  };
+
+  typename traits::type_switch<internal::compact_allocation_registry<Shared>, no_records,
+                               HasCompactAllocationState>::type records_;
+  std::chrono::time_point<std::chrono::system_clock> start_ =
+    std::chrono::system_clock::now();
 };
 
 
@@ -638,13 +1094,20 @@ public:
   allocator_with_stats() noexcept {}
 };
 
-// template <class Allocator, unsigned Flags = alb::StatsOptions::All>
-// class shared_allocator_with_stats : public allocator_with_stats_base<true, Allocator, Flags>
-// {
-// public:
-//  shared_allocator_with_stats() noexcept {}
-//};
+/**
+* Thread safe variant of the alb::allocator_with_stats. Each thread updates its
+* own shard of counters, so the statistics can be enabled in production without
+* that all threads contend on the same cache lines. (Only BytesHighTide needs a
+* global counter.) Per allocation information is kept in per thread lists.
+* \ingroup group_allocators group_stats group_shared
+*/
+template <class Allocator, unsigned Flags = alb::StatsOptions::All>
+class shared_allocator_with_stats : public allocator_with_stats_base<true, Allocator, Flags>
+{
+public:
+  shared_allocator_with_stats() noexcept {}
+};
 
 }
 using namespace v_100;
-}
\ No newline at end of file
+}
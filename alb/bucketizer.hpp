@@ -57,8 +57,14 @@ namespace alb {
         }
       }
 
+      /**
+       * Returns the upper edge of the bucket, that is responsible for n bytes.
+       * Sizes outside of [MinSize, MaxSize] are moved to the nearest bucket.
+       */
       static constexpr size_t good_size(size_t n) noexcept {
-        return (number_of_buckets - (max_size - n)/step_size + 1) * step_size;
+        return n < min_size ? min_size + step_size - 1
+          : n > max_size ? max_size
+          : min_size + ((n - min_size) / step_size + 1) * step_size - 1;
       }
 
       /**
@@ -0,0 +1,319 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "allocator_base.hpp"
+#include "internal/heap_helpers.hpp"
+#include "internal/reallocator.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <iterator>
+
+namespace alb {
+  inline namespace v_100 {
+
+    /**
+     * The buddy allocator manages a pre-allocated area of MinBlock << MaxOrder
+     * bytes. A block of order k has MinBlock << k bytes and starts at a
+     * multiple of its size within the area. An allocation takes the smallest
+     * free block that fits and splits it in halves, its buddies, down to the
+     * needed order. A freed block is merged with its buddy as long as this is
+     * free, too. So allocation and deallocation take O(MaxOrder) steps,
+     * independent of the number of blocks.
+     * The free blocks of each order are kept in intrusive lists within the
+     * blocks themselves, and one byte per MinBlock tells, if a free block
+     * starts there and of which order it is.
+     * expand() absorbs the free buddies of a block, and a reallocation to a
+     * smaller size splits off the unneeded halves, both in place.
+     * \tparam Allocator The allocator that provides the area
+     * \tparam MinBlock The size of the smallest block, a power of two
+     * \tparam MaxOrder The order of the whole area
+     *
+     * \ingroup group_allocators
+     */
+    template <class Allocator, size_t MinBlock, unsigned MaxOrder>
+    class buddy_allocator {
+      struct node {
+        node *prev;
+        node *next;
+      };
+
+      static_assert(MinBlock > 0 && (MinBlock & (MinBlock - 1)) == 0,
+                    "The MinBlock must be a power of two!");
+      static_assert(MinBlock >= sizeof(node), "The MinBlock is too small for the free list!");
+      static_assert(MaxOrder < 64, "The MaxOrder must be less than 64!");
+
+      static constexpr uint8_t not_free = 0xff;
+
+      Allocator allocator_;
+      block buffer_;
+      block controlBuffer_;
+      // The order of the free block, that starts at each MinBlock, or not_free
+      uint8_t *control_;
+      node *lists_[MaxOrder + 1];
+      // A set bit marks a non empty list
+      uint64_t occupied_;
+
+      buddy_allocator(const buddy_allocator &) = delete;
+      buddy_allocator &operator=(const buddy_allocator &) = delete;
+
+      static unsigned order_of(size_t n) noexcept
+      {
+        if (n <= MinBlock) {
+          return 0;
+        }
+        return helpers::highest_set_bit((n - 1) / MinBlock) + 1;
+      }
+
+      size_t index_of(const void *p) const noexcept
+      {
+        return static_cast<size_t>(static_cast<const char *>(p) -
+                                   static_cast<const char *>(buffer_.ptr)) / MinBlock;
+      }
+
+      node *node_at(size_t index) const noexcept
+      {
+        return reinterpret_cast<node *>(static_cast<char *>(buffer_.ptr) + index * MinBlock);
+      }
+
+      void push(size_t index, unsigned order) noexcept
+      {
+        auto n = node_at(index);
+        n->prev = nullptr;
+        n->next = lists_[order];
+        if (n->next) {
+          n->next->prev = n;
+        }
+        lists_[order] = n;
+        occupied_ |= uint64_t(1) << order;
+        control_[index] = static_cast<uint8_t>(order);
+      }
+
+      void unlink(size_t index, unsigned order) noexcept
+      {
+        auto n = node_at(index);
+        if (n->prev) {
+          n->prev->next = n->next;
+        }
+        else {
+          lists_[order] = n->next;
+          if (!n->next) {
+            occupied_ &= ~(uint64_t(1) << order);
+          }
+        }
+        if (n->next) {
+          n->next->prev = n->prev;
+        }
+        control_[index] = not_free;
+      }
+
+      // Returns the upper halves from order down to newOrder to the free lists
+      void split(size_t index, unsigned order, unsigned newOrder) noexcept
+      {
+        while (order > newOrder) {
+          --order;
+          push(index + (size_t(1) << order), order);
+        }
+      }
+
+      void shrink() noexcept
+      {
+        allocator_.deallocate(controlBuffer_);
+        allocator_.deallocate(buffer_);
+        control_ = nullptr;
+      }
+
+    public:
+      using allocator = Allocator;
+
+      static constexpr size_t min_block = MinBlock;
+      static constexpr unsigned max_order = MaxOrder;
+      static constexpr size_t max_block = MinBlock << MaxOrder;
+      static constexpr bool supports_truncated_deallocation = false;
+      static constexpr unsigned alignment = Allocator::alignment;
+
+      buddy_allocator() noexcept
+        : control_(nullptr)
+      {
+        controlBuffer_ = allocator_.allocate(size_t(1) << MaxOrder);
+        buffer_ = allocator_.allocate(max_block);
+        if (!controlBuffer_ || !buffer_) {
+          shrink();
+        }
+        else {
+          control_ = static_cast<uint8_t *>(controlBuffer_.ptr);
+        }
+        deallocate_all();
+      }
+
+      ~buddy_allocator()
+      {
+        shrink();
+      }
+
+      /**
+       * Returns the length of the block that an allocation of n bytes results in
+       */
+      static size_t good_size(size_t n) noexcept
+      {
+        return MinBlock << order_of(n);
+      }
+
+      /**
+       * Returns the complete memory area that is managed by this allocator. All
+       * returned blocks are located within it.
+       */
+      block memory_region() const noexcept
+      {
+        return buffer_;
+      }
+
+      /**
+       * Returns the number of free blocks of the given order
+       */
+      size_t number_of_free_blocks(unsigned order) const noexcept
+      {
+        size_t result = 0;
+        for (auto n = order <= MaxOrder ? lists_[order] : nullptr; n; n = n->next) {
+          ++result;
+        }
+        return result;
+      }
+
+      bool owns(const block &b) const noexcept
+      {
+        return b && buffer_.ptr <= b.ptr &&
+               b.ptr < (static_cast<char *>(buffer_.ptr) + buffer_.length);
+      }
+
+      /**
+       * Returns a block of the smallest order, that fits n bytes.
+       * \param n The requested size
+       * \return The block of MinBlock << order bytes or an empty block
+       */
+      block allocate(size_t n) noexcept
+      {
+        if (n == 0 || n > max_block) {
+          return {};
+        }
+        const auto order = order_of(n);
+        const auto candidates = occupied_ & ~((uint64_t(1) << order) - 1);
+        if (candidates == 0) {
+          return {};
+        }
+        const auto freeOrder = helpers::lowest_set_bit(candidates);
+        const auto index = index_of(lists_[freeOrder]);
+        unlink(index, freeOrder);
+        split(index, freeOrder, order);
+        return block(node_at(index), MinBlock << order);
+      }
+
+      /**
+       * Frees the block and merges it with its free buddies
+       * \param b The block to free
+       */
+      void deallocate(block &b) noexcept
+      {
+        if (!owns(b)) {
+          return;
+        }
+        auto index = index_of(b.ptr);
+        auto order = order_of(b.length);
+        assert((index & ((size_t(1) << order) - 1)) == 0);
+        while (order < MaxOrder) {
+          const auto buddy = index ^ (size_t(1) << order);
+          if (control_[buddy] != order) {
+            break;
+          }
+          unlink(buddy, order);
+          index = std::min(index, buddy);
+          ++order;
+        }
+        push(index, order);
+        b.reset();
+      }
+
+      /**
+       * Grows the block in place to the order, that fits b.length + delta
+       * bytes, by absorbing its upper buddies. This is only possible, if the
+       * block is the lower buddy on each level and all upper buddies are free.
+       * \param b The block to expand
+       * \param delta The number of additional bytes
+       * \return True, if the block was expanded
+       */
+      bool expand(block &b, size_t delta) noexcept
+      {
+        if (delta == 0) {
+          return true;
+        }
+        if (b.length + delta > max_block) {
+          return false;
+        }
+        const auto index = index_of(b.ptr);
+        const auto order = order_of(b.length);
+        const auto newOrder = order_of(b.length + delta);
+        for (auto o = order; o < newOrder; ++o) {
+          if ((index & (size_t(1) << o)) != 0 || control_[index + (size_t(1) << o)] != o) {
+            return false;
+          }
+        }
+        for (auto o = order; o < newOrder; ++o) {
+          unlink(index + (size_t(1) << o), o);
+        }
+        b.length = MinBlock << newOrder;
+        return true;
+      }
+
+      /**
+       * Shrinks the block in place by splitting off its unneeded upper halves.
+       * A growing is done by expand() if possible, otherwise by a copy.
+       */
+      bool reallocate(block &b, size_t n) noexcept
+      {
+        if (internal::is_reallocation_handled_default(*this, b, n)) {
+          return true;
+        }
+        const auto order = order_of(b.length);
+        const auto newOrder = order_of(n);
+        if (newOrder <= order) {
+          split(index_of(b.ptr), order, newOrder);
+          b.length = MinBlock << newOrder;
+          return true;
+        }
+        return internal::reallocate_with_copy(*this, *this, b, n);
+      }
+
+      /**
+       * Frees all blocks at once. Beware of dangling pointers!
+       */
+      void deallocate_all() noexcept
+      {
+        std::fill(std::begin(lists_), std::end(lists_), nullptr);
+        occupied_ = 0;
+        if (control_) {
+          std::fill(control_, control_ + (size_t(1) << MaxOrder), not_free);
+          push(0, MaxOrder);
+        }
+      }
+    };
+
+    template <class Allocator, size_t MinBlock, unsigned MaxOrder>
+    constexpr size_t buddy_allocator<Allocator, MinBlock, MaxOrder>::min_block;
+
+    template <class Allocator, size_t MinBlock, unsigned MaxOrder>
+    constexpr unsigned buddy_allocator<Allocator, MinBlock, MaxOrder>::max_order;
+
+    template <class Allocator, size_t MinBlock, unsigned MaxOrder>
+    constexpr size_t buddy_allocator<Allocator, MinBlock, MaxOrder>::max_block;
+  }
+  using namespace v_100;
+}
@@ -185,6 +185,18 @@ namespace alb {
         shrink();
       }
 
+      /**
+       * Calls f(const Allocator&) for the allocator of each node, starting with
+       * the oldest one.
+       */
+      template <typename Function>
+      void for_each_allocator(Function &&f) const
+      {
+        for (auto p = root_.load(); p != nullptr; p = p->next.load()) {
+          f(static_cast<const Allocator &>(p->allocator));
+        }
+      }
+
       /**
        * Sends the request to the first allocator, if it cannot fulfill the request
        * then the next Allocator is created and so on
@@ -0,0 +1,542 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "trace_recorder.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace alb {
+  inline namespace v_100 {
+
+    /**
+     * The requests of one size within a size profile
+     *
+     * \ingroup group_stats
+     */
+    struct size_profile_entry {
+      size_t requests;
+      /// The maximum number of live blocks of this size at the same time
+      size_t peak_live;
+    };
+
+    /**
+     * The distribution of the requested sizes of a program, as input for
+     * alb::plan_composition. It can be read from a trace of an
+     * alb::trace_recorder or from a text histogram.
+     *
+     * \ingroup group_stats
+     */
+    class size_profile {
+      std::map<size_t, size_profile_entry> entries_;
+      size_t peakRequestedBytes_ = 0;
+
+      void merge(size_t size, size_t requests, size_t peakLive)
+      {
+        auto &e = entries_[size];
+        e.requests += requests;
+        e.peak_live += peakLive;
+      }
+
+    public:
+      /**
+       * Adds requests of one size, of which at most peakLive are alive at the
+       * same time
+       */
+      void add(size_t size, size_t requests, size_t peakLive)
+      {
+        if (size == 0) {
+          return;
+        }
+        merge(size, requests, peakLive);
+        peakRequestedBytes_ += size * peakLive;
+      }
+
+      /**
+       * Adds the requests of a trace. The peak of the live blocks is taken per
+       * size; a reallocation counts as a new request of the new size.
+       * \return False, if the file is not a trace
+       */
+      bool add_trace(const char *path)
+      {
+        std::unordered_map<uint64_t, size_t> liveBlocks;
+        std::map<size_t, size_profile_entry> counted;
+        std::map<size_t, size_t> live;
+        size_t liveBytes = 0, peakLiveBytes = 0;
+
+        auto release = [&](uint64_t id) {
+          auto it = liveBlocks.find(id);
+          if (it != liveBlocks.end()) {
+            --live[it->second];
+            liveBytes -= it->second;
+            liveBlocks.erase(it);
+          }
+        };
+        auto acquire = [&](uint64_t id, size_t size) {
+          if (size == 0) {
+            return;
+          }
+          release(id);
+          liveBlocks[id] = size;
+          auto &e = counted[size];
+          ++e.requests;
+          e.peak_live = std::max(e.peak_live, ++live[size]);
+          liveBytes += size;
+          peakLiveBytes = std::max(peakLiveBytes, liveBytes);
+        };
+
+        const auto success = for_each_trace_record(path, [&](const trace_record &r) {
+          if (!r.success) {
+            return;
+          }
+          switch (r.op) {
+          case trace_operation::allocate:
+            acquire(r.result, static_cast<size_t>(r.size));
+            break;
+          case trace_operation::deallocate:
+            release(r.block);
+            break;
+          case trace_operation::reallocate:
+            release(r.block);
+            acquire(r.result, static_cast<size_t>(r.size));
+            break;
+          case trace_operation::expand: {
+            auto it = liveBlocks.find(r.block);
+            if (it != liveBlocks.end()) {
+              const auto size = it->second + static_cast<size_t>(r.size);
+              acquire(r.result, size);
+            }
+          } break;
+          case trace_operation::deallocate_all:
+            liveBlocks.clear();
+            live.clear();
+            liveBytes = 0;
+            break;
+          }
+        });
+        for (auto &c : counted) {
+          merge(c.first, c.second.requests, c.second.peak_live);
+        }
+        peakRequestedBytes_ += peakLiveBytes;
+        return success;
+      }
+
+      /**
+       * Adds a histogram in text form with one line "size requests [peak_live]"
+       * per size. Without the peak of the live blocks, all requests are assumed
+       * to be alive at the same time. Lines that start with # are ignored.
+       * \return False, if the file cannot be read or contains a malformed line
+       */
+      bool add_histogram(const char *path)
+      {
+        auto file = ::fopen(path, "r");
+        if (!file) {
+          return false;
+        }
+        char line[256];
+        bool result = true;
+        while (::fgets(line, sizeof(line), file)) {
+          unsigned long long size, requests, peakLive;
+          const auto fields = ::sscanf(line, "%llu %llu %llu", &size, &requests, &peakLive);
+          if (line[0] == '#' || fields == EOF) {
+            continue;
+          }
+          if (fields < 2) {
+            result = false;
+            break;
+          }
+          add(static_cast<size_t>(size), static_cast<size_t>(requests),
+              static_cast<size_t>(fields == 3 ? peakLive : requests));
+        }
+        ::fclose(file);
+        return result;
+      }
+
+      const std::map<size_t, size_profile_entry> &entries() const noexcept
+      {
+        return entries_;
+      }
+
+      bool empty() const noexcept
+      {
+        return entries_.empty();
+      }
+
+      /**
+       * Returns the maximum of the requested bytes of all live blocks. It is
+       * smaller than the sum over the peaks per size, if the peaks of the sizes
+       * do not coincide.
+       */
+      size_t peak_requested_bytes() const noexcept
+      {
+        return peakRequestedBytes_;
+      }
+    };
+
+    /**
+     * The limits and the costs that alb::plan_composition weighs against the
+     * slack
+     *
+     * \ingroup group_stats
+     */
+    struct composition_options {
+      /// The largest size that is served by freelists
+      size_t small_limit = 4096;
+      /// The largest size that is served by heaps, all above go to the mallocator
+      size_t heap_limit = 1024 * 1024;
+      /// The maximum number of bucketizers, resp. segregator levels
+      unsigned max_levels = 6;
+      /// The maximum number of buckets of one bucketizer, as a request is
+      /// searched linearly in the buckets
+      unsigned max_buckets = 16;
+      /// All bucket edges are a multiple of it
+      unsigned granularity = 8;
+      /// Bytes that each bucket costs in addition to its slack
+      size_t bucket_overhead = 256;
+      /// Bytes that each chunk of a heap costs in addition to its slack
+      size_t chunk_overhead = 16;
+      /// The size of one heap, if the largest request does not need more
+      size_t heap_capacity = 4 * 1024 * 1024;
+    };
+
+    /**
+     * One bucketizer of a planned composition with the buckets
+     * [min_size, min_size + step_size - 1], ... up to max_size
+     *
+     * \ingroup group_stats
+     */
+    struct composition_band {
+      size_t min_size;
+      size_t max_size;
+      size_t step_size;
+      /// The pool size of the freelists of the buckets
+      size_t pool_size;
+      size_t requested_bytes;
+      size_t footprint_bytes;
+
+      size_t number_of_buckets() const noexcept
+      {
+        return (max_size - min_size + 1) / step_size;
+      }
+    };
+
+    /**
+     * The planned composition: bucketizers of freelists up to the last band,
+     * a cascading heap up to heap_threshold, if heap_chunk_size is not 0, and
+     * the mallocator for everything above. The requested and the footprint
+     * bytes refer to the sum over the peak live blocks of each size; the
+     * predicted peak footprint scales the peak of the profile by their ratio.
+     *
+     * \ingroup group_stats
+     */
+    struct composition_plan {
+      std::vector<composition_band> bands;
+      size_t heap_threshold = 0;
+      size_t heap_chunk_size = 0;
+      size_t heap_number_of_chunks = 0;
+      size_t heap_footprint_bytes = 0;
+      size_t requested_bytes = 0;
+      size_t footprint_bytes = 0;
+      size_t number_of_requests = 0;
+      size_t number_of_sizes = 0;
+      size_t peak_requested_bytes = 0;
+
+      size_t slack_bytes() const noexcept
+      {
+        return footprint_bytes - requested_bytes;
+      }
+
+      size_t predicted_peak_footprint_bytes() const noexcept
+      {
+        return requested_bytes > 0 ? static_cast<size_t>(static_cast<double>(peak_requested_bytes) *
+                                                         footprint_bytes / requested_bytes)
+                                   : 0;
+      }
+    };
+
+    namespace internal {
+      inline size_t round_up(size_t n, size_t multiple) noexcept
+      {
+        return (n + multiple - 1) / multiple * multiple;
+      }
+
+      // Prefix sums of the weights and the weighted sizes, so that the slack
+      // of a bucket is available in constant time
+      class slack_calculator {
+        std::vector<uint64_t> weights_;
+        std::vector<uint64_t> bytes_;
+
+      public:
+        slack_calculator(const size_profile &profile, size_t limit)
+          : weights_(limit + 1, 0)
+          , bytes_(limit + 1, 0)
+        {
+          for (auto &e : profile.entries()) {
+            if (e.first <= limit) {
+              weights_[e.first] = e.second.peak_live;
+              bytes_[e.first] = e.first * e.second.peak_live;
+            }
+          }
+          for (size_t i = 1; i <= limit; ++i) {
+            weights_[i] += weights_[i - 1];
+            bytes_[i] += bytes_[i - 1];
+          }
+        }
+
+        uint64_t live(size_t lo, size_t hi) const noexcept
+        {
+          return weights_[hi] - weights_[lo - 1];
+        }
+
+        uint64_t requested(size_t lo, size_t hi) const noexcept
+        {
+          return bytes_[hi] - bytes_[lo - 1];
+        }
+
+        uint64_t slack(size_t lo, size_t hi) const noexcept
+        {
+          return hi * live(lo, hi) - requested(lo, hi);
+        }
+      };
+
+      inline size_t pool_size_for(uint64_t peakLive) noexcept
+      {
+        size_t result = 16;
+        while (result < peakLive && result < 1024) {
+          result *= 2;
+        }
+        return result;
+      }
+    }
+
+    /**
+     * Plans a composition for the profile that minimizes the slack of the peak
+     * live blocks plus the configured costs per bucket and per heap chunk.
+     * The edges of the bucketizers are found by dynamic programming over all
+     * multiples of the granularity up to the small limit; each band gets the
+     * step size with the least costs, that divides it into at most
+     * max_buckets buckets. The heap gets the chunk size with the least costs.
+     *
+     * \ingroup group_stats
+     */
+    inline composition_plan plan_composition(const size_profile &profile,
+                                             const composition_options &options = {})
+    {
+      composition_plan plan;
+      if (profile.empty()) {
+        return plan;
+      }
+      // The levels end with the largest size of the profile, that they serve
+      size_t largestSmall = 0, largestMedium = 0;
+      for (auto &e : profile.entries()) {
+        plan.number_of_requests += e.second.requests;
+        plan.requested_bytes += e.first * e.second.peak_live;
+        if (e.first <= options.small_limit) {
+          largestSmall = e.first;
+        }
+        else if (e.first <= options.heap_limit) {
+          largestMedium = e.first;
+        }
+      }
+      plan.number_of_sizes = profile.entries().size();
+      plan.peak_requested_bytes = profile.peak_requested_bytes();
+
+      const size_t g = options.granularity;
+      const auto smallLimit = internal::round_up(largestSmall, g);
+      const auto numberOfEdges = smallLimit / g;
+      const internal::slack_calculator calculator(profile, smallLimit);
+
+      // The best step size and its costs of the band between two edges
+      const auto noCosts = std::numeric_limits<uint64_t>::max();
+      std::vector<uint64_t> bandCosts((numberOfEdges + 1) * (numberOfEdges + 1), noCosts);
+      std::vector<size_t> bandSteps(bandCosts.size(), 0);
+      for (size_t i = 0; i < numberOfEdges; ++i) {
+        for (size_t j = i + 1; j <= numberOfEdges; ++j) {
+          const auto lo = i * g + 1, length = (j - i) * g;
+          auto &costs = bandCosts[i * (numberOfEdges + 1) + j];
+          for (size_t buckets = 1; buckets <= options.max_buckets; ++buckets) {
+            if (length % buckets != 0 || (length / buckets) % g != 0) {
+              continue;
+            }
+            const auto step = length / buckets;
+            uint64_t c = buckets * options.bucket_overhead;
+            for (size_t b = 0; b < buckets; ++b) {
+              c += calculator.slack(lo + b * step, lo + (b + 1) * step - 1);
+            }
+            if (c < costs) {
+              costs = c;
+              bandSteps[i * (numberOfEdges + 1) + j] = step;
+            }
+          }
+        }
+      }
+
+      // best[l][j] are the least costs to cover the sizes up to edge j with l bands
+      const auto levels = std::max(1u, options.max_levels);
+      std::vector<std::vector<uint64_t>> best(levels + 1,
+                                              std::vector<uint64_t>(numberOfEdges + 1, noCosts));
+      std::vector<std::vector<size_t>> previous(levels + 1,
+                                                std::vector<size_t>(numberOfEdges + 1, 0));
+      best[0][0] = 0;
+      for (unsigned l = 1; l <= levels; ++l) {
+        for (size_t j = 1; j <= numberOfEdges; ++j) {
+          for (size_t i = 0; i < j; ++i) {
+            const auto band = bandCosts[i * (numberOfEdges + 1) + j];
+            if (best[l - 1][i] == noCosts || band == noCosts) {
+              continue;
+            }
+            if (best[l - 1][i] + band < best[l][j]) {
+              best[l][j] = best[l - 1][i] + band;
+              previous[l][j] = i;
+            }
+          }
+        }
+      }
+      unsigned bestLevels = 1;
+      for (unsigned l = 1; l <= levels; ++l) {
+        if (best[l][numberOfEdges] < best[bestLevels][numberOfEdges]) {
+          bestLevels = l;
+        }
+      }
+      for (size_t l = numberOfEdges > 0 ? bestLevels : 0, j = numberOfEdges; l > 0; --l) {
+        const auto i = previous[l][j];
+        composition_band band;
+        band.min_size = i * g + 1;
+        band.max_size = j * g;
+        band.step_size = bandSteps[i * (numberOfEdges + 1) + j];
+        band.requested_bytes = calculator.requested(band.min_size, band.max_size);
+        band.footprint_bytes =
+          band.requested_bytes + bandCosts[i * (numberOfEdges + 1) + j] -
+          band.number_of_buckets() * options.bucket_overhead;
+        uint64_t peakLive = 0;
+        for (auto lo = band.min_size; lo < band.max_size; lo += band.step_size) {
+          peakLive = std::max(peakLive, calculator.live(lo, lo + band.step_size - 1));
+        }
+        band.pool_size = internal::pool_size_for(peakLive);
+        plan.bands.insert(plan.bands.begin(), band);
+        plan.footprint_bytes += band.footprint_bytes;
+        j = i;
+      }
+
+      // The sizes above the freelists go into a cascading heap, if there are
+      // any. The threshold must be a multiple of the chunk size, because the
+      // heap returns blocks with whole chunks and the segregator deallocates
+      // by the length of the block. One heap holds at least all requests, but
+      // is limited to heap_capacity otherwise; the cascading allocator creates
+      // more heaps if necessary.
+      if (largestMedium > 0) {
+        uint64_t bestCosts = noCosts;
+        for (size_t chunkSize = 64; chunkSize <= 65536; chunkSize *= 2) {
+          const auto threshold = internal::round_up(largestMedium, chunkSize);
+          uint64_t footprint = 0;
+          for (auto &e : profile.entries()) {
+            if (e.first > smallLimit && e.first <= threshold) {
+              footprint += internal::round_up(e.first, chunkSize) * e.second.peak_live;
+            }
+          }
+          const auto capacity =
+            std::max<uint64_t>(threshold, std::min<uint64_t>(footprint, options.heap_capacity));
+          const auto numberOfChunks = internal::round_up(
+            static_cast<size_t>((capacity + chunkSize - 1) / chunkSize), 64);
+          const auto costs = footprint + numberOfChunks * options.chunk_overhead;
+          if (costs < bestCosts) {
+            bestCosts = costs;
+            plan.heap_chunk_size = chunkSize;
+            plan.heap_number_of_chunks = numberOfChunks;
+            plan.heap_threshold = threshold;
+            plan.heap_footprint_bytes = static_cast<size_t>(footprint);
+          }
+        }
+        plan.footprint_bytes += plan.heap_footprint_bytes;
+      }
+
+      // The mallocator has no slack, that is known here
+      const auto mallocatorStart = std::max(smallLimit, plan.heap_threshold);
+      for (auto &e : profile.entries()) {
+        if (e.first > mallocatorStart) {
+          plan.footprint_bytes += e.first * e.second.peak_live;
+        }
+      }
+      return plan;
+    }
+
+    /**
+     * Writes the plan as C++ header with the type alias Name in the namespace
+     * Namespace and the predicted slack and footprint as comments.
+     * The default names fit to the tool alb-replay, so that the composition can
+     * be evaluated with the trace, from which it was planned.
+     *
+     * \ingroup group_stats
+     */
+    inline void write_composition_header(FILE *out, const composition_plan &plan,
+                                         const char *source,
+                                         const char *nameSpace = "alb_replay",
+                                         const char *name = "composition")
+    {
+      const auto percent = [](size_t part, size_t total) {
+        return total > 0 ? 100.0 * part / total : 0.0;
+      };
+      fprintf(out, "// Generated by alb-compose from %s\n", source);
+      fprintf(out, "// %zu requests of %zu different sizes\n", plan.number_of_requests,
+              plan.number_of_sizes);
+      fprintf(out, "// Predicted peak: %zu requested bytes, footprint %zu bytes, slack %.1f%%\n",
+              plan.peak_requested_bytes, plan.predicted_peak_footprint_bytes(),
+              percent(plan.slack_bytes(), plan.requested_bytes));
+      fprintf(out, "// The slack per level refers to the peak live blocks of each of its sizes\n");
+      fprintf(out, "#pragma once\n\n");
+      fprintf(out, "#include <alb/bucketizer.hpp>\n"
+                   "#include <alb/cascading_allocator.hpp>\n"
+                   "#include <alb/freelist.hpp>\n"
+                   "#include <alb/heap.hpp>\n"
+                   "#include <alb/mallocator.hpp>\n"
+                   "#include <alb/segregator.hpp>\n\n");
+      fprintf(out, "namespace %s {\n", nameSpace);
+      fprintf(out, "  template <size_t PoolSize>\n"
+                   "  using FList = alb::freelist<alb::mallocator, "
+                   "alb::internal::DynasticDynamicSet,\n"
+                   "                              alb::internal::DynasticDynamicSet, PoolSize>;\n\n");
+
+      fprintf(out, "  using %s =\n", name);
+      size_t levels = 0;
+      for (auto &band : plan.bands) {
+        const auto slack = band.footprint_bytes - band.requested_bytes;
+        fprintf(out, "    // %zu..%zu bytes, %zu bucket(s), slack %zu bytes (%.1f%%)\n", band.min_size,
+                band.max_size, band.number_of_buckets(), slack,
+                percent(slack, band.requested_bytes));
+        if (band.number_of_buckets() == 1) {
+          fprintf(out, "    alb::segregator<%zu, alb::freelist<alb::mallocator, %zu, %zu, %zu>,\n",
+                  band.max_size, band.min_size, band.max_size, band.pool_size);
+        }
+        else {
+          fprintf(out, "    alb::segregator<%zu, alb::bucketizer<FList<%zu>, %zu, %zu, %zu>,\n",
+                  band.max_size, band.pool_size, band.min_size, band.max_size, band.step_size);
+        }
+        ++levels;
+      }
+      if (plan.heap_chunk_size > 0) {
+        fprintf(out, "    // up to %zu bytes in heaps of %zu chunks of %zu bytes\n",
+                plan.heap_threshold, plan.heap_number_of_chunks, plan.heap_chunk_size);
+        fprintf(out, "    alb::segregator<%zu, alb::cascading_allocator<alb::heap<alb::mallocator, "
+                     "%zu, %zu>>,\n",
+                plan.heap_threshold, plan.heap_number_of_chunks, plan.heap_chunk_size);
+        ++levels;
+      }
+      fprintf(out, "    alb::mallocator%s;\n}\n", std::string(levels, '>').c_str());
+    }
+  }
+  using namespace v_100;
+}
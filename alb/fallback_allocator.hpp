@@ -38,6 +38,20 @@ namespace alb {
       static constexpr unsigned alignment = (Primary::alignment > Fallback::alignment) ? 
         Primary::alignment : Fallback::alignment;
 
+      /**
+       * Returns the allocator that gets all requests by default
+       */
+      const Primary &primary_part() const noexcept {
+        return *this;
+      }
+
+      /**
+       * Returns the allocator that gets the requests the Primary failed
+       */
+      const Fallback &fallback_part() const noexcept {
+        return *this;
+      }
+
       /**
        * Allocates the requested number of bytes.
        * \param n The number of bytes. Depending on the alignment of the allocator,
@@ -0,0 +1,419 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "allocator_base.hpp"
+#include "internal/traits.hpp"
+#include "internal/tsc_clock.hpp"
+
+#include <atomic>
+#include <csignal>
+#include <cstdint>
+#include <new>
+
+#if defined(_MSC_VER)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace alb {
+  inline namespace v_100 {
+
+    /**
+     * The operations that are recorded by the alb::flight_recorder
+     *
+     * \ingroup group_stats
+     */
+    enum class flight_operation : unsigned {
+      allocate,
+      deallocate,
+      reallocate,
+      expand,
+      deallocate_all
+    };
+
+    /**
+     * One event of the alb::flight_recorder
+     *
+     * \ingroup group_stats
+     */
+    struct flight_event {
+      /// Number of the event within its ring, counted from zero
+      uint64_t sequence;
+      /// Time stamp of the alb::internal::tsc_clock
+      uint64_t ticks;
+      /// Index of the recording ring, i.e. of the recording thread
+      unsigned ring;
+      flight_operation op;
+      /// The Tier parameter of the recording alb::flight_recorder
+      unsigned tier;
+      /// The requested bytes, resp. the delta of an expand
+      size_t size;
+      /// The resulting pointer, nullptr if the operation failed
+      void *ptr;
+    };
+
+    namespace internal {
+
+      /**
+       * Ring of the last NumberOfEvents events of one thread. Only the owning
+       * thread writes, readers from any thread (or a signal handler) validate
+       * each entry by its sequence number, like a seqlock, and skip the entries
+       * that are overwritten meanwhile. No lock is taken anywhere.
+       * All rings of the process are kept in a never shrinking list. The ring of
+       * an ended thread keeps its events and is reused by a later thread.
+       * \ingroup group_internal
+       */
+      template <unsigned NumberOfEvents>
+      class flight_ring {
+        struct entry {
+          std::atomic<uint64_t> sequence;
+          std::atomic<uint64_t> ticks;
+          std::atomic<uint64_t> info;
+          std::atomic<uint64_t> size;
+          std::atomic<uint64_t> ptr;
+        };
+
+        entry entries_[NumberOfEvents];
+        std::atomic<uint64_t> count_;
+        std::atomic<bool> inUse_;
+        flight_ring *next_;
+        unsigned index_;
+
+        static std::atomic<flight_ring *> &root() noexcept
+        {
+          static std::atomic<flight_ring *> instance(nullptr);
+          return instance;
+        }
+
+        struct owner {
+          flight_ring *ring;
+
+          owner() noexcept
+            : ring(claim())
+          {}
+
+          ~owner()
+          {
+            if (ring) {
+              ring->inUse_.store(false, std::memory_order_release);
+            }
+          }
+        };
+
+        flight_ring() noexcept
+          : count_(0)
+          , inUse_(true)
+          , next_(nullptr)
+          , index_(0)
+        {
+          for (auto &e : entries_) {
+            e.sequence.store(0, std::memory_order_relaxed);
+          }
+        }
+
+        static flight_ring *claim() noexcept
+        {
+          for (auto r = root().load(std::memory_order_acquire); r != nullptr; r = r->next_) {
+            bool expected = false;
+            if (r->inUse_.compare_exchange_strong(expected, true)) {
+              return r;
+            }
+          }
+          auto r = new (std::nothrow) flight_ring();
+          if (r) {
+            auto head = root().load(std::memory_order_relaxed);
+            do {
+              r->next_ = head;
+              r->index_ = head ? head->index_ + 1 : 0;
+            } while (!root().compare_exchange_weak(head, r, std::memory_order_release,
+                                                   std::memory_order_relaxed));
+          }
+          return r;
+        }
+
+      public:
+        /**
+         * Returns the ring of the calling thread, or nullptr if it could not be
+         * created.
+         */
+        static flight_ring *this_thread_ring() noexcept
+        {
+          static thread_local owner o;
+          return o.ring;
+        }
+
+        void record(flight_operation op, unsigned tier, size_t size, const void *ptr) noexcept
+        {
+          const auto n = count_.load(std::memory_order_relaxed);
+          auto &e = entries_[n % NumberOfEvents];
+          e.sequence.store(2 * n + 1, std::memory_order_relaxed);
+          std::atomic_thread_fence(std::memory_order_release);
+          e.ticks.store(tsc_clock::now(), std::memory_order_relaxed);
+          e.info.store(static_cast<uint64_t>(op) | (static_cast<uint64_t>(tier) << 8),
+                       std::memory_order_relaxed);
+          e.size.store(size, std::memory_order_relaxed);
+          e.ptr.store(reinterpret_cast<uintptr_t>(ptr), std::memory_order_relaxed);
+          e.sequence.store(2 * n + 2, std::memory_order_release);
+          count_.store(n + 1, std::memory_order_release);
+        }
+
+        /**
+         * Calls f(const flight_event&) for the retained events, the oldest first.
+         * This is async signal safe, as long as f is.
+         */
+        template <typename Function>
+        void for_each(Function &f) const
+        {
+          const auto count = count_.load(std::memory_order_acquire);
+          for (auto n = count > NumberOfEvents ? count - NumberOfEvents : 0; n < count; ++n) {
+            auto &e = entries_[n % NumberOfEvents];
+            const auto before = e.sequence.load(std::memory_order_acquire);
+            flight_event event;
+            event.sequence = n;
+            event.ticks = e.ticks.load(std::memory_order_relaxed);
+            const auto info = e.info.load(std::memory_order_relaxed);
+            event.size = static_cast<size_t>(e.size.load(std::memory_order_relaxed));
+            event.ptr = reinterpret_cast<void *>(
+              static_cast<uintptr_t>(e.ptr.load(std::memory_order_relaxed)));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (before != 2 * n + 2 || e.sequence.load(std::memory_order_relaxed) != before) {
+              continue;
+            }
+            event.ring = index_;
+            event.op = static_cast<flight_operation>(info & 0xff);
+            event.tier = static_cast<unsigned>(info >> 8);
+            f(static_cast<const flight_event &>(event));
+          }
+        }
+
+        template <typename Function>
+        static void for_each_ring(Function &&f)
+        {
+          for (auto r = root().load(std::memory_order_acquire); r != nullptr; r = r->next_) {
+            f(*r);
+          }
+        }
+      };
+
+      /**
+       * Appends the number in the given base to the buffer without any library
+       * call, so that it can be used within a signal handler.
+       */
+      inline char *append_number(char *out, uint64_t value, unsigned base = 10) noexcept
+      {
+        char digits[24];
+        int i = 0;
+        do {
+          digits[i++] = "0123456789abcdef"[value % base];
+          value /= base;
+        } while (value != 0);
+        while (i > 0) {
+          *out++ = digits[--i];
+        }
+        return out;
+      }
+
+      inline char *append_text(char *out, const char *text) noexcept
+      {
+        while (*text) {
+          *out++ = *text++;
+        }
+        return out;
+      }
+
+      /**
+       * The size of a buffer for format_flight_event. The longest line consists
+       * of 49 characters of text with the longest operation name, two unsigned
+       * of up to 10 digits, three 64 bit numbers of up to 20 digits and a
+       * pointer of up to 16 hex digits, so 145 characters.
+       */
+      static constexpr size_t flight_event_line_size = 160;
+      static_assert(sizeof(unsigned) <= 4 && sizeof(size_t) <= 8 && sizeof(void *) <= 8,
+                    "The flight_event_line_size does not cover the fields!");
+
+      /**
+       * Formats one event as a line of text. The buffer needs
+       * flight_event_line_size bytes.
+       */
+      inline size_t format_flight_event(char *buffer, const flight_event &e) noexcept
+      {
+        static const char *names[] = {"allocate", "deallocate", "reallocate", "expand",
+                                      "deallocate_all"};
+        auto out = buffer;
+        out = append_text(out, "ring ");
+        out = append_number(out, e.ring);
+        out = append_text(out, " #");
+        out = append_number(out, e.sequence);
+        out = append_text(out, " ticks ");
+        out = append_number(out, e.ticks);
+        out = append_text(out, " tier ");
+        out = append_number(out, e.tier);
+        out = append_text(out, " ");
+        out = append_text(out, names[static_cast<unsigned>(e.op) % 5]);
+        out = append_text(out, " size ");
+        out = append_number(out, e.size);
+        out = append_text(out, " ptr 0x");
+        out = append_number(out, reinterpret_cast<uintptr_t>(e.ptr), 16);
+        *out++ = '\n';
+        return static_cast<size_t>(out - buffer);
+      }
+
+      template <unsigned NumberOfEvents>
+      struct flight_signal_handler {
+        static std::atomic<int> &fd() noexcept
+        {
+          static std::atomic<int> instance(2);
+          return instance;
+        }
+
+        static void handle(int) noexcept;
+      };
+    }
+
+    /**
+     * Calls f(const flight_event&) for the retained events of all threads that
+     * were recorded by alb::flight_recorder with NumberOfEvents. The events of
+     * each thread are visited in the order of their recording.
+     *
+     * \ingroup group_stats
+     */
+    template <unsigned NumberOfEvents = 256, typename Function>
+    void for_each_flight_event(Function &&f)
+    {
+      internal::flight_ring<NumberOfEvents>::for_each_ring(
+        [&f](const internal::flight_ring<NumberOfEvents> &r) { r.for_each(f); });
+    }
+
+    /**
+     * Writes all retained events, one line per event, into the file descriptor.
+     * It neither allocates nor locks, so it can be called from a signal handler.
+     *
+     * \ingroup group_stats
+     */
+    template <unsigned NumberOfEvents = 256>
+    void dump_flight_events(int fd) noexcept
+    {
+      for_each_flight_event<NumberOfEvents>([fd](const flight_event &e) {
+        char line[internal::flight_event_line_size];
+        const auto length = internal::format_flight_event(line, e);
+#if defined(_MSC_VER)
+        (void)::_write(fd, line, static_cast<unsigned>(length));
+#else
+        (void)!::write(fd, line, length);
+#endif
+      });
+    }
+
+    template <unsigned NumberOfEvents>
+    void internal::flight_signal_handler<NumberOfEvents>::handle(int) noexcept
+    {
+      dump_flight_events<NumberOfEvents>(fd().load(std::memory_order_relaxed));
+    }
+
+    /**
+     * Installs a handler for the given signal, that dumps all retained events
+     * into the file descriptor, e.g. "kill -USR2 <pid>".
+     * \return True, if the handler was installed
+     *
+     * \ingroup group_stats
+     */
+    template <unsigned NumberOfEvents = 256>
+    bool install_flight_dump_handler(int signal, int fd = 2) noexcept
+    {
+      internal::flight_signal_handler<NumberOfEvents>::fd().store(fd);
+      return std::signal(signal, &internal::flight_signal_handler<NumberOfEvents>::handle) !=
+             SIG_ERR;
+    }
+
+    /**
+     * This allocator records each operation on the Allocator with its size,
+     * resulting pointer and time stamp in a ring of the last NumberOfEvents
+     * events of the calling thread. So it is cheap enough to be always on, and
+     * after a latency spike or an out of memory situation the preceding
+     * operations can be dumped by alb::dump_flight_events, e.g. on a signal, see
+     * alb::install_flight_dump_handler.
+     * All flight_recorder with the same NumberOfEvents share the ring of a
+     * thread, so that the recorders on several tiers of a composed allocator
+     * write one history, in which the events are told apart by the Tier.
+     * \tparam Allocator The allocator that performs all operations
+     * \tparam Tier An id of the recorder, that is stored with each event
+     * \tparam NumberOfEvents The number of events that each thread retains
+     *
+     * \ingroup group_allocators group_stats group_shared
+     */
+    template <class Allocator, unsigned Tier = 0, unsigned NumberOfEvents = 256>
+    class flight_recorder {
+      Allocator allocator_;
+
+      static void record(flight_operation op, size_t size, const void *ptr) noexcept
+      {
+        if (auto ring = internal::flight_ring<NumberOfEvents>::this_thread_ring()) {
+          ring->record(op, Tier, size, ptr);
+        }
+      }
+
+    public:
+      using allocator = Allocator;
+
+      static constexpr bool supports_truncated_deallocation =
+        Allocator::supports_truncated_deallocation;
+      static constexpr unsigned alignment = Allocator::alignment;
+      static constexpr unsigned tier = Tier;
+      static constexpr unsigned number_of_events = NumberOfEvents;
+
+      block allocate(size_t n) noexcept
+      {
+        auto result = allocator_.allocate(n);
+        record(flight_operation::allocate, n, result.ptr);
+        return result;
+      }
+
+      void deallocate(block &b) noexcept
+      {
+        record(flight_operation::deallocate, b.length, b.ptr);
+        allocator_.deallocate(b);
+      }
+
+      bool reallocate(block &b, size_t n) noexcept
+      {
+        const auto result = allocator_.reallocate(b, n);
+        record(flight_operation::reallocate, n, result ? b.ptr : nullptr);
+        return result;
+      }
+
+      template <typename U = Allocator>
+      typename std::enable_if<traits::has_expand<U>::value, bool>::type
+        expand(block &b, size_t delta) noexcept
+      {
+        const auto result = allocator_.expand(b, delta);
+        record(flight_operation::expand, delta, result ? b.ptr : nullptr);
+        return result;
+      }
+
+      template <typename U = Allocator>
+      typename std::enable_if<traits::has_owns<U>::value, bool>::type
+        owns(const block &b) const noexcept
+      {
+        return allocator_.owns(b);
+      }
+
+      template <typename U = Allocator>
+      typename std::enable_if<traits::has_deallocate_all<U>::value, void>::type
+        deallocate_all() noexcept
+      {
+        record(flight_operation::deallocate_all, 0, nullptr);
+        allocator_.deallocate_all();
+      }
+    };
+  }
+  using namespace v_100;
+}
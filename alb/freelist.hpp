@@ -113,6 +113,13 @@ namespace alb {
         _upperBound.value(maxSize);
       }
 
+      /**
+       * Returns the allocator that provides the blocks, if the pool is empty
+       */
+      const Allocator &parent() const noexcept {
+        return allocator_;
+      }
+
       /**
        * Returns the lower boundary
        */
@@ -214,6 +221,17 @@ namespace alb {
         return b && _lowerBound.value() <= b.length && b.length <= _upperBound.value();
       }
 
+      /**
+       * Returns the memory area of the underlying allocator, from which all blocks
+       * of this free list are taken.
+       * This method is only available if the Allocator implements it.
+       */
+      template <typename U = Allocator>
+      typename std::enable_if<traits::has_memory_region<U>::value, block>::type
+        memory_region() const noexcept {
+        return allocator_.memory_region();
+      }
+
       /**
        * Appends the block to the free list if it is not filled up. The given block
        * is reset
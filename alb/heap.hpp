@@ -115,6 +115,31 @@ namespace alb {
         return chunk_size_.value();
       }
 
+      /**
+       * Returns the length of the block that an allocation of n bytes results in
+       */
+      size_t good_size(size_t n) const noexcept {
+        return internal::round_to_alignment(chunk_size_.value(), n);
+      }
+
+      /**
+       * Returns the complete memory area that is managed by this heap. All
+       * returned blocks are located within it.
+       */
+      block memory_region() const noexcept {
+        return buffer_;
+      }
+
+      /**
+       * Returns the number of free chunks and the length of the longest run of
+       * adjacent free chunks. An allocation of more chunks than the longest run
+       * fails, even if there are enough free chunks in total.
+       */
+      helpers::free_chunk_summary free_chunks() const noexcept {
+        return helpers::summarize_free_chunks(controlSize_,
+                                              [this](size_t i) { return control_[i]; });
+      }
+
       bool owns(const block &b) const noexcept {
         return b && buffer_.ptr <= b.ptr &&
           b.ptr < (static_cast<char *>(buffer_.ptr) + buffer_.length);
@@ -0,0 +1,419 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "allocator_base.hpp"
+#include "internal/noatomic.hpp"
+#include "internal/spin_lock.hpp"
+#include "internal/stack_trace.hpp"
+#include "internal/traits.hpp"
+#include "internal/tsc_clock.hpp"
+
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <ostream>
+
+namespace alb {
+  inline namespace v_100 {
+
+    namespace internal {
+      /**
+       * Decides per thread which allocations are sampled. The distance in bytes
+       * between two samples is exponentially distributed with the mean
+       * MeanBytes. So every allocated byte has the same chance to be sampled and
+       * the sampled allocations do not depend on the pattern of the requests.
+       * \ingroup group_internal
+       */
+      template <size_t MeanBytes>
+      class heap_sampler {
+        struct state {
+          uint64_t random;
+          size_t bytesLeft;
+
+          state() noexcept
+            : random((reinterpret_cast<uintptr_t>(this) ^ tsc_clock::now()) | 1)
+            , bytesLeft(next_distance())
+          {}
+
+          // xorshift64*
+          size_t next_distance() noexcept
+          {
+            random ^= random >> 12;
+            random ^= random << 25;
+            random ^= random >> 27;
+            const double uniform =
+              static_cast<double>((random * 2685821657736338717ull) >> 11) / (1ull << 53);
+            return static_cast<size_t>(-std::log(1.0 - uniform) * MeanBytes) + 1;
+          }
+        };
+
+        static state &this_thread() noexcept
+        {
+          static thread_local state s;
+          return s;
+        }
+
+      public:
+        /**
+         * Returns true, if the allocation of n bytes shall be sampled
+         */
+        static bool sample(size_t n) noexcept
+        {
+          auto &s = this_thread();
+          if (n < s.bytesLeft) {
+            s.bytesLeft -= n;
+            return false;
+          }
+          s.bytesLeft = s.next_distance();
+          return true;
+        }
+      };
+
+      /**
+       * Fixed size hash table of all currently living samples keyed by their
+       * pointer. The slots are split into groups of slots_per_group, each with its
+       * own lock in the shared variant. A pointer is stored in the first of its two
+       * possible groups, that has a free slot. If both are full, the sample is
+       * dropped.
+       * Because the keys are atomic, a lookup for a pointer that is not sampled,
+       * and so nearly every deallocation, does not take a lock.
+       * \ingroup group_internal
+       */
+      template <bool Shared, unsigned MaxStackDepth, size_t NumberOfSlots>
+      class sample_table {
+      public:
+        struct sample {
+          size_t requested;
+          size_t length;
+          int depth;
+          void *frames[MaxStackDepth];
+        };
+
+        static constexpr size_t slots_per_group = 16;
+        static constexpr size_t number_of_groups = NumberOfSlots / slots_per_group;
+
+        static_assert(NumberOfSlots % slots_per_group == 0 && number_of_groups > 0,
+          "NumberOfSlots must be a multiple of 16!");
+
+      private:
+        using lock_type = typename traits::type_switch<spin_lock, no_lock, Shared>::type;
+
+        struct group {
+          lock_type lock;
+          std::atomic<void *> keys[slots_per_group];
+          sample samples[slots_per_group];
+        };
+
+        mutable group groups_[number_of_groups];
+
+        group &group_of(const void *p, unsigned choice) const noexcept
+        {
+          const auto hash = (reinterpret_cast<uintptr_t>(p) >> 4) * 11400714819323198485ull;
+          return groups_[(choice == 0 ? hash >> 40 : (hash >> 16) & 0xffffff) % number_of_groups];
+        }
+
+        static int find(const group &g, const void *p) noexcept
+        {
+          for (size_t i = 0; i < slots_per_group; ++i) {
+            if (g.keys[i].load(std::memory_order_relaxed) == p) {
+              return static_cast<int>(i);
+            }
+          }
+          return -1;
+        }
+
+      public:
+        sample_table() noexcept
+        {
+          clear();
+        }
+
+        /**
+         * Stores the given sample for p
+         * \return False, if there was no free slot
+         */
+        bool insert(void *p, const sample &s) noexcept
+        {
+          for (unsigned choice = 0; choice < 2; ++choice) {
+            auto &g = group_of(p, choice);
+            std::lock_guard<lock_type> guard(g.lock);
+            const auto i = find(g, nullptr);
+            if (i >= 0) {
+              g.samples[i] = s;
+              g.keys[i].store(p, std::memory_order_release);
+              return true;
+            }
+          }
+          return false;
+        }
+
+        /**
+         * Removes the sample of p, if it exists
+         * \param p The pointer of the sampled block
+         * \param s If not nullptr, the removed sample is copied into it
+         * \return True, if a sample for p existed
+         */
+        bool erase(const void *p, sample *s = nullptr) noexcept
+        {
+          for (unsigned choice = 0; choice < 2; ++choice) {
+            auto &g = group_of(p, choice);
+            if (find(g, p) < 0) {
+              continue;
+            }
+            std::lock_guard<lock_type> guard(g.lock);
+            const auto i = find(g, p);
+            if (i < 0) {
+              return false;
+            }
+            if (s) {
+              *s = g.samples[i];
+            }
+            g.keys[i].store(nullptr, std::memory_order_relaxed);
+            return true;
+          }
+          return false;
+        }
+
+        void clear() noexcept
+        {
+          for (auto &g : groups_) {
+            std::lock_guard<lock_type> guard(g.lock);
+            for (auto &k : g.keys) {
+              k.store(nullptr, std::memory_order_relaxed);
+            }
+          }
+        }
+
+        /**
+         * Calls f(p, sample) for each sample. Each group is locked while it is
+         * visited.
+         */
+        template <typename Function>
+        void for_each(Function &&f) const
+        {
+          for (auto &g : groups_) {
+            std::lock_guard<lock_type> guard(g.lock);
+            for (size_t i = 0; i < slots_per_group; ++i) {
+              if (auto p = g.keys[i].load(std::memory_order_acquire)) {
+                f(p, g.samples[i]);
+              }
+            }
+          }
+        }
+      };
+    }
+
+    /**
+     * This allocator samples about one allocation per SamplingPeriod allocated
+     * bytes, chosen at random, and keeps the call stack of each sampled
+     * allocation as long as it is alive. In contrast to the caller information of
+     * the alb::allocator_with_stats, nothing is stored in front of the blocks and
+     * the costs of the not sampled allocations are only the count down of the
+     * per thread sampler and on deallocation a lookup in the sample table.
+     * dump() writes all living samples in the legacy heap profile format of
+     * gperftools, so that they can be analyzed with pprof.
+     * The samples are kept in a table of NumberOfSlots entries; if it is full,
+     * further samples are dropped and counted by number_of_dropped_samples().
+     * \tparam Shared If true, the profiler is thread safe
+     * \tparam Allocator The allocator that does the allocations
+     * \tparam SamplingPeriod The mean distance in bytes between two samples
+     * \tparam MaxStackDepth The maximum number of frames that are captured
+     * \tparam NumberOfSlots The maximum number of simultaneous living samples
+     *
+     * \ingroup group_allocators group_stats
+     */
+    template <bool Shared, class Allocator, size_t SamplingPeriod, unsigned MaxStackDepth,
+              size_t NumberOfSlots>
+    class heap_profiler_base {
+      using table_type = internal::sample_table<Shared, MaxStackDepth, NumberOfSlots>;
+      using counter_type =
+        typename traits::type_switch<std::atomic<size_t>, internal::no_atomic<size_t>, Shared>::type;
+
+      Allocator allocator_;
+      table_type samples_;
+      counter_type dropped_;
+
+      void record(const block &b, size_t n) noexcept
+      {
+        typename table_type::sample s;
+        s.requested = n;
+        s.length = b.length;
+        s.depth = internal::capture_stack(s.frames, MaxStackDepth);
+        if (!samples_.insert(b.ptr, s)) {
+          ++dropped_;
+        }
+      }
+
+    public:
+      using allocator = Allocator;
+      using sample = typename table_type::sample;
+
+      static constexpr bool supports_truncated_deallocation =
+        Allocator::supports_truncated_deallocation;
+      static constexpr unsigned alignment = Allocator::alignment;
+      static constexpr size_t sampling_period = SamplingPeriod;
+
+      heap_profiler_base() noexcept
+        : dropped_(0)
+      {}
+
+      block allocate(size_t n) noexcept
+      {
+        auto result = allocator_.allocate(n);
+        if (result && internal::heap_sampler<SamplingPeriod>::sample(n)) {
+          record(result, n);
+        }
+        return result;
+      }
+
+      void deallocate(block &b) noexcept
+      {
+        if (b) {
+          samples_.erase(b.ptr);
+        }
+        allocator_.deallocate(b);
+      }
+
+      /**
+       * The block is reallocated by the Allocator. If it was sampled, the sample
+       * moves with it.
+       */
+      bool reallocate(block &b, size_t n) noexcept
+      {
+        sample s;
+        const auto sampled = b && samples_.erase(b.ptr, &s);
+        const auto result = allocator_.reallocate(b, n);
+        if (sampled && b) {
+          if (result) {
+            s.requested = n;
+            s.length = b.length;
+          }
+          if (!samples_.insert(b.ptr, s)) {
+            ++dropped_;
+          }
+        }
+        return result;
+      }
+
+      template <typename U = Allocator>
+      typename std::enable_if<traits::has_expand<U>::value, bool>::type
+        expand(block &b, size_t delta) noexcept
+      {
+        sample s;
+        const auto sampled = b && samples_.erase(b.ptr, &s);
+        const auto result = allocator_.expand(b, delta);
+        if (sampled) {
+          s.length = b.length;
+          if (!samples_.insert(b.ptr, s)) {
+            ++dropped_;
+          }
+        }
+        return result;
+      }
+
+      template <typename U = Allocator>
+      typename std::enable_if<traits::has_owns<U>::value, bool>::type
+        owns(const block &b) const noexcept
+      {
+        return allocator_.owns(b);
+      }
+
+      template <typename U = Allocator>
+      typename std::enable_if<traits::has_deallocate_all<U>::value, void>::type
+        deallocate_all() noexcept
+      {
+        samples_.clear();
+        allocator_.deallocate_all();
+      }
+
+      /**
+       * Returns the number of samples that could not be stored, because the
+       * table was full.
+       */
+      size_t number_of_dropped_samples() const noexcept
+      {
+        return dropped_.load();
+      }
+
+      /**
+       * Calls f(ptr, sample) for each living sample.
+       */
+      template <typename Function>
+      void for_each_sample(Function &&f) const
+      {
+        samples_.for_each(std::forward<Function>(f));
+      }
+
+      /**
+       * Writes all living samples in the legacy heap profile format
+       * ("heap_v2/<sampling period>") followed by the mapped libraries of the
+       * process, as far as they are available in /proc/self/maps. pprof
+       * extrapolates the samples to the estimated real usage.
+       */
+      void dump(std::ostream &out) const
+      {
+        size_t count = 0, bytes = 0;
+        for_each_sample([&](const void *, const sample &s) {
+          ++count;
+          bytes += s.requested;
+        });
+
+        out << "heap profile: " << std::setw(6) << count << ": " << std::setw(8) << bytes
+            << " [" << std::setw(6) << count << ": " << std::setw(8) << bytes
+            << "] @ heap_v2/" << SamplingPeriod << '\n';
+        for_each_sample([&out](const void *, const sample &s) {
+          out << std::setw(6) << 1 << ": " << std::setw(8) << s.requested << " [" << std::setw(6)
+              << 1 << ": " << std::setw(8) << s.requested << "] @";
+          for (int i = 0; i < s.depth; ++i) {
+            out << " 0x" << std::hex << reinterpret_cast<uintptr_t>(s.frames[i]) << std::dec;
+          }
+          out << '\n';
+        });
+
+        out << "\nMAPPED_LIBRARIES:\n";
+        std::ifstream maps("/proc/self/maps");
+        if (maps) {
+          out << maps.rdbuf();
+        }
+      }
+    };
+
+    /**
+     * Single threaded variant of the heap profiler. For details see
+     * alb::heap_profiler_base
+     *
+     * \ingroup group_allocators group_stats
+     */
+    template <class Allocator, size_t SamplingPeriod = 512 * 1024, unsigned MaxStackDepth = 32,
+              size_t NumberOfSlots = 1024>
+    class heap_profiler
+      : public heap_profiler_base<false, Allocator, SamplingPeriod, MaxStackDepth, NumberOfSlots>
+    {
+    };
+
+    /**
+     * Thread safe variant of the heap profiler. For details see
+     * alb::heap_profiler_base
+     *
+     * \ingroup group_allocators group_stats group_shared
+     */
+    template <class Allocator, size_t SamplingPeriod = 512 * 1024, unsigned MaxStackDepth = 32,
+              size_t NumberOfSlots = 1024>
+    class shared_heap_profiler
+      : public heap_profiler_base<true, Allocator, SamplingPeriod, MaxStackDepth, NumberOfSlots>
+    {
+    };
+  }
+  using namespace v_100;
+}
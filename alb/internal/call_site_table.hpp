@@ -0,0 +1,284 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "noatomic.hpp"
+#include "spin_lock.hpp"
+#include "traits.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+namespace alb {
+  inline namespace v_100 {
+
+    /**
+     * Aggregated statistic information of all allocations of one call site
+     *
+     * \ingroup group_stats
+     */
+    struct call_site_stats {
+      const char *file;
+      /// Function of the first allocation of this call site, if it is known
+      const char *function;
+      int line;
+      /// Bytes currently allocated by this call site
+      size_t live_bytes;
+      /// Number of blocks currently allocated by this call site
+      size_t live_count;
+      /// Maximum of live_bytes over the time
+      size_t peak_bytes;
+      /// Bytes allocated in total, including the growth by reallocations
+      size_t total_bytes;
+      /// Number of allocations in total
+      size_t total_count;
+    };
+
+    namespace internal {
+
+      /**
+       * Hash table of call sites keyed by (file, line). The file is compared by
+       * its pointer, which is the same for all allocations of one call site.
+       * Entries are never removed, so a lookup does not need a lock. Only the
+       * insertion of a new call site is serialized.
+       * If all Capacity entries are used, further call sites are not tracked and
+       * counted by number_of_dropped_sites().
+       * The index of a call site within the table stays valid as long as the
+       * table exists, so it can be used as a compact id of the call site, see
+       * intern().
+       * \tparam Shared If true, the table is thread safe
+       * \tparam Capacity The maximum number of call sites, must be a power of two
+       * \ingroup group_internal
+       */
+      template <bool Shared, size_t Capacity = 1024>
+      class call_site_table {
+        static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two!");
+
+        using value_type =
+          typename traits::type_switch<std::atomic<size_t>, no_atomic<size_t>, Shared>::type;
+        using lock_type = typename traits::type_switch<spin_lock, no_lock, Shared>::type;
+
+        struct entry {
+          std::atomic<const char *> file;
+          const char *function;
+          int line;
+          value_type live_bytes;
+          value_type live_count;
+          value_type peak_bytes;
+          value_type total_bytes;
+          value_type total_count;
+        };
+
+        entry entries_[Capacity];
+        lock_type insertLock_;
+        value_type dropped_;
+
+        static size_t hash(const char *file, int line) noexcept
+        {
+          return static_cast<size_t>(
+            ((reinterpret_cast<uintptr_t>(file) >> 3) ^ (static_cast<uint64_t>(line) << 20)) *
+            11400714819323198485ull >> 32);
+        }
+
+        /**
+         * Returns the entry of the call site or nullptr, if it does not exist.
+         * If insert is set, a missing entry is created.
+         */
+        entry *find(const char *file, const char *function, int line, bool insert) noexcept
+        {
+          if (file == nullptr) {
+            return nullptr;
+          }
+          const auto start = hash(file, line);
+          for (size_t i = 0; i < Capacity; ++i) {
+            auto &e = entries_[(start + i) & (Capacity - 1)];
+            const auto f = e.file.load(std::memory_order_acquire);
+            if (f == file && e.line == line) {
+              return &e;
+            }
+            if (f == nullptr) {
+              return insert ? insert_entry(file, function, line) : nullptr;
+            }
+          }
+          if (insert) {
+            ++dropped_;
+          }
+          return nullptr;
+        }
+
+        entry *insert_entry(const char *file, const char *function, int line) noexcept
+        {
+          std::lock_guard<lock_type> guard(insertLock_);
+          const auto start = hash(file, line);
+          for (size_t i = 0; i < Capacity; ++i) {
+            auto &e = entries_[(start + i) & (Capacity - 1)];
+            const auto f = e.file.load(std::memory_order_relaxed);
+            if (f == file && e.line == line) { // an other thread was faster
+              return &e;
+            }
+            if (f == nullptr) {
+              e.function = function;
+              e.line = line;
+              e.file.store(file, std::memory_order_release);
+              return &e;
+            }
+          }
+          ++dropped_;
+          return nullptr;
+        }
+
+        static void update_peak(entry &e, size_t liveBytes) noexcept
+        {
+          auto peak = e.peak_bytes.load();
+          while (peak < liveBytes && !e.peak_bytes.compare_exchange_strong(peak, liveBytes)) {
+          }
+        }
+
+      public:
+        static constexpr uint32_t invalid_id = ~uint32_t(0);
+
+        call_site_table() noexcept
+          : dropped_(0)
+        {
+          for (auto &e : entries_) {
+            e.file.store(nullptr, std::memory_order_relaxed);
+            e.function = nullptr;
+            e.line = 0;
+            e.live_bytes = 0;
+            e.live_count = 0;
+            e.peak_bytes = 0;
+            e.total_bytes = 0;
+            e.total_count = 0;
+          }
+        }
+
+        /**
+         * Returns the id of the call site, which is inserted if necessary, or
+         * invalid_id, if the table is full. The function is stored with the first
+         * insertion of the call site.
+         */
+        uint32_t intern(const char *file, const char *function, int line) noexcept
+        {
+          auto e = find(file, function, line, true);
+          return e ? static_cast<uint32_t>(e - entries_) : invalid_id;
+        }
+
+        /**
+         * Returns the file, function and line of an id returned by intern()
+         */
+        void site(uint32_t id, const char *&file, const char *&function, int &line) const noexcept
+        {
+          if (id == invalid_id) {
+            file = function = nullptr;
+            line = 0;
+            return;
+          }
+          file = entries_[id].file.load(std::memory_order_acquire);
+          function = entries_[id].function;
+          line = entries_[id].line;
+        }
+
+        void allocated(uint32_t id, size_t length) noexcept
+        {
+          if (id != invalid_id) {
+            auto &e = entries_[id];
+            e.total_bytes += length;
+            ++e.total_count;
+            ++e.live_count;
+            update_peak(e, e.live_bytes += length);
+          }
+        }
+
+        void deallocated(uint32_t id, size_t length) noexcept
+        {
+          if (id != invalid_id) {
+            entries_[id].live_bytes -= length;
+            --entries_[id].live_count;
+          }
+        }
+
+        void resized(uint32_t id, size_t oldLength, size_t newLength) noexcept
+        {
+          if (id != invalid_id) {
+            auto &e = entries_[id];
+            if (newLength > oldLength) {
+              e.total_bytes += newLength - oldLength;
+              update_peak(e, e.live_bytes += newLength - oldLength);
+            }
+            else {
+              e.live_bytes -= oldLength - newLength;
+            }
+          }
+        }
+
+        void deallocated(const char *file, int line, size_t length) noexcept
+        {
+          if (auto e = find(file, nullptr, line, false)) {
+            deallocated(static_cast<uint32_t>(e - entries_), length);
+          }
+        }
+
+        void resized(const char *file, int line, size_t oldLength, size_t newLength) noexcept
+        {
+          if (auto e = find(file, nullptr, line, false)) {
+            resized(static_cast<uint32_t>(e - entries_), oldLength, newLength);
+          }
+        }
+
+        size_t number_of_dropped_sites() const noexcept
+        {
+          return dropped_.load();
+        }
+
+        /**
+         * Calls f(const call_site_stats&) for each call site
+         */
+        template <typename Function>
+        void for_each(Function &&f) const
+        {
+          for (auto &e : entries_) {
+            if (auto file = e.file.load(std::memory_order_acquire)) {
+              call_site_stats s{file,
+                                e.function,
+                                e.line,
+                                e.live_bytes.load(),
+                                e.live_count.load(),
+                                e.peak_bytes.load(),
+                                e.total_bytes.load(),
+                                e.total_count.load()};
+              f(s);
+            }
+          }
+        }
+      };
+
+      /**
+       * Replacement of the call_site_table, if it is not needed
+       * \ingroup group_internal
+       */
+      struct no_call_site_table {
+        static constexpr uint32_t invalid_id = ~uint32_t(0);
+        uint32_t intern(const char *, const char *, int) noexcept { return invalid_id; }
+        void site(uint32_t, const char *&file, const char *&function, int &line) const noexcept
+        {
+          file = function = nullptr;
+          line = 0;
+        }
+        void allocated(uint32_t, size_t) noexcept {}
+        void deallocated(const char *, int, size_t) noexcept {}
+        void resized(const char *, int, size_t, size_t) noexcept {}
+        size_t number_of_dropped_sites() const noexcept { return 0; }
+        template <typename Function> void for_each(Function &&) const {}
+      };
+    }
+  }
+  using namespace v_100;
+}
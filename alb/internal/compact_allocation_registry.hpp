@@ -0,0 +1,182 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "spin_lock.hpp"
+#include "stats_shards.hpp"
+#include "traits.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+
+namespace alb {
+  inline namespace v_100 {
+    namespace internal {
+
+      /**
+       * Per allocation information in 20 bytes. The call site is an id of an
+       * alb::internal::call_site_table and the time is relative to the creation
+       * of the registry. The records of the live allocations are linked by their
+       * indices.
+       * \ingroup group_internal
+       */
+      struct compact_allocation_record {
+        uint32_t site;
+        uint32_t size;
+        uint32_t time;
+        uint32_t previous;
+        uint32_t next;
+      };
+
+      /**
+       * Table of compact_allocation_records. A tracked block only stores the 32
+       * bit index of its record. The records never move, so a reallocation of
+       * the block does not touch the table.
+       * In the shared variant the table is split into number_of_shards parts,
+       * each with its own lock and list. A thread takes its records from its
+       * shard and the shard of a record is derived from its index.
+       * If the part of a thread is full, further allocations are not tracked and
+       * counted by number_of_dropped_records().
+       * \tparam Shared If true, the table is thread safe
+       * \tparam Capacity The maximum number of records
+       * \ingroup group_internal
+       */
+      template <bool Shared, uint32_t Capacity = (1u << 16)>
+      class compact_allocation_registry
+      {
+      public:
+        static constexpr uint32_t invalid_index = ~uint32_t(0);
+        static constexpr unsigned number_of_shards = Shared ? 16 : 1;
+
+      private:
+        static_assert(Capacity % number_of_shards == 0,
+                      "Capacity must be a multiple of the number of shards!");
+        static constexpr uint32_t records_per_shard = Capacity / number_of_shards;
+
+        using lock_type = typename traits::type_switch<spin_lock, no_lock, Shared>::type;
+
+        struct shard {
+          lock_type lock;
+          uint32_t root;
+          uint32_t firstFree;
+          uint32_t unused;
+          size_t dropped;
+          char padding[cache_line_size];
+        };
+
+        std::unique_ptr<compact_allocation_record[]> records_;
+        mutable shard shards_[number_of_shards];
+
+        shard &shard_of(uint32_t index) const noexcept
+        {
+          return shards_[index / records_per_shard];
+        }
+
+      public:
+        compact_allocation_registry() noexcept
+          : records_(new (std::nothrow) compact_allocation_record[Capacity])
+        {
+          for (uint32_t i = 0; i < number_of_shards; ++i) {
+            shards_[i].root = invalid_index;
+            shards_[i].firstFree = invalid_index;
+            shards_[i].unused = i * records_per_shard;
+            shards_[i].dropped = 0;
+          }
+        }
+
+        const compact_allocation_record &operator[](uint32_t index) const noexcept
+        {
+          return records_[index];
+        }
+
+        /**
+         * Returns the index of the new record or invalid_index, if there is no
+         * free record.
+         */
+        uint32_t insert(uint32_t site, uint32_t size, uint32_t time) noexcept
+        {
+          auto &s = shards_[this_thread_shard_index() % number_of_shards];
+          std::lock_guard<lock_type> guard(s.lock);
+          uint32_t index = s.firstFree;
+          if (index != invalid_index) {
+            s.firstFree = records_[index].next;
+          }
+          else if (records_ && s.unused < (&s - shards_ + 1) * records_per_shard) {
+            index = s.unused++;
+          }
+          else {
+            ++s.dropped;
+            return invalid_index;
+          }
+          auto &r = records_[index];
+          r.site = site;
+          r.size = size;
+          r.time = time;
+          r.previous = invalid_index;
+          r.next = s.root;
+          if (s.root != invalid_index) {
+            records_[s.root].previous = index;
+          }
+          s.root = index;
+          return index;
+        }
+
+        void erase(uint32_t index) noexcept
+        {
+          if (index == invalid_index) {
+            return;
+          }
+          auto &s = shard_of(index);
+          std::lock_guard<lock_type> guard(s.lock);
+          auto &r = records_[index];
+          if (r.previous != invalid_index) {
+            records_[r.previous].next = r.next;
+          }
+          if (r.next != invalid_index) {
+            records_[r.next].previous = r.previous;
+          }
+          if (index == s.root) {
+            s.root = r.next;
+          }
+          r.next = s.firstFree;
+          s.firstFree = index;
+        }
+
+        size_t number_of_dropped_records() const noexcept
+        {
+          size_t result = 0;
+          for (auto &s : shards_) {
+            std::lock_guard<lock_type> guard(s.lock);
+            result += s.dropped;
+          }
+          return result;
+        }
+
+        /**
+         * Calls f(const compact_allocation_record&) for all live records, the
+         * newest of each shard first. Each shard is locked while it is visited.
+         */
+        template <typename Function>
+        void for_each(Function &&f) const
+        {
+          for (auto &s : shards_) {
+            std::lock_guard<lock_type> guard(s.lock);
+            for (auto i = s.root; i != invalid_index; i = records_[i].next) {
+              f(records_[i]);
+            }
+          }
+        }
+      };
+    }
+  }
+  using namespace v_100;
+}
@@ -0,0 +1,75 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "stats_shards.hpp"
+
+#if defined(__linux__)
+#include <sched.h>
+#if defined(__has_include)
+#if __has_include(<sys/rseq.h>)
+#include <sys/rseq.h>
+#define ALB_HAS_RSEQ 1
+#endif
+#endif
+#endif
+
+namespace alb {
+  inline namespace v_100 {
+    namespace internal {
+
+      /**
+       * Returns true, if the C library has registered a restartable sequence
+       * area for the threads, so that current_cpu() can read the CPU from it.
+       * \ingroup group_internal
+       */
+      inline bool rseq_available() noexcept
+      {
+#if defined(ALB_HAS_RSEQ)
+        return __rseq_size > 0;
+#else
+        return false;
+#endif
+      }
+
+      /**
+       * Returns the CPU, on which the calling thread runs right now. The
+       * thread may be moved to an other CPU at any time afterwards, so the
+       * result is only a hint for the choice of a shard.
+       * On Linux the CPU is read without a system call from the restartable
+       * sequence area, that the kernel keeps up to date, otherwise it is
+       * asked by sched_getcpu(). On other platforms each thread gets a fixed
+       * number round robin.
+       * \ingroup group_internal
+       */
+      inline unsigned current_cpu() noexcept
+      {
+#if defined(ALB_HAS_RSEQ)
+        if (__rseq_size > 0) {
+          auto area = reinterpret_cast<const volatile struct rseq *>(
+            static_cast<const char *>(__builtin_thread_pointer()) + __rseq_offset);
+          const auto cpu = static_cast<int>(area->cpu_id);
+          if (cpu >= 0) {
+            return static_cast<unsigned>(cpu);
+          }
+        }
+#endif
+#if defined(__linux__)
+        const auto cpu = ::sched_getcpu();
+        if (cpu >= 0) {
+          return static_cast<unsigned>(cpu);
+        }
+#endif
+        return this_thread_shard_index();
+      }
+    }
+  }
+  using namespace v_100;
+}
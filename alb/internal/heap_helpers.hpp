@@ -10,6 +10,11 @@
 #pragma once
 
 #include <stddef.h>
+#include <stdint.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 
 namespace alb {
   inline namespace v_100 {
@@ -26,6 +31,82 @@ namespace alb {
       {
         return currentRegister | mask;
       }
+
+      /**
+       * Returns the index of the lowest set bit. The register must not be 0.
+       */
+      inline unsigned lowest_set_bit(uint64_t currentRegister) noexcept
+      {
+#if defined(_MSC_VER)
+        unsigned long result;
+        _BitScanForward64(&result, currentRegister);
+        return static_cast<unsigned>(result);
+#else
+        return static_cast<unsigned>(__builtin_ctzll(currentRegister));
+#endif
+      }
+
+      /**
+       * Returns the index of the highest set bit. The register must not be 0.
+       */
+      inline unsigned highest_set_bit(uint64_t currentRegister) noexcept
+      {
+#if defined(_MSC_VER)
+        unsigned long result;
+        _BitScanReverse64(&result, currentRegister);
+        return static_cast<unsigned>(result);
+#else
+        return 63u - static_cast<unsigned>(__builtin_clzll(currentRegister));
+#endif
+      }
+
+      /**
+       * The free chunks of a heap and the longest run of adjacent free chunks.
+       * If the longest run is much shorter than the free chunks, the free space
+       * is fragmented and larger requests fail, although there is enough space.
+       */
+      struct free_chunk_summary {
+        size_t free_chunks;
+        size_t largest_free_run;
+      };
+
+      /**
+       * Walks through the control registers, in which a set bit marks a free
+       * chunk. load(i) returns the register i.
+       */
+      template <typename Load>
+      free_chunk_summary summarize_free_chunks(size_t numberOfRegisters, Load &&load) noexcept
+      {
+        free_chunk_summary result{0, 0};
+        size_t currentRun = 0;
+        for (size_t i = 0; i < numberOfRegisters; ++i) {
+          const uint64_t r = load(i);
+          if (r == uint64_t(-1)) {
+            result.free_chunks += 64;
+            currentRun += 64;
+          }
+          else if (r == 0) {
+            currentRun = 0;
+          }
+          else {
+            for (unsigned bit = 0; bit < 64; ++bit) {
+              if (r & (uint64_t(1) << bit)) {
+                ++result.free_chunks;
+                ++currentRun;
+                result.largest_free_run =
+                  currentRun > result.largest_free_run ? currentRun : result.largest_free_run;
+              }
+              else {
+                currentRun = 0;
+              }
+            }
+            continue;
+          }
+          result.largest_free_run =
+            currentRun > result.largest_free_run ? currentRun : result.largest_free_run;
+        }
+        return result;
+      }
     }
   }
   using namespace v_100;
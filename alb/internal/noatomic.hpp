@@ -52,6 +52,11 @@ namespace alb {
           return true;
         }
 
+        bool compare_exchange_weak(T &e, T v) noexcept
+        {
+          return compare_exchange_strong(e, std::move(v));
+        }
+
         operator T() const {
           return value_;
         }
@@ -0,0 +1,381 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "stats_shards.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <new>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define ALB_HAS_SHM_STATS 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace alb {
+  inline namespace v_100 {
+    namespace internal {
+
+      /**
+       * Layout of the POSIX shared memory segment "/alb.<pid>", in which the
+       * alb::allocator_with_stats with the option SharedMemoryCounters of a
+       * process place their counters. Readers, like the alb-top tool, map it read
+       * only and never lock anything.
+       * \ingroup group_internal
+       */
+      namespace shm_stats {
+        static constexpr char magic[8] = {'A', 'L', 'B', 'S', 'T', 'A', 'T', '1'};
+        static constexpr unsigned number_of_slots = 64;
+        static constexpr unsigned number_of_shards = 16;
+        static constexpr unsigned number_of_counters = 16;
+        static constexpr unsigned name_size = 64;
+
+        enum slot_state : uint32_t { free_slot, initializing_slot, used_slot };
+
+        // Not over-aligned, so that the fallback slot can be created by new
+        struct shard {
+          std::atomic<uint64_t> values[number_of_counters];
+          // Keeps the neighbours apart, regardless of the alignment
+          char padding[cache_line_size];
+        };
+
+        struct slot {
+          std::atomic<uint32_t> state;
+          char name[name_size];
+          std::atomic<uint64_t> high_tide;
+          shard shards[number_of_shards];
+        };
+
+        struct header {
+          char magic[8];
+          uint32_t number_of_slots;
+          uint32_t number_of_counters;
+          uint64_t pid;
+        };
+
+        struct segment {
+          header head;
+          slot slots[number_of_slots];
+        };
+
+        /**
+         * Writes the name of the segment of the given process into buffer
+         */
+        inline void segment_name(char *buffer, size_t size, long pid) noexcept
+        {
+          ::snprintf(buffer, size, "/alb.%ld", pid);
+        }
+
+        inline void reset(slot &s, unsigned index) noexcept
+        {
+          for (auto &sh : s.shards) {
+            for (auto &v : sh.values) {
+              v.store(0, std::memory_order_relaxed);
+            }
+          }
+          s.high_tide.store(0, std::memory_order_relaxed);
+          ::snprintf(s.name, sizeof(s.name), "#%u", index);
+        }
+
+        /**
+         * Owns the segment of this process. It is created with the first use and
+         * removed at the end of the process.
+         */
+        class owner {
+          segment *segment_;
+          char name_[32];
+
+        public:
+          owner() noexcept
+            : segment_(nullptr)
+          {
+#if defined(ALB_HAS_SHM_STATS)
+            segment_name(name_, sizeof(name_), static_cast<long>(::getpid()));
+            const auto fd = ::shm_open(name_, O_CREAT | O_RDWR | O_TRUNC, 0644);
+            if (fd < 0) {
+              return;
+            }
+            if (::ftruncate(fd, sizeof(segment)) == 0) {
+              auto p = ::mmap(nullptr, sizeof(segment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+              if (p != MAP_FAILED) {
+                segment_ = static_cast<segment *>(p);
+              }
+            }
+            ::close(fd);
+            if (!segment_) {
+              ::shm_unlink(name_);
+              return;
+            }
+            // the mapping is zero filled, so all slots are free
+            segment_->head.number_of_slots = number_of_slots;
+            segment_->head.number_of_counters = number_of_counters;
+            segment_->head.pid = static_cast<uint64_t>(::getpid());
+            std::atomic_thread_fence(std::memory_order_release);
+            ::memcpy(segment_->head.magic, magic, sizeof(magic));
+#endif
+          }
+
+          ~owner()
+          {
+#if defined(ALB_HAS_SHM_STATS)
+            if (segment_) {
+              ::munmap(segment_, sizeof(segment));
+              ::shm_unlink(name_);
+            }
+#endif
+          }
+
+          owner(const owner &) = delete;
+          owner &operator=(const owner &) = delete;
+
+          /**
+           * Returns a free slot with reset counters or nullptr
+           */
+          slot *claim() noexcept
+          {
+            if (!segment_) {
+              return nullptr;
+            }
+            for (unsigned i = 0; i < number_of_slots; ++i) {
+              auto &s = segment_->slots[i];
+              uint32_t expected = free_slot;
+              if (s.state.compare_exchange_strong(expected, initializing_slot)) {
+                reset(s, i);
+                s.state.store(used_slot, std::memory_order_release);
+                return &s;
+              }
+            }
+            return nullptr;
+          }
+        };
+
+        inline owner &process_segment() noexcept
+        {
+          static owner instance;
+          return instance;
+        }
+
+        /**
+         * Maps the segment of an other (or the own) process read only.
+         */
+        class reader {
+          const segment *segment_;
+
+        public:
+          reader() noexcept
+            : segment_(nullptr)
+          {}
+
+          ~reader()
+          {
+            close();
+          }
+
+          reader(const reader &) = delete;
+          reader &operator=(const reader &) = delete;
+
+          /**
+           * Returns true, if the segment of the process exists and is valid
+           */
+          bool open(long pid) noexcept
+          {
+            close();
+#if defined(ALB_HAS_SHM_STATS)
+            char name[32];
+            segment_name(name, sizeof(name), pid);
+            const auto fd = ::shm_open(name, O_RDONLY, 0);
+            if (fd < 0) {
+              return false;
+            }
+            struct stat info;
+            if (::fstat(fd, &info) == 0 && static_cast<size_t>(info.st_size) >= sizeof(segment)) {
+              auto p = ::mmap(nullptr, sizeof(segment), PROT_READ, MAP_SHARED, fd, 0);
+              if (p != MAP_FAILED) {
+                segment_ = static_cast<const segment *>(p);
+              }
+            }
+            ::close(fd);
+            if (segment_ && (::memcmp(segment_->head.magic, magic, sizeof(magic)) != 0 ||
+                             segment_->head.number_of_counters != number_of_counters)) {
+              close();
+            }
+#else
+            (void)pid;
+#endif
+            return segment_ != nullptr;
+          }
+
+          void close() noexcept
+          {
+#if defined(ALB_HAS_SHM_STATS)
+            if (segment_) {
+              ::munmap(const_cast<segment *>(segment_), sizeof(segment));
+            }
+#endif
+            segment_ = nullptr;
+          }
+
+          /**
+           * Calls f(const char *name, const uint64_t *counters, uint64_t highTide)
+           * for each used slot. The counters are summed up over all shards and
+           * are in the order of ALB_STATS_SNAPSHOT_FIELDS.
+           */
+          template <typename Function>
+          void for_each_slot(Function &&f) const
+          {
+            if (!segment_) {
+              return;
+            }
+            for (auto &s : segment_->slots) {
+              if (s.state.load(std::memory_order_acquire) != used_slot) {
+                continue;
+              }
+              char name[name_size];
+              ::memcpy(name, s.name, name_size);
+              name[name_size - 1] = '\0';
+              uint64_t counters[number_of_counters] = {};
+              for (auto &sh : s.shards) {
+                for (unsigned i = 0; i < number_of_counters; ++i) {
+                  counters[i] += sh.values[i].load(std::memory_order_acquire);
+                }
+              }
+              f(static_cast<const char *>(name), static_cast<const uint64_t *>(counters),
+                s.high_tide.load(std::memory_order_relaxed));
+            }
+          }
+        };
+      }
+
+      /**
+       * Counters with the same interface as stats_counters, but placed in a slot
+       * of the shared memory segment of the process. In the not shared variant
+       * only one thread writes, so the values are updated with a plain load and
+       * store. If no slot is available, e.g. because all are in use, the counters
+       * are kept in a private slot, that is not visible to other processes.
+       * \ingroup group_internal
+       */
+      template <bool Shared, size_t N>
+      class shm_stats_counters
+      {
+        static_assert(N <= shm_stats::number_of_counters, "Too many counters!");
+
+        shm_stats::slot *slot_;
+        bool published_;
+
+      public:
+        shm_stats_counters() noexcept
+          : slot_(shm_stats::process_segment().claim())
+          , published_(slot_ != nullptr)
+        {
+          if (!slot_) {
+            slot_ = new (std::nothrow) shm_stats::slot();
+            if (slot_) {
+              shm_stats::reset(*slot_, 0);
+            }
+          }
+        }
+
+        ~shm_stats_counters()
+        {
+          if (published_) {
+            slot_->state.store(shm_stats::free_slot, std::memory_order_release);
+          }
+          else {
+            delete slot_;
+          }
+        }
+
+        shm_stats_counters(const shm_stats_counters &) = delete;
+        shm_stats_counters &operator=(const shm_stats_counters &) = delete;
+
+        /**
+         * Returns true, if the counters are visible in the shared memory segment
+         */
+        bool published() const noexcept
+        {
+          return published_;
+        }
+
+        void add(size_t i, size_t delta) noexcept
+        {
+          if (!slot_) {
+            return;
+          }
+          if (Shared) {
+            slot_->shards[this_thread_shard_index() % shm_stats::number_of_shards]
+              .values[i]
+              .fetch_add(delta, std::memory_order_release);
+          }
+          else {
+            auto &v = slot_->shards[0].values[i];
+            v.store(v.load(std::memory_order_relaxed) + delta, std::memory_order_release);
+          }
+        }
+
+        size_t load(size_t i) const noexcept
+        {
+          size_t result = 0;
+          if (slot_) {
+            for (auto &s : slot_->shards) {
+              result += s.values[i].load(std::memory_order_acquire);
+            }
+          }
+          return result;
+        }
+
+        void set_name(const char *name) noexcept
+        {
+          if (slot_) {
+            ::snprintf(slot_->name, sizeof(slot_->name), "%s", name);
+          }
+        }
+
+        void publish_high_tide(size_t value) noexcept
+        {
+          if (slot_) {
+            slot_->high_tide.store(value, std::memory_order_relaxed);
+          }
+        }
+      };
+
+      /**
+       * Only the counters in shared memory have a name and need the high tide
+       */
+      template <class Counters>
+      inline void set_counters_name(Counters &, const char *) noexcept
+      {
+      }
+
+      template <bool Shared, size_t N>
+      inline void set_counters_name(shm_stats_counters<Shared, N> &c, const char *name) noexcept
+      {
+        c.set_name(name);
+      }
+
+      template <class Counters>
+      inline void publish_high_tide(Counters &, size_t) noexcept
+      {
+      }
+
+      template <bool Shared, size_t N>
+      inline void publish_high_tide(shm_stats_counters<Shared, N> &c, size_t value) noexcept
+      {
+        c.publish_high_tide(value);
+      }
+    }
+  }
+  using namespace v_100;
+}
@@ -0,0 +1,64 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <atomic>
+
+namespace alb {
+  inline namespace v_100 {
+    namespace internal {
+
+      /**
+       * Minimal lock for very short critical sections that are rarely contended.
+       * It fulfills the Lockable concept, so it can be used with std::lock_guard.
+       * \ingroup group_internal
+       */
+      class spin_lock {
+        std::atomic_flag locked_;
+
+      public:
+        spin_lock() noexcept
+        {
+          locked_.clear();
+        }
+
+        spin_lock(const spin_lock &) = delete;
+        spin_lock &operator=(const spin_lock &) = delete;
+
+        void lock() noexcept
+        {
+          while (locked_.test_and_set(std::memory_order_acquire)) {
+          }
+        }
+
+        bool try_lock() noexcept
+        {
+          return !locked_.test_and_set(std::memory_order_acquire);
+        }
+
+        void unlock() noexcept
+        {
+          locked_.clear(std::memory_order_release);
+        }
+      };
+
+      /**
+       * Replacement of the spin_lock in the not shared variants
+       * \ingroup group_internal
+       */
+      struct no_lock {
+        void lock() noexcept {}
+        bool try_lock() noexcept { return true; }
+        void unlock() noexcept {}
+      };
+    }
+  }
+  using namespace v_100;
+}
@@ -0,0 +1,61 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#pragma once
+
+#if defined(__GLIBC__) || defined(__APPLE__)
+#include <execinfo.h>
+#define ALB_HAS_BACKTRACE 1
+#elif defined(_MSC_VER)
+#include <windows.h>
+#endif
+
+namespace alb {
+  inline namespace v_100 {
+    namespace internal {
+
+      /**
+       * Stores the return addresses of the current call stack, starting with the
+       * caller of this function, into frames. (It is never inlined, so that the
+       * own frame can be skipped.)
+       * Be aware that the first call may allocate memory by ::malloc() for
+       * loading the unwinder.
+       * \param frames Array with at least maxDepth elements
+       * \param maxDepth The maximum number of frames that are captured
+       * \return The number of captured frames. It is zero on platforms without
+       *         a stack walker.
+       * \ingroup group_internal
+       */
+#if defined(__GNUC__)
+      __attribute__((noinline))
+#elif defined(_MSC_VER)
+      __declspec(noinline)
+#endif
+      inline int capture_stack(void **frames, int maxDepth) noexcept
+      {
+#if defined(ALB_HAS_BACKTRACE)
+        void *buffer[256];
+        const int depth = ::backtrace(buffer, maxDepth + 1 < 256 ? maxDepth + 1 : 256);
+        int result = 0;
+        for (int i = 1; i < depth; ++i) {
+          frames[result++] = buffer[i];
+        }
+        return result;
+#elif defined(_MSC_VER)
+        return CaptureStackBackTrace(1, maxDepth, frames, nullptr);
+#else
+        (void)frames;
+        (void)maxDepth;
+        return 0;
+#endif
+      }
+    }
+  }
+  using namespace v_100;
+}
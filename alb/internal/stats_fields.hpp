@@ -0,0 +1,35 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#pragma once
+
+/**
+ * Calls X(name, isCounter) for each member of alb::stats_snapshot. The order is
+ * the same as the one of the counters within alb::allocator_with_stats, the
+ * bytes_high_tide, the only gauge, comes last.
+ * \ingroup group_internal
+ */
+#define ALB_STATS_SNAPSHOT_FIELDS(X)                                           \
+  X(num_owns, true)                                                            \
+  X(num_allocate, true)                                                        \
+  X(num_allocate_ok, true)                                                     \
+  X(num_expand, true)                                                          \
+  X(num_expand_ok, true)                                                       \
+  X(num_reallocate, true)                                                      \
+  X(num_reallocate_ok, true)                                                   \
+  X(num_reallocate_in_place, true)                                             \
+  X(num_deallocate, true)                                                      \
+  X(num_deallocate_all, true)                                                  \
+  X(bytes_allocated, true)                                                     \
+  X(bytes_deallocated, true)                                                   \
+  X(bytes_expanded, true)                                                      \
+  X(bytes_contracted, true)                                                    \
+  X(bytes_moved, true)                                                         \
+  X(bytes_slack, true)                                                         \
+  X(bytes_high_tide, false)
@@ -0,0 +1,445 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+
+#include "spin_lock.hpp"
+
+namespace alb {
+  inline namespace v_100 {
+    namespace internal {
+
+      /**
+       * Assumed size of a cache line. It is used to keep data that is written by
+       * different threads on different cache lines.
+       * \ingroup group_internal
+       */
+      constexpr size_t cache_line_size = 64;
+
+      /**
+       * Returns a per thread index. The threads get their numbers round robin in
+       * the order of their first call.
+       * \ingroup group_internal
+       */
+      inline unsigned this_thread_shard_index() noexcept
+      {
+        static std::atomic<unsigned> nextIndex(0);
+        static thread_local unsigned index = nextIndex.fetch_add(1, std::memory_order_relaxed);
+        return index;
+      }
+
+      /**
+       * Returns the index of the highest set bit of n, e.g. 0 for 1, 3 for 8..15.
+       * Zero is mapped to 0 as well.
+       * \ingroup group_internal
+       */
+      inline unsigned size_class(size_t n) noexcept
+      {
+#if defined(__GNUC__)
+        return n == 0 ? 0 : static_cast<unsigned>(sizeof(unsigned long long) * 8 - 1 -
+                                                  __builtin_clzll(n));
+#else
+        unsigned result = 0;
+        while (n >>= 1) {
+          ++result;
+        }
+        return result;
+#endif
+      }
+
+      /**
+       * Number of classes that size_class() returns
+       * \ingroup group_internal
+       */
+      constexpr unsigned number_of_size_classes = sizeof(size_t) * 8;
+
+      /**
+       * Returns true for every Rate-th call within the calling thread.
+       * Rate must be a power of two.
+       * \ingroup group_internal
+       */
+      template <unsigned Rate>
+      inline bool sample_this_call() noexcept
+      {
+        static_assert((Rate & (Rate - 1)) == 0, "Rate must be a power of two!");
+        static thread_local unsigned calls = 0;
+        return (++calls & (Rate - 1)) == 0;
+      }
+
+      /**
+       * Replacement for stats_counters, if the counters are not needed
+       * \ingroup group_internal
+       */
+      struct no_counters {
+        void add(size_t, size_t) noexcept {}
+
+        size_t load(size_t) const noexcept
+        {
+          return 0;
+        }
+      };
+
+      /**
+       * Storage of N statistic counters. In the not shared variant these are just
+       * plain values.
+       * \ingroup group_internal
+       */
+      template <bool Shared, size_t N>
+      class stats_counters
+      {
+        size_t values_[N];
+
+      public:
+        stats_counters() noexcept
+        {
+          std::fill(values_, values_ + N, 0);
+        }
+
+        void add(size_t i, size_t delta) noexcept
+        {
+          values_[i] += delta;
+        }
+
+        size_t load(size_t i) const noexcept
+        {
+          return values_[i];
+        }
+      };
+
+      /**
+       * In the shared variant each thread adds to one of number_of_shards copies
+       * of all counters. Each copy is padded to its own cache lines, so threads
+       * do not contend, as long as there are not more threads than shards. A read
+       * sums up all shards.
+       * The counters are updated with release and read with acquire semantic. So
+       * if a reader reads first counters that are incremented by a later
+       * operation, e.g. the number of deallocations, and then the ones of the
+       * earlier operation, e.g. the number of allocations, the first never exceeds
+       * the second one.
+       * \ingroup group_internal
+       */
+      template <size_t N>
+      class stats_counters<true, N>
+      {
+      public:
+        static constexpr unsigned number_of_shards = 16;
+
+      private:
+        struct shard {
+          std::atomic<size_t> values[N];
+          // The additional line keeps neighbours apart, regardless of the alignment
+          char padding[cache_line_size - (N * sizeof(size_t)) % cache_line_size + cache_line_size];
+        };
+
+        shard shards_[number_of_shards];
+
+      public:
+        stats_counters() noexcept
+        {
+          for (auto &s : shards_) {
+            for (auto &v : s.values) {
+              v.store(0, std::memory_order_relaxed);
+            }
+          }
+        }
+
+        void add(size_t i, size_t delta) noexcept
+        {
+          shards_[this_thread_shard_index() % number_of_shards].values[i].fetch_add(
+            delta, std::memory_order_release);
+        }
+
+        size_t load(size_t i) const noexcept
+        {
+          size_t result = 0;
+          for (auto &s : shards_) {
+            result += s.values[i].load(std::memory_order_acquire);
+          }
+          return result;
+        }
+      };
+
+      /**
+       * Tracks the currently used bytes and its maximum.
+       * \ingroup group_internal
+       */
+      template <bool Shared>
+      class high_tide
+      {
+        size_t current_;
+        size_t max_;
+
+      public:
+        high_tide() noexcept
+          : current_(0)
+          , max_(0)
+        {}
+
+        void add(size_t delta) noexcept
+        {
+          current_ += delta;
+          if (max_ < current_) {
+            max_ = current_;
+          }
+        }
+
+        size_t load() const noexcept
+        {
+          return max_;
+        }
+      };
+
+      /**
+       * The maximum of all threads can only be determined by a global counter of
+       * the currently used bytes. So this is the only statistic information
+       * that is updated by all threads on the same cache line.
+       * \ingroup group_internal
+       */
+      template <>
+      class high_tide<true>
+      {
+        std::atomic<size_t> current_;
+        std::atomic<size_t> max_;
+
+      public:
+        high_tide() noexcept
+          : current_(0)
+          , max_(0)
+        {}
+
+        void add(size_t delta) noexcept
+        {
+          const auto current = current_.fetch_add(delta, std::memory_order_relaxed) + delta;
+          auto max = max_.load(std::memory_order_relaxed);
+          while (max < current &&
+                 !max_.compare_exchange_weak(max, current, std::memory_order_relaxed)) {
+          }
+        }
+
+        size_t load() const noexcept
+        {
+          return max_.load(std::memory_order_relaxed);
+        }
+      };
+
+      /**
+       * Double linked list of per allocation information. Info must provide the
+       * members previous, next and shard. The newest element is the root.
+       * \ingroup group_internal
+       */
+      template <bool Shared, typename Info>
+      class allocation_registry
+      {
+        Info *root_;
+
+      public:
+        struct guard {
+          ~guard() {}
+        };
+
+        allocation_registry() noexcept
+          : root_(nullptr)
+        {}
+
+        Info *root() const noexcept
+        {
+          return root_;
+        }
+
+        guard lock(const Info *) noexcept
+        {
+          return{};
+        }
+
+        void insert(Info *info) noexcept
+        {
+          info->shard = 0;
+          info->previous = nullptr;
+          info->next = root_;
+          if (root_) {
+            root_->previous = info;
+          }
+          root_ = info;
+        }
+
+        void erase(Info *info) noexcept
+        {
+          if (info->previous) {
+            info->previous->next = info->next;
+          }
+          if (info->next) {
+            info->next->previous = info->previous;
+          }
+          if (info == root_) {
+            root_ = info->next;
+          }
+        }
+
+        /**
+         * Links the neighbours of the moved element to its new location. The
+         * content of the element must have been copied, e.g. by a reallocation.
+         */
+        void replace(const Info *old, Info *moved) noexcept
+        {
+          if (moved->previous) {
+            moved->previous->next = moved;
+          }
+          if (moved->next) {
+            moved->next->previous = moved;
+          }
+          if (old == root_) {
+            root_ = moved;
+          }
+        }
+
+        template <typename Function>
+        void for_each(Function &&f) const
+        {
+          for (auto info = root_; info != nullptr; info = info->next) {
+            f(*info);
+          }
+        }
+      };
+
+      /**
+       * In the shared variant, each thread inserts into one of number_of_shards
+       * lists, each guarded by its own spin lock. The shard is stored within the
+       * element, so that it can be removed by any thread. As long as the blocks
+       * are freed by the allocating threads, the locks are not contended.
+       * \ingroup group_internal
+       */
+      template <typename Info>
+      class allocation_registry<true, Info>
+      {
+      public:
+        static constexpr unsigned number_of_shards = 16;
+
+      private:
+        struct shard {
+          spin_lock lock;
+          Info *root;
+          char padding[cache_line_size];
+        };
+
+        mutable shard shards_[number_of_shards];
+
+      public:
+        /**
+         * Holds the lock of a shard as long as it exists
+         */
+        class guard {
+          shard *s_;
+
+        public:
+          explicit guard(shard *s) noexcept
+            : s_(s)
+          {
+            s_->lock.lock();
+          }
+
+          guard(guard &&x) noexcept
+            : s_(x.s_)
+          {
+            x.s_ = nullptr;
+          }
+
+          ~guard()
+          {
+            if (s_) {
+              s_->lock.unlock();
+            }
+          }
+
+          guard(const guard &) = delete;
+          guard &operator=(const guard &) = delete;
+        };
+
+        allocation_registry() noexcept
+        {
+          for (auto &s : shards_) {
+            s.root = nullptr;
+          }
+        }
+
+        guard lock(const Info *info) noexcept
+        {
+          return guard(&shards_[info->shard]);
+        }
+
+        void insert(Info *info) noexcept
+        {
+          info->shard = this_thread_shard_index() % number_of_shards;
+          auto &s = shards_[info->shard];
+          s.lock.lock();
+          info->previous = nullptr;
+          info->next = s.root;
+          if (s.root) {
+            s.root->previous = info;
+          }
+          s.root = info;
+          s.lock.unlock();
+        }
+
+        void erase(Info *info) noexcept
+        {
+          auto &s = shards_[info->shard];
+          s.lock.lock();
+          if (info->previous) {
+            info->previous->next = info->next;
+          }
+          if (info->next) {
+            info->next->previous = info->previous;
+          }
+          if (info == s.root) {
+            s.root = info->next;
+          }
+          s.lock.unlock();
+        }
+
+        /**
+         * Same as in the not shared variant, but the caller must hold the lock
+         * of the shard of the old element.
+         */
+        void replace(const Info *old, Info *moved) noexcept
+        {
+          auto &s = shards_[moved->shard];
+          if (moved->previous) {
+            moved->previous->next = moved;
+          }
+          if (moved->next) {
+            moved->next->previous = moved;
+          }
+          if (old == s.root) {
+            s.root = moved;
+          }
+        }
+
+        /**
+         * Calls f for all elements. Each shard is locked while it is visited.
+         */
+        template <typename Function>
+        void for_each(Function &&f) const
+        {
+          for (auto &s : shards_) {
+            s.lock.lock();
+            for (auto info = s.root; info != nullptr; info = info->next) {
+              f(*info);
+            }
+            s.lock.unlock();
+          }
+        }
+      };
+    }
+  }
+  using namespace v_100;
+}
@@ -10,6 +10,7 @@
 #pragma once
 
 #include <type_traits>
+#include <utility>
 #include <stddef.h>
 #include "block.hpp"
 
@@ -40,8 +41,8 @@ namespace alb {
       template <typename T> struct has_deallocate_all 
       {
         template <typename U, void (U::*)()noexcept> struct Check;
-        template <typename U> static bool test(Check<U, &U::deallocate_all> *) { return true; }
-        template <typename U> static bool test(...) { return false; }
+        template <typename U> static constexpr bool test(Check<U, &U::deallocate_all> *) { return true; }
+        template <typename U> static constexpr bool test(...) { return false; }
 
         static constexpr bool value = test<T>(nullptr);
       };
@@ -60,6 +61,25 @@ namespace alb {
         static constexpr bool value = test<T>(nullptr);
       };
 
+      /**
+       * Trait that checks if the given class implements block memory_region() const
+       * In contrast to the traits above, the call expression is checked, so that
+       * an inherited method or a member template is detected as well.
+       *
+       * \ingroup group_traits
+       */
+      template <typename T> struct has_memory_region
+      {
+        template <typename U>
+        static constexpr auto test(U *) -> decltype(std::declval<const U &>().memory_region(), bool())
+        {
+          return true;
+        }
+        template <typename U> static constexpr bool test(...) { return false; }
+
+        static constexpr bool value = test<T>(nullptr);
+      };
+
       /**
        * This traits returns true if both passed types have the same type, resp.
        * template base type
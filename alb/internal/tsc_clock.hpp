@@ -0,0 +1,53 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace alb {
+  inline namespace v_100 {
+    namespace internal {
+
+      /**
+       * Cheap clock for measuring short durations. On x86 it reads the time stamp
+       * counter, on AArch64 the virtual counter and otherwise it falls back to
+       * std::chrono::steady_clock in nanoseconds. The ticks are not converted
+       * into a time unit, because this would cost more than reading the clock.
+       * They are only comparable on the same machine.
+       * \ingroup group_internal
+       */
+      struct tsc_clock {
+        using ticks = uint64_t;
+
+        static ticks now() noexcept
+        {
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+          return __rdtsc();
+#elif defined(__aarch64__)
+          uint64_t result;
+          asm volatile("mrs %0, cntvct_el0" : "=r"(result));
+          return result;
+#else
+          return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+        }
+      };
+    }
+  }
+  using namespace v_100;
+}
@@ -24,6 +24,10 @@ namespace alb {
       static constexpr bool supports_truncated_deallocation = false;
       static constexpr unsigned alignment = 4;
 
+      static constexpr size_t good_size(size_t n) noexcept {
+        return n;
+      }
+
       /**
        * Allocates the specified number of bytes.
        * If the system cannot allocate the specified amount of memory then
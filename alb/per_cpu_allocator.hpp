@@ -0,0 +1,251 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "allocator_base.hpp"
+#include "internal/cpu_index.hpp"
+#include "internal/spin_lock.hpp"
+#include "internal/stats_shards.hpp"
+#include "internal/traits.hpp"
+
+#include <atomic>
+#include <cassert>
+#include <new>
+#include <thread>
+#include <type_traits>
+
+namespace alb {
+  inline namespace v_100 {
+
+    namespace internal {
+      template <class Allocator>
+      bool owns_if_possible(const Allocator &allocator, const block &b,
+                            std::true_type) noexcept
+      {
+        return allocator.owns(b);
+      }
+
+      template <class Allocator>
+      bool owns_if_possible(const Allocator &, const block &, std::false_type) noexcept
+      {
+        return true;
+      }
+    }
+
+    /**
+     * Keeps one instance of a not thread safe Allocator per CPU, instead of
+     * one per thread, so the memory, that is cached e.g. by alb::freelist
+     * instances, is bounded by the number of cores and not by the number of
+     * threads. The instance of a CPU is created on its first use.
+     * The CPU of the calling thread selects the instance; on Linux it is read
+     * from the restartable sequence area of the thread without a system call.
+     * Since the thread may be preempted or moved to an other CPU in the middle
+     * of an operation, and the operations of an arbitrary Allocator cannot be
+     * made a restartable sequence, each instance is guarded by a lock. This is
+     * almost never contended, so it costs one atomic exchange.
+     * A block is returned to the instance of the current CPU, if this owns it.
+     * Otherwise the owning instance is searched. If the Allocator has no
+     * owns(), the blocks of all instances must be interchangeable.
+     * \tparam Allocator The allocator per CPU
+     * \tparam MaxShards The maximum number of instances. CPUs beyond share
+     *         them round robin.
+     *
+     * \ingroup group_allocators group_shared
+     */
+    template <class Allocator, unsigned MaxShards = 64>
+    class per_cpu_allocator {
+      static_assert(MaxShards > 0, "There must be at least one shard!");
+
+      struct shard {
+        internal::spin_lock lock;
+        // Written under the lock, but read by number_of_shards_in_use() without
+        std::atomic<bool> constructed{false};
+        typename std::aligned_storage<sizeof(Allocator), alignof(Allocator)>::type storage;
+        // Keeps the neighbours apart, regardless of the alignment
+        char padding[internal::cache_line_size];
+
+        Allocator &get() noexcept
+        {
+          if (!constructed.load(std::memory_order_relaxed)) {
+            new (&storage) Allocator();
+            constructed.store(true, std::memory_order_release);
+          }
+          return *reinterpret_cast<Allocator *>(&storage);
+        }
+      };
+
+      // owns() must lock the instances, too
+      mutable shard shards_[MaxShards];
+
+      per_cpu_allocator(const per_cpu_allocator &) = delete;
+      per_cpu_allocator &operator=(const per_cpu_allocator &) = delete;
+
+      using has_owns = std::integral_constant<bool, traits::has_owns<Allocator>::value>;
+
+      shard &this_cpu_shard() noexcept
+      {
+        return shards_[internal::current_cpu() % MaxShards];
+      }
+
+      // The holder of a lock may have been preempted on the same CPU, so a
+      // waiting thread gives up its time slice instead of spinning through it
+      class shard_guard {
+        shard &shard_;
+
+      public:
+        explicit shard_guard(shard &s) noexcept
+          : shard_(s)
+        {
+          while (!shard_.lock.try_lock()) {
+            std::this_thread::yield();
+          }
+        }
+
+        ~shard_guard()
+        {
+          shard_.lock.unlock();
+        }
+
+        shard_guard(const shard_guard &) = delete;
+        shard_guard &operator=(const shard_guard &) = delete;
+      };
+
+      // Calls f with the locked instance, that owns the block
+      template <typename F>
+      bool with_owner(const block &b, F f) noexcept
+      {
+        auto &preferred = this_cpu_shard();
+        {
+          shard_guard guard(preferred);
+          if (preferred.constructed &&
+              internal::owns_if_possible(preferred.get(), b, has_owns())) {
+            f(preferred.get());
+            return true;
+          }
+        }
+        for (auto &s : shards_) {
+          if (&s == &preferred) {
+            continue;
+          }
+          shard_guard guard(s);
+          if (s.constructed && internal::owns_if_possible(s.get(), b, has_owns())) {
+            f(s.get());
+            return true;
+          }
+        }
+        return false;
+      }
+
+    public:
+      using allocator = Allocator;
+
+      static constexpr bool supports_truncated_deallocation =
+        Allocator::supports_truncated_deallocation;
+      static constexpr unsigned alignment = Allocator::alignment;
+
+      per_cpu_allocator() noexcept = default;
+
+      ~per_cpu_allocator()
+      {
+        for (auto &s : shards_) {
+          if (s.constructed) {
+            s.get().~Allocator();
+          }
+        }
+      }
+
+      /**
+       * Returns the number of instances, that were created so far
+       */
+      unsigned number_of_shards_in_use() const noexcept
+      {
+        unsigned result = 0;
+        for (auto &s : shards_) {
+          result += s.constructed.load(std::memory_order_acquire) ? 1 : 0;
+        }
+        return result;
+      }
+
+      block allocate(size_t n) noexcept
+      {
+        auto &s = this_cpu_shard();
+        shard_guard guard(s);
+        return s.get().allocate(n);
+      }
+
+      void deallocate(block &b) noexcept
+      {
+        if (!b) {
+          return;
+        }
+        const auto found = with_owner(b, [&b](Allocator &a) { a.deallocate(b); });
+        assert(found);
+        (void)found;
+      }
+
+      bool reallocate(block &b, size_t n) noexcept
+      {
+        if (!b) {
+          b = allocate(n);
+          return n == 0 || static_cast<bool>(b);
+        }
+        bool result = false;
+        with_owner(b, [&](Allocator &a) { result = a.reallocate(b, n); });
+        return result;
+      }
+
+      /**
+       * The method tries to expand the given block by at least delta bytes insito.
+       * This is only available if the underlaying Allocator implements ::expand().
+       */
+      template <typename U = Allocator>
+      typename std::enable_if<traits::has_expand<U>::value, bool>::type
+        expand(block &b, size_t delta) noexcept
+      {
+        bool result = false;
+        with_owner(b, [&](Allocator &a) { result = a.expand(b, delta); });
+        return result;
+      }
+
+      /**
+       * If the underlying Allocator defines ::owns() this method is available.
+       * It returns true, if one of the instances owns the block.
+       */
+      template <typename U = Allocator>
+      typename std::enable_if<traits::has_owns<U>::value, bool>::type
+        owns(const block &b) const noexcept
+      {
+        for (auto &s : shards_) {
+          shard_guard guard(s);
+          if (s.constructed && s.get().owns(b)) {
+            return true;
+          }
+        }
+        return false;
+      }
+
+      /**
+       * Frees all blocks of all instances. Beware of dangling pointers!
+       */
+      template <typename U = Allocator>
+      typename std::enable_if<traits::has_deallocate_all<U>::value, void>::type
+        deallocate_all() noexcept
+      {
+        for (auto &s : shards_) {
+          shard_guard guard(s);
+          if (s.constructed) {
+            s.get().deallocate_all();
+          }
+        }
+      }
+    };
+  }
+  using namespace v_100;
+}
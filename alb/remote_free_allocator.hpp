@@ -0,0 +1,208 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "allocator_base.hpp"
+#include "internal/traits.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <thread>
+#include <type_traits>
+
+namespace alb {
+  inline namespace v_100 {
+    /**
+     * Makes a not thread safe Allocator, e.g. an alb::heap or an alb::freelist,
+     * usable as the allocator of one owner thread, whose blocks may be freed
+     * by any thread, as it happens in a producer-consumer pipeline.
+     * The owner allocates and frees directly. A block that is freed by an other
+     * thread is pushed onto a lock-free multi-producer single-consumer queue of
+     * this allocator, with the queue node written into the block itself. The
+     * owner takes the whole queue with a single exchange on its next
+     * allocation, and returns its blocks in one batch to the Allocator. So the
+     * Allocator itself is only ever used by the owner.
+     * The owner is the constructing thread, or the thread that calls
+     * bind_to_this_thread() before the allocator is shared. The freeing
+     * thread must know the allocator of a block, e.g. by an owns() check of
+     * the instances of all threads, if the Allocator can tell this from an
+     * address range only, like the alb::heap.
+     * All other operations than deallocate() and owns() are only allowed for
+     * the owner.
+     * Each request to the Allocator is at least as large as the queue node of
+     * two words, so that any block can be queued.
+     * \tparam Allocator The not thread safe allocator of the owner
+     *
+     * \ingroup group_allocators group_shared
+     */
+    template <class Allocator>
+    class remote_free_allocator {
+      // Written into the freed blocks
+      struct node {
+        node *next;
+        size_t length;
+      };
+
+      Allocator allocator_;
+      std::thread::id owner_;
+      std::atomic<node *> remoteFrees_;
+
+      remote_free_allocator(const remote_free_allocator &) = delete;
+      remote_free_allocator &operator=(const remote_free_allocator &) = delete;
+
+      bool is_owner() const noexcept
+      {
+        return std::this_thread::get_id() == owner_;
+      }
+
+      size_t drain_queue() noexcept
+      {
+        if (remoteFrees_.load(std::memory_order_relaxed) == nullptr) {
+          return 0;
+        }
+        size_t result = 0;
+        auto n = remoteFrees_.exchange(nullptr, std::memory_order_acquire);
+        while (n) {
+          const auto next = n->next;
+          block b(n, n->length);
+          allocator_.deallocate(b);
+          n = next;
+          ++result;
+        }
+        return result;
+      }
+
+    public:
+      using allocator = Allocator;
+
+      static constexpr bool supports_truncated_deallocation =
+        Allocator::supports_truncated_deallocation;
+      static constexpr unsigned alignment = Allocator::alignment;
+
+      remote_free_allocator() noexcept
+        : owner_(std::this_thread::get_id())
+        , remoteFrees_(nullptr)
+      {
+      }
+
+      // At the end of its life no other thread may use it, so the destructor
+      // may run in any thread
+      ~remote_free_allocator()
+      {
+        drain_queue();
+      }
+
+      /**
+       * Makes the calling thread the owner. This must be done before any other
+       * thread uses this allocator.
+       */
+      void bind_to_this_thread() noexcept
+      {
+        owner_ = std::this_thread::get_id();
+      }
+
+      const Allocator &parent() const noexcept
+      {
+        return allocator_;
+      }
+
+      /**
+       * Returns all blocks, that other threads have freed in the meantime, to
+       * the Allocator. This is done automatically by each allocation, but the
+       * owner may call it, e.g. when it gets idle.
+       * \return The number of returned blocks
+       */
+      size_t drain() noexcept
+      {
+        assert(is_owner());
+        return drain_queue();
+      }
+
+      block allocate(size_t n) noexcept
+      {
+        drain();
+        if (n == 0) {
+          return {};
+        }
+        return allocator_.allocate(std::max(n, sizeof(node)));
+      }
+
+      /**
+       * Frees the block directly, if called by the owner, otherwise it is put
+       * into the queue of the owner. In both cases the block is reset.
+       * \param b The block to free
+       */
+      void deallocate(block &b) noexcept
+      {
+        if (!b) {
+          return;
+        }
+        if (is_owner()) {
+          allocator_.deallocate(b);
+          return;
+        }
+        assert(b.length >= sizeof(node));
+        auto n = static_cast<node *>(b.ptr);
+        n->length = b.length;
+        n->next = remoteFrees_.load(std::memory_order_relaxed);
+        while (!remoteFrees_.compare_exchange_weak(n->next, n, std::memory_order_release,
+                                                   std::memory_order_relaxed)) {
+        }
+        b.reset();
+      }
+
+      bool reallocate(block &b, size_t n) noexcept
+      {
+        assert(is_owner());
+        drain();
+        return allocator_.reallocate(b, n == 0 ? 0 : std::max(n, sizeof(node)));
+      }
+
+      /**
+       * The method tries to expand the given block by at least delta bytes insito.
+       * This is only available if the underlaying Allocator implements ::expand().
+       */
+      template <typename U = Allocator>
+      typename std::enable_if<traits::has_expand<U>::value, bool>::type
+        expand(block &b, size_t delta) noexcept
+      {
+        assert(is_owner());
+        return allocator_.expand(b, delta);
+      }
+
+      /**
+       * If the underlying Allocator defines ::owns() this method is available.
+       * It may be called by any thread, if the Allocator's owns() only reads
+       * data, that does not change after its construction.
+       */
+      template <typename U = Allocator>
+      typename std::enable_if<traits::has_owns<U>::value, bool>::type
+        owns(const block &b) const noexcept
+      {
+        return allocator_.owns(b);
+      }
+
+      /**
+       * Drops the queue and frees all blocks of the Allocator at once. Beware of
+       * dangling pointers and of other threads, that still free blocks!
+       */
+      template <typename U = Allocator>
+      typename std::enable_if<traits::has_deallocate_all<U>::value, void>::type
+        deallocate_all() noexcept
+      {
+        assert(is_owner());
+        remoteFrees_.store(nullptr, std::memory_order_relaxed);
+        allocator_.deallocate_all();
+      }
+    };
+  }
+  using namespace v_100;
+}
@@ -43,6 +43,29 @@ namespace alb {
         (SmallAllocator::alignment > LargeAllocator::alignment) ? 
           SmallAllocator::alignment : LargeAllocator::alignment;
 
+      /**
+       * Returns the allocator for the requests up to the Threshold, e.g. to visit
+       * the statistic of its parts.
+       */
+      const SmallAllocator &small_part() const noexcept {
+        return *this;
+      }
+
+      /**
+       * Returns the allocator for the requests above the Threshold
+       */
+      const LargeAllocator &large_part() const noexcept {
+        return *this;
+      }
+
+      /**
+       * Returns the good size of the allocator that is responsible for n bytes.
+       * This is only available if both allocators implement good_size()
+       */
+      size_t good_size(size_t n) const noexcept {
+        return n <= Threshold ? SmallAllocator::good_size(n) : LargeAllocator::good_size(n);
+      }
+
       /**
        * Allocates the specified number of bytes. If the operation was not
        * successful
@@ -113,8 +136,8 @@ namespace alb {
        * \return True, if the operation was successful
        */
       template <typename U = SmallAllocator, typename V = LargeAllocator>
-      typename std::enable_if<traits::has_expand<SmallAllocator>::value ||
-        traits::has_expand<LargeAllocator>::value, bool>::type
+      typename std::enable_if<traits::has_expand<U>::value ||
+        traits::has_expand<V>::value, bool>::type
         expand(block &b, size_t delta) noexcept {
 
         if (b.length <= Threshold && b.length + delta > Threshold) {
@@ -141,8 +164,8 @@ namespace alb {
        * \return True if one of the allocator owns it.
        */
       template <typename U = SmallAllocator, typename V = LargeAllocator>
-      typename std::enable_if<traits::has_expand<SmallAllocator>::value ||
-        traits::has_expand<LargeAllocator>::value, bool>::type
+      typename std::enable_if<traits::has_owns<U>::value &&
+        traits::has_owns<V>::value, bool>::type
         owns(const block &b) const noexcept {
 
         if (b.length <= Threshold) {
@@ -156,8 +179,8 @@ namespace alb {
        * This is available if one of the allocators implement it.
        */
       template <typename U = SmallAllocator, typename V = LargeAllocator>
-      typename std::enable_if<traits::has_expand<SmallAllocator>::value ||
-        traits::has_expand<LargeAllocator>::value, void>::type
+      typename std::enable_if<traits::has_deallocate_all<U>::value ||
+        traits::has_deallocate_all<V>::value, void>::type
         deallocate_all() noexcept {
         traits::AllDeallocator<U>::do_it(static_cast<U&>(*this));
         traits::AllDeallocator<V>::do_it(static_cast<V&>(*this));
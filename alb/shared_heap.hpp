@@ -124,6 +124,32 @@ namespace alb {
         return chunk_size_.value();
       }
 
+      /**
+       * Returns the length of the block that an allocation of n bytes results in
+       */
+      size_t good_size(size_t n) const noexcept {
+        return internal::round_to_alignment(chunk_size_.value(), n);
+      }
+
+      /**
+       * Returns the complete memory area that is managed by this heap. All
+       * returned blocks are located within it.
+       */
+      block memory_region() const noexcept {
+        return buffer_;
+      }
+
+      /**
+       * Returns the number of free chunks and the length of the longest run of
+       * adjacent free chunks. The registers are read one after the other
+       * without a lock, so with concurrent operations the result is only an
+       * estimate.
+       */
+      helpers::free_chunk_summary free_chunks() const noexcept {
+        return helpers::summarize_free_chunks(
+          controlSize_, [this](size_t i) { return control_[i].load(std::memory_order_relaxed); });
+      }
+
       ~shared_heap() {
         shrink();
       }
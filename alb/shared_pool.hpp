@@ -0,0 +1,189 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "allocator_base.hpp"
+#include "internal/reallocator.hpp"
+#include "internal/stats_shards.hpp"
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+
+namespace alb {
+  inline namespace v_100 {
+    /**
+     * Thread safe, lock-free pool of Capacity objects of Size bytes within the
+     * object itself, so it never calls a parent allocator. The free objects
+     * form a stack of 32 bit indices. Its head is packed together with a
+     * generation counter into a single 64 bit word, so that each push and pop
+     * is one compare-and-swap, and the counter, that changes with every
+     * successful swap, prevents the ABA problem. The links between the free
+     * objects are kept in a separate array of indices, so the content of the
+     * objects is never touched by the pool.
+     * Compared to the alb::shared_freelist, whose stack has a node with a
+     * pointer per entry, this needs four bytes per object.
+     * If the pool is exhausted, the allocation fails, so it is usually combined
+     * with an alb::fallback_allocator.
+     * \tparam Size The size of the objects
+     * \tparam Capacity The number of objects
+     * \tparam Alignment The alignment of the objects
+     *
+     * \ingroup group_allocators group_shared
+     */
+    template <size_t Size, size_t Capacity, size_t Alignment = 16>
+    class shared_pool {
+      static_assert(Size > 0, "The Size must not be 0!");
+      static_assert(Capacity > 0 && Capacity < 0xffffffffu, "The Capacity must fit in 32 bit!");
+      static_assert(Alignment > 0 && (Alignment & (Alignment - 1)) == 0,
+                    "The Alignment must be a power of two!");
+
+      static constexpr uint32_t end_of_list = 0xffffffffu;
+      static constexpr size_t slot_size = (Size + Alignment - 1) / Alignment * Alignment;
+
+      // The index of the first free object in the lower and the generation
+      // in the upper 32 bit
+      std::atomic<uint64_t> head_;
+
+      // Keeps the head apart from the objects, regardless of the alignment
+      char padding_[internal::cache_line_size];
+
+      alignas(Alignment) char data_[slot_size * Capacity];
+
+      // The index of the next free object of each free object
+      std::atomic<uint32_t> next_[Capacity];
+
+      shared_pool(const shared_pool &) = delete;
+      shared_pool &operator=(const shared_pool &) = delete;
+
+      static uint64_t pack(uint64_t generation, uint32_t index) noexcept
+      {
+        return (generation << 32) | index;
+      }
+
+      static uint32_t index_of(uint64_t head) noexcept
+      {
+        return static_cast<uint32_t>(head);
+      }
+
+      static uint64_t next_generation(uint64_t head) noexcept
+      {
+        return (head >> 32) + 1;
+      }
+
+    public:
+      using allocator = shared_pool;
+
+      static constexpr bool supports_truncated_deallocation = true;
+      static constexpr size_t object_size = Size;
+      static constexpr size_t capacity = Capacity;
+      static constexpr unsigned alignment = static_cast<unsigned>(Alignment);
+
+      static constexpr size_t good_size(size_t) noexcept
+      {
+        return Size;
+      }
+
+      shared_pool() noexcept
+      {
+        deallocate_all();
+      }
+
+      /**
+       * Pops an object from the stack of the free objects
+       * \param n The requested size, must be within [1, Size]
+       * \return The block of Size bytes or an empty block, if the pool is
+       *         exhausted
+       */
+      block allocate(size_t n) noexcept
+      {
+        if (n == 0 || n > Size) {
+          return {};
+        }
+        auto head = head_.load(std::memory_order_acquire);
+        for (;;) {
+          const auto index = index_of(head);
+          if (index == end_of_list) {
+            return {};
+          }
+          // If an other thread took the object in the meantime, the swap fails
+          // because of the changed generation
+          const auto next = next_[index].load(std::memory_order_relaxed);
+          if (head_.compare_exchange_weak(head, pack(next_generation(head), next),
+                                          std::memory_order_acquire,
+                                          std::memory_order_acquire)) {
+            return block(data_ + index * slot_size, Size);
+          }
+        }
+      }
+
+      /**
+       * Pushes the object onto the stack of the free objects
+       * \param b The block to free
+       */
+      void deallocate(block &b) noexcept
+      {
+        if (!owns(b)) {
+          return;
+        }
+        const auto index = static_cast<uint32_t>((static_cast<char *>(b.ptr) - data_) / slot_size);
+        assert(static_cast<char *>(b.ptr) == data_ + index * slot_size);
+        auto head = head_.load(std::memory_order_relaxed);
+        do {
+          next_[index].store(index_of(head), std::memory_order_relaxed);
+        } while (!head_.compare_exchange_weak(head, pack(next_generation(head), index),
+                                              std::memory_order_release,
+                                              std::memory_order_relaxed));
+        b.reset();
+      }
+
+      /**
+       * Only the trivial cases and a shrinking, that keeps the object, are
+       * supported
+       */
+      bool reallocate(block &b, size_t n) noexcept
+      {
+        if (internal::is_reallocation_handled_default(*this, b, n)) {
+          return true;
+        }
+        if (n <= Size) {
+          b.length = n;
+          return true;
+        }
+        return false;
+      }
+
+      bool owns(const block &b) const noexcept
+      {
+        return b && data_ <= b.ptr && b.ptr < data_ + sizeof(data_);
+      }
+
+      /**
+       * Returns all objects to the pool. This is not thread safe and beware of
+       * dangling pointers!
+       */
+      void deallocate_all() noexcept
+      {
+        for (size_t i = 0; i + 1 < Capacity; ++i) {
+          next_[i].store(static_cast<uint32_t>(i + 1), std::memory_order_relaxed);
+        }
+        next_[Capacity - 1].store(end_of_list, std::memory_order_relaxed);
+        head_.store(pack(0, 0), std::memory_order_release);
+      }
+    };
+
+    template <size_t Size, size_t Capacity, size_t Alignment>
+    constexpr size_t shared_pool<Size, Capacity, Alignment>::object_size;
+
+    template <size_t Size, size_t Capacity, size_t Alignment>
+    constexpr size_t shared_pool<Size, Capacity, Alignment>::capacity;
+  }
+  using namespace v_100;
+}
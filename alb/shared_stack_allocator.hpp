@@ -0,0 +1,214 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "allocator_base.hpp"
+
+#include <atomic>
+#include <cassert>
+
+namespace alb {
+  inline namespace v_100 {
+    /**
+     * Thread safe variant of the alb::stack_allocator. The memory is reserved
+     * with a single fetch_add on the bump offset, so concurrent allocations never
+     * take a lock. Only the most recent block can be given back or be expanded;
+     * this is done with a CAS on the bump offset, so it fails silently if an other
+     * thread has allocated in the meantime.
+     * If a request does not fit anymore, the reservation is rolled back if no
+     * other thread has moved the offset in between. Otherwise the remaining bytes
+     * at the end stay unused until deallocate_all() is called.
+     * In contrast to the alb::stack_allocator it may live on the heap or in static
+     * storage, so that it can serve as scratch arena for several threads.
+     * \tparam MaxSize The maximum number of bytes that can be allocated by this
+     *         allocator
+     * \tparam Alignment Each memory allocation request by allocate,
+     *         reallocate and expand is aligned by this value
+     *
+     * \ingroup group_allocators group_shared
+     */
+    template <size_t MaxSize, size_t Alignment = 16>
+    class shared_stack_allocator {
+      alignas(Alignment) char _data[MaxSize];
+
+      std::atomic<size_t> _offset;
+
+      size_t offset_of(const void *p) const noexcept {
+        return static_cast<const char *>(p) - _data;
+      }
+
+      /**
+       * Moves the bump offset from the end of b to newEnd, if b is still the
+       * most recently allocated block
+       */
+      bool move_end_of_last_block(const block &b, size_t newEnd) noexcept {
+        auto expected = offset_of(b.ptr) + b.length;
+        return _offset.compare_exchange_strong(expected, newEnd);
+      }
+
+    public:
+      using allocator = shared_stack_allocator;
+
+      static const bool supports_truncated_deallocation = true;
+      static const size_t max_size = MaxSize;
+      static const size_t alignment = Alignment;
+
+      static constexpr size_t good_size(size_t n) noexcept {
+        return internal::round_to_alignment(Alignment, n);
+      }
+
+      shared_stack_allocator() noexcept
+        : _offset(0)
+      {
+      }
+
+      block allocate(size_t n) noexcept {
+        block result;
+
+        if (n == 0 || n > MaxSize) {
+          return result;
+        }
+
+        const auto alignedLength = internal::round_to_alignment(Alignment, n);
+        const auto start = _offset.fetch_add(alignedLength);
+        if (start + alignedLength > MaxSize) { // not enough memory left
+          // roll back, if no other thread has reserved memory in the meantime
+          auto expected = start + alignedLength;
+          _offset.compare_exchange_strong(expected, start);
+          return result;
+        }
+
+        result.ptr = _data + start;
+        result.length = alignedLength;
+        return result;
+      }
+
+      void deallocate(block &b) noexcept {
+        if (!b) {
+          return;
+        }
+        if (!owns(b)) {
+          assert(false);
+          return;
+        }
+
+        // If it was the most recent allocated block, then the memory can be
+        // re-used. Otherwise this freed block is not available for further
+        // allocations until deallocate_all() is called.
+        move_end_of_last_block(b, offset_of(b.ptr));
+        b.reset();
+      }
+
+      bool reallocate(block &b, size_t n) noexcept {
+        if (b.length == n) {
+          return true;
+        }
+
+        if (n == 0) {
+          deallocate(b);
+          return true;
+        }
+
+        if (!b) {
+          b = allocate(n);
+          return true;
+        }
+
+        const auto alignedLength = internal::round_to_alignment(Alignment, n);
+
+        if (offset_of(b.ptr) + alignedLength <= MaxSize &&
+            move_end_of_last_block(b, offset_of(b.ptr) + alignedLength)) {
+          b.length = alignedLength;
+          return true;
+        }
+        if (b.length > n) {
+          b.length = alignedLength;
+          return true;
+        }
+
+        auto newBlock = allocate(alignedLength);
+        // we cannot deallocate the old block, because it is in between used ones,
+        //  so we have to "leak" here.
+        if (newBlock) {
+          internal::block_copy(b, newBlock);
+          b = newBlock;
+          return true;
+        }
+        return false;
+      }
+
+      /**
+       * Expands the given block insito by the amount of bytes
+       * \param b The block that should be expanded
+       * \param delta The amount of bytes that should be appended
+       * \return true, if the operation was successful or false if not enough
+       *         memory is left or an other block was allocated behind b
+       */
+      bool expand(block &b, size_t delta) noexcept {
+        if (delta == 0) {
+          return true;
+        }
+        if (!b) {
+          b = allocate(delta);
+          return b.length != 0;
+        }
+        const auto alignedBytes = internal::round_to_alignment(Alignment, delta);
+        const auto newEnd = offset_of(b.ptr) + b.length + alignedBytes;
+        if (newEnd > MaxSize) {
+          return false;
+        }
+        if (!move_end_of_last_block(b, newEnd)) {
+          return false;
+        }
+        b.length += alignedBytes;
+        return true;
+      }
+
+      /**
+       * Returns true, if the provided block was allocated previously with this
+       * allocator
+       * \param b The block to be checked.
+       */
+      bool owns(const block &b) const noexcept {
+        return b && (b.ptr >= _data && b.ptr < _data + MaxSize);
+      }
+
+      /**
+       * Sets all possibly provided memory to free. This is intended for epoch
+       * like resets, when all threads have finished their work on the arena.
+       * Be warned that all usage of previously allocated blocks results in
+       * unpredictable results!
+       */
+      void deallocate_all() noexcept {
+        _offset.store(0);
+      }
+
+      /**
+       * Returns the number of bytes currently reserved
+       */
+      size_t used() const noexcept {
+        const auto offset = _offset.load();
+        return offset < MaxSize ? offset : MaxSize;
+      }
+
+    private:
+      shared_stack_allocator(shared_stack_allocator &&) = delete;
+      shared_stack_allocator &operator=(shared_stack_allocator &&) = delete;
+      shared_stack_allocator(const shared_stack_allocator &) = delete;
+      shared_stack_allocator &operator=(const shared_stack_allocator &) = delete;
+    };
+
+    template <size_t MaxSize, size_t Alignment>
+    const size_t shared_stack_allocator<MaxSize, Alignment>::max_size;
+    template <size_t MaxSize, size_t Alignment>
+    const size_t shared_stack_allocator<MaxSize, Alignment>::alignment;
+  }
+  using namespace v_100;
+}
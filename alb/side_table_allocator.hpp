@@ -0,0 +1,294 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+//////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "allocator_base.hpp"
+#include "affix_allocator.hpp"
+#include "mallocator.hpp"
+#include "internal/affix_helper.hpp"
+#include "internal/dynastic.hpp"
+#include "internal/reallocator.hpp"
+#include "internal/traits.hpp"
+
+#include <utility>
+
+namespace alb {
+  inline namespace v_100 {
+
+    namespace internal {
+      /**
+       * Returns the smallest length of a block that the given allocator hands out.
+       * For heaps this is the chunk size, for free lists the upper bound.
+       * \ingroup group_internal
+       */
+      template <class Allocator>
+      auto block_granularity(const Allocator &a, int) noexcept -> decltype(a.chunk_size())
+      {
+        return a.chunk_size();
+      }
+
+      template <class Allocator>
+      auto block_granularity(const Allocator &a, long) noexcept -> decltype(a.max_size())
+      {
+        return a.max_size();
+      }
+    }
+
+    /**
+     * This allocator stores an object of type Metadata per allocated block, like
+     * the alb::affix_allocator does with its Prefix. But instead of placing it in
+     * front of the block, it is kept out of band in a table with one entry per
+     * chunk of the underlying Allocator. So the returned blocks are neither shifted
+     * nor padded and the user's cache lines are not touched by the metadata.
+     * The Allocator must implement memory_region(), e.g. alb::heap,
+     * alb::shared_heap or an alb::freelist on top of one of them. The table has
+     * one entry per chunk of the heap resp. per block of the free list and it is
+     * allocated with the TableAllocator.
+     * The table is created during construction, or for a free list with runtime
+     * set boundaries, with the first allocation. (The latter is not thread safe.)
+     * \tparam Allocator The allocator that is used as underlying allocator
+     * \tparam Metadata An object of this type is constructed for every allocated
+     *                  block and destroyed during its deallocation
+     * \tparam TableAllocator This allocator provides the memory of the table
+     *
+     * \ingroup group_allocators group_shared
+     */
+    template <class Allocator, typename Metadata, class TableAllocator = mallocator>
+    class side_table_allocator
+    {
+      static_assert(traits::has_memory_region<Allocator>::value,
+        "The Allocator must provide its memory_region()!");
+
+      Allocator allocator_;
+      TableAllocator tableAllocator_;
+      block table_;
+      block region_;
+      size_t granularity_;
+
+      // Returns false, if the table could not be created
+      bool create_table() noexcept
+      {
+        region_ = allocator_.memory_region();
+        granularity_ = internal::block_granularity(allocator_, 0);
+        if (!region_ || granularity_ == 0 || granularity_ == internal::DynasticUndefined) {
+          return false;
+        }
+        table_ = tableAllocator_.allocate(sizeof(Metadata) * (region_.length / granularity_ + 1));
+        return static_cast<bool>(table_);
+      }
+
+      size_t index_of(const block &b) const noexcept
+      {
+        return (static_cast<char *>(b.ptr) - static_cast<char *>(region_.ptr)) / granularity_;
+      }
+
+      void create_metadata(const block &b) noexcept
+      {
+        affix_helper::create_affix_in_place<Metadata>(metadata(b), *this);
+      }
+
+      void destroy_metadata(const block &b) noexcept
+      {
+        metadata(b)->~Metadata();
+      }
+
+    public:
+      side_table_allocator(const side_table_allocator &) = delete;
+      side_table_allocator &operator=(const side_table_allocator &) = delete;
+
+      static constexpr bool supports_truncated_deallocation = Allocator::supports_truncated_deallocation;
+      static constexpr unsigned alignment = Allocator::alignment;
+
+      using allocator = Allocator;
+      using prefix = Metadata;
+      using metadata_type = Metadata;
+
+      const Allocator &parent() const noexcept
+      {
+        return allocator_;
+      }
+
+      side_table_allocator() noexcept
+        : granularity_(0)
+      {
+        create_table();
+      }
+
+      ~side_table_allocator()
+      {
+        tableAllocator_.deallocate(table_);
+      }
+
+      /**
+       * Returns the metadata of the given block.
+       * \param b The block that was allocated by this allocator. The result is
+       *          absolute unpredictable if a block is passed, that is not owned
+       *          by this allocator!
+       * \return Pointer to the table entry of the given block
+       */
+      Metadata *metadata(const block &b) const noexcept
+      {
+        return b ? static_cast<Metadata *>(table_.ptr) + index_of(b) : nullptr;
+      }
+
+      /**
+       * Same as metadata(). It exists for compatibility to the alb::affix_allocator
+       * so that this allocator can be used as a drop-in replacement.
+       */
+      Metadata *outer_to_prefix(const block &b) const noexcept
+      {
+        return metadata(b);
+      }
+
+      /**
+       * Allocates a block of n bytes by the underlying Allocator and constructs the
+       * table entry of it. Without a table nothing is allocated.
+       * \param n Specifies the number of requested bytes.
+       */
+      block allocate(size_t n) noexcept
+      {
+        if (n == 0) {
+          return{};
+        }
+        if (!table_ && !create_table()) {
+          return{};
+        }
+        auto result = allocator_.allocate(n);
+        if (result) {
+          create_metadata(result);
+        }
+        return result;
+      }
+
+      /**
+       * The table entry of the given block is destroyed and the block is
+       * deallocated by the underlying Allocator.
+       * \param b The block that should be freed.
+       */
+      void deallocate(block &b) noexcept
+      {
+        if (!b) {
+          return;
+        }
+        destroy_metadata(b);
+        allocator_.deallocate(b);
+      }
+
+      /**
+       * The given block gets reallocated to the new provided size n. If the block
+       * is moved, then its metadata is moved to the corresponding table entry.
+       * \param b The block that should be resized
+       * \param n The new size (n = zero means a deallocation)
+       * \return True if the operation was successful
+       */
+      bool reallocate(block &b, size_t n) noexcept
+      {
+        if (b.length == n) {
+          return true;
+        }
+        if (n == 0) {
+          deallocate(b);
+          return true;
+        }
+        if (!b) {
+          b = allocate(n);
+          return static_cast<bool>(b);
+        }
+
+        if (n < b.length) {
+          // heaps shrink in place
+          if (!allocator_.reallocate(b, n)) {
+            return false;
+          }
+          return true;
+        }
+        if (traits::Expander<Allocator>::do_it(allocator_, b, n - b.length)) {
+          return true;
+        }
+
+        // The move is done here and not by the Allocator, so that the old table
+        // entry is still valid until the old block is freed.
+        auto newBlock = allocator_.allocate(n);
+        if (!newBlock) {
+          return false;
+        }
+        internal::block_copy(b, newBlock);
+        new (metadata(newBlock)) Metadata(std::move(*metadata(b)));
+        destroy_metadata(b);
+        allocator_.deallocate(b);
+        b = newBlock;
+        return true;
+      }
+
+      /**
+       * The method tries to expand the given block by at least delta bytes insito.
+       * This is only available if the underlaying Allocator implements ::expand().
+       * \param b The block that should be expanded
+       * \param delta The number of bytes that the given block should be increased
+       * \return True, if the operation was successful.
+       */
+      template <typename U = Allocator>
+      typename std::enable_if<traits::has_expand<U>::value, bool>::type
+        expand(block &b, size_t delta) noexcept
+      {
+        if (delta == 0) {
+          return true;
+        }
+        if (!b) {
+          b = allocate(delta);
+          return static_cast<bool>(b);
+        }
+        return allocator_.expand(b, delta);
+      }
+
+      /**
+       * If the underlying Allocator defines ::owns() this method is available.
+       * It returns true, if the given block is owned by this allocator.
+       * \param b The Block that should be checked for ownership
+       */
+      template <typename U = Allocator>
+      typename std::enable_if<traits::has_owns<U>::value, bool>::type
+        owns(const block &b) const noexcept
+      {
+        return allocator_.owns(b);
+      }
+
+      /**
+       * Returns the memory area of the underlying allocator
+       */
+      block memory_region() const noexcept
+      {
+        return allocator_.memory_region();
+      }
+    };
+
+    namespace traits {
+      template <class A, typename Metadata, class TableAllocator, typename T>
+      struct affix_extractor<side_table_allocator<A, Metadata, TableAllocator>, T> {
+        static Metadata *prefix(side_table_allocator<A, Metadata, TableAllocator> &allocator,
+          const block &b) noexcept
+        {
+          return allocator.metadata(b);
+        }
+      };
+
+      /**
+       * An allocator_with_stats on top of a side_table_allocator stores its
+       * per allocation information in the side table instead of a prefix.
+       * \ingroup group_traits
+       */
+      template <class A, typename Metadata, class TableAllocator, typename T>
+      struct per_allocation_store<side_table_allocator<A, Metadata, TableAllocator>, T> {
+        using type = side_table_allocator<A, T, TableAllocator>;
+      };
+    }
+  }
+  using namespace v_100;
+}
@@ -0,0 +1,355 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "allocator_base.hpp"
+#include "internal/heap_helpers.hpp"
+#include "internal/reallocator.hpp"
+#include "internal/traits.hpp"
+
+#include <cassert>
+#include <cstdint>
+
+namespace alb {
+  inline namespace v_100 {
+
+    /**
+     * This allocator hands out objects of ObjectSize bytes from slabs of
+     * SlabSize bytes, that it takes from the Allocator. Each slab starts with a
+     * header with a bitmap of its free objects, in which, like in alb::heap, a
+     * set bit marks a free object, followed by the densely packed objects.
+     * The slabs are kept in lists by the number of their used objects, so an
+     * allocation always takes an object of the fullest partially used slab in
+     * O(1) and the objects stay packed in as few slabs as possible. Slabs that
+     * become empty are returned to the Allocator, except MaxEmptySlabs that are
+     * kept to avoid a thrashing at the boundary.
+     * The slab of an object is found by masking its address, so the Allocator
+     * must return blocks that are aligned to SlabSize, e.g.
+     * alb::aligned_mallocator<SlabSize>. Otherwise the allocation fails.
+     * owns() reads the header of the slab of the block. With a SlabSize up to
+     * the page size, this is always mapped memory, so owns() can be used on
+     * foreign blocks, e.g. within an alb::fallback_allocator.
+     * \tparam Allocator The allocator that provides the slabs
+     * \tparam ObjectSize The size of all objects
+     * \tparam SlabSize The size and the alignment of the slabs, a power of two
+     * \tparam MaxEmptySlabs The number of empty slabs, that are kept
+     *
+     * \ingroup group_allocators
+     */
+    template <class Allocator, size_t ObjectSize, size_t SlabSize = 4096,
+              size_t MaxEmptySlabs = 1>
+    class slab_allocator {
+      static_assert(SlabSize > 0 && (SlabSize & (SlabSize - 1)) == 0,
+                    "The SlabSize must be a power of two!");
+      static_assert(ObjectSize > 0, "The ObjectSize must not be 0!");
+
+      static constexpr size_t round_up_16(size_t n)
+      {
+        return (n + 15) / 16 * 16;
+      }
+
+      // owner, prev, next, used and then the bitmap
+      static constexpr size_t header_size(size_t numberOfObjects)
+      {
+        return round_up_16(4 * sizeof(void *) + (numberOfObjects + 63) / 64 * sizeof(uint64_t));
+      }
+
+      static constexpr size_t max_number_of_objects()
+      {
+        size_t n = SlabSize / ObjectSize;
+        while (n > 0 && header_size(n) + n * ObjectSize > SlabSize) {
+          --n;
+        }
+        return n;
+      }
+
+    public:
+      static constexpr size_t object_size = ObjectSize;
+      static constexpr size_t slab_size = SlabSize;
+      static constexpr size_t objects_per_slab = max_number_of_objects();
+      static constexpr bool supports_truncated_deallocation = false;
+      static constexpr unsigned alignment =
+        (ObjectSize & (~ObjectSize + 1)) < 16 ? static_cast<unsigned>(ObjectSize & (~ObjectSize + 1))
+                                              : 16;
+
+      static_assert(objects_per_slab > 1, "The SlabSize is too small for the ObjectSize!");
+
+    private:
+      static constexpr size_t number_of_registers = (objects_per_slab + 63) / 64;
+      // The lists of the slabs with 0, 1, ... objects_per_slab used objects
+      static constexpr size_t number_of_lists = objects_per_slab + 1;
+
+      struct slab {
+        const void *owner;
+        slab *prev;
+        slab *next;
+        size_t used;
+        uint64_t control[number_of_registers];
+      };
+
+      static constexpr size_t objects_offset = round_up_16(sizeof(slab));
+      static_assert(objects_offset + objects_per_slab * ObjectSize <= SlabSize,
+                    "The header of the slab does not fit!");
+
+      Allocator allocator_;
+      slab *lists_[number_of_lists];
+      // A set bit marks a non empty list
+      uint64_t occupied_[(number_of_lists + 63) / 64];
+      size_t numberOfSlabs_;
+      size_t numberOfEmptySlabs_;
+
+      slab_allocator(const slab_allocator &) = delete;
+      slab_allocator &operator=(const slab_allocator &) = delete;
+
+      static slab *slab_of(const void *p) noexcept
+      {
+        return reinterpret_cast<slab *>(reinterpret_cast<uintptr_t>(p) & ~uintptr_t(SlabSize - 1));
+      }
+
+      static char *objects_of(slab *s) noexcept
+      {
+        return reinterpret_cast<char *>(s) + objects_offset;
+      }
+
+      void push(slab *s) noexcept
+      {
+        auto &head = lists_[s->used];
+        s->prev = nullptr;
+        s->next = head;
+        if (head) {
+          head->prev = s;
+        }
+        head = s;
+        occupied_[s->used / 64] |= uint64_t(1) << (s->used % 64);
+        if (s->used == 0) {
+          ++numberOfEmptySlabs_;
+        }
+      }
+
+      void unlink(slab *s) noexcept
+      {
+        if (s->prev) {
+          s->prev->next = s->next;
+        }
+        else {
+          lists_[s->used] = s->next;
+          if (!s->next) {
+            occupied_[s->used / 64] &= ~(uint64_t(1) << (s->used % 64));
+          }
+        }
+        if (s->next) {
+          s->next->prev = s->prev;
+        }
+        if (s->used == 0) {
+          --numberOfEmptySlabs_;
+        }
+      }
+
+      // Returns the slab with the most used objects, that has a free one
+      slab *fullest_partial_slab() const noexcept
+      {
+        const size_t last = objects_per_slab - 1;
+        for (size_t r = last / 64 + 1; r > 0; --r) {
+          auto currentRegister = occupied_[r - 1];
+          if (r - 1 == last / 64 && last % 64 != 63) {
+            currentRegister &= (uint64_t(2) << (last % 64)) - 1;
+          }
+          if (r == 1) {
+            // the empty slabs
+            currentRegister &= ~uint64_t(1);
+          }
+          if (currentRegister != 0) {
+            return lists_[(r - 1) * 64 + helpers::highest_set_bit(currentRegister)];
+          }
+        }
+        return nullptr;
+      }
+
+      slab *create_slab() noexcept
+      {
+        auto b = allocator_.allocate(SlabSize);
+        if (!b) {
+          return nullptr;
+        }
+        // The Allocator must return blocks aligned to the SlabSize
+        if ((reinterpret_cast<uintptr_t>(b.ptr) & (SlabSize - 1)) != 0) {
+          allocator_.deallocate(b);
+          return nullptr;
+        }
+        auto s = static_cast<slab *>(b.ptr);
+        s->owner = this;
+        s->used = 0;
+        for (auto &r : s->control) {
+          r = uint64_t(-1);
+        }
+        if (objects_per_slab % 64 != 0) {
+          s->control[number_of_registers - 1] = (uint64_t(1) << (objects_per_slab % 64)) - 1;
+        }
+        ++numberOfSlabs_;
+        push(s);
+        return s;
+      }
+
+      void release(slab *s) noexcept
+      {
+        unlink(s);
+        block b(s, SlabSize);
+        allocator_.deallocate(b);
+        --numberOfSlabs_;
+      }
+
+      void release_all() noexcept
+      {
+        for (auto &head : lists_) {
+          while (head) {
+            release(head);
+          }
+        }
+      }
+
+    public:
+      using allocator = Allocator;
+
+      slab_allocator() noexcept
+        : lists_()
+        , occupied_()
+        , numberOfSlabs_(0)
+        , numberOfEmptySlabs_(0)
+      {
+      }
+
+      ~slab_allocator()
+      {
+        release_all();
+      }
+
+      const Allocator &parent() const noexcept
+      {
+        return allocator_;
+      }
+
+      static constexpr size_t good_size(size_t) noexcept
+      {
+        return ObjectSize;
+      }
+
+      /**
+       * Returns an object of the fullest partially used slab, of an empty slab
+       * or of a new slab.
+       * \param n The requested size, must be within [1, ObjectSize]
+       * \return The block of ObjectSize bytes or an empty block
+       */
+      block allocate(size_t n) noexcept
+      {
+        if (n == 0 || n > ObjectSize) {
+          return {};
+        }
+        auto s = fullest_partial_slab();
+        if (!s) {
+          s = lists_[0] ? lists_[0] : create_slab();
+          if (!s) {
+            return {};
+          }
+        }
+        size_t r = 0;
+        while (s->control[r] == 0) {
+          ++r;
+        }
+        const auto bit = helpers::lowest_set_bit(s->control[r]);
+        s->control[r] = helpers::set_used<false>(s->control[r], uint64_t(1) << bit);
+
+        unlink(s);
+        ++s->used;
+        push(s);
+        return block(objects_of(s) + (r * 64 + bit) * ObjectSize, ObjectSize);
+      }
+
+      /**
+       * Frees the object. If its slab becomes empty and there are already
+       * MaxEmptySlabs empty slabs, the slab is returned to the Allocator.
+       * \param b The block to free
+       */
+      void deallocate(block &b) noexcept
+      {
+        if (!b) {
+          return;
+        }
+        assert(owns(b));
+        auto s = slab_of(b.ptr);
+        const auto index =
+          static_cast<size_t>(static_cast<char *>(b.ptr) - objects_of(s)) / ObjectSize;
+        s->control[index / 64] = helpers::set_used<true>(s->control[index / 64],
+                                                          uint64_t(1) << (index % 64));
+        unlink(s);
+        --s->used;
+        if (s->used == 0 && numberOfEmptySlabs_ >= MaxEmptySlabs) {
+          block slabBlock(s, SlabSize);
+          allocator_.deallocate(slabBlock);
+          --numberOfSlabs_;
+        }
+        else {
+          push(s);
+        }
+        b.reset();
+      }
+
+      /**
+       * Only the trivial cases and a shrinking, that keeps the object, are
+       * supported
+       */
+      bool reallocate(block &b, size_t n) noexcept
+      {
+        if (internal::is_reallocation_handled_default(*this, b, n)) {
+          return true;
+        }
+        return n <= ObjectSize;
+      }
+
+      /**
+       * Checks, if the block is an object of one of the slabs of this allocator
+       */
+      bool owns(const block &b) const noexcept
+      {
+        return b && b.length == ObjectSize && slab_of(b.ptr)->owner == this;
+      }
+
+      /**
+       * Returns all slabs to the Allocator. Beware of dangling pointers!
+       */
+      void deallocate_all() noexcept
+      {
+        release_all();
+      }
+
+      /**
+       * Returns the number of slabs, including the empty ones
+       */
+      size_t number_of_slabs() const noexcept
+      {
+        return numberOfSlabs_;
+      }
+
+      size_t number_of_empty_slabs() const noexcept
+      {
+        return numberOfEmptySlabs_;
+      }
+    };
+
+    template <class Allocator, size_t ObjectSize, size_t SlabSize, size_t MaxEmptySlabs>
+    constexpr size_t slab_allocator<Allocator, ObjectSize, SlabSize, MaxEmptySlabs>::object_size;
+
+    template <class Allocator, size_t ObjectSize, size_t SlabSize, size_t MaxEmptySlabs>
+    constexpr size_t slab_allocator<Allocator, ObjectSize, SlabSize, MaxEmptySlabs>::slab_size;
+
+    template <class Allocator, size_t ObjectSize, size_t SlabSize, size_t MaxEmptySlabs>
+    constexpr size_t slab_allocator<Allocator, ObjectSize, SlabSize, MaxEmptySlabs>::objects_per_slab;
+  }
+  using namespace v_100;
+}
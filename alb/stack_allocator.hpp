@@ -41,6 +41,10 @@ namespace alb {
       static const size_t max_size = MaxSize;
       static const size_t alignment = Alignment;
 
+      static constexpr size_t good_size(size_t n) noexcept {
+        return internal::round_to_alignment(Alignment, n);
+      }
+
       stack_allocator() noexcept
         : _p(_data)
       {
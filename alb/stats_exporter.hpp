@@ -0,0 +1,317 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "allocator_with_stats.hpp"
+#include "stats_tree.hpp"
+#include "internal/stats_fields.hpp"
+
+#include <cstdarg>
+#include <cstdio>
+
+namespace alb {
+  inline namespace v_100 {
+    namespace internal {
+
+      /**
+       * Appends formatted text to a caller provided buffer. It counts all bytes,
+       * also the ones that did not fit, so that the caller can learn the needed
+       * size. The buffer is always null terminated, as long as it is not empty.
+       * \ingroup group_internal
+       */
+      class text_writer {
+        char *buffer_;
+        size_t size_;
+        size_t length_;
+
+      public:
+        text_writer(char *buffer, size_t size) noexcept
+          : buffer_(buffer)
+          , size_(size)
+          , length_(0)
+        {
+          if (size_ > 0) {
+            buffer_[0] = '\0';
+          }
+        }
+
+        void append(const char *format, ...) noexcept
+        {
+          const auto free = length_ < size_ ? size_ - length_ : 0;
+          va_list args;
+          va_start(args, format);
+          const auto written =
+            ::vsnprintf(free > 0 ? buffer_ + length_ : nullptr, free, format, args);
+          va_end(args);
+          if (written > 0) {
+            length_ += written;
+          }
+        }
+
+        size_t length() const noexcept
+        {
+          return length_;
+        }
+      };
+
+      inline void write_json_object(text_writer &out, const stats_snapshot &s) noexcept
+      {
+        const char *separator = "";
+#define ALB_WRITE_JSON_FIELD(name, isCounter)                                  \
+  out.append("%s\"" #name "\":%zu", separator, s.name);                        \
+  separator = ",";
+        out.append("{");
+        ALB_STATS_SNAPSHOT_FIELDS(ALB_WRITE_JSON_FIELD)
+#undef ALB_WRITE_JSON_FIELD
+      }
+
+      inline void write_json_array(text_writer &out, const char *name, const size_t *values,
+                                   unsigned count) noexcept
+      {
+        out.append(",\"%s\":[", name);
+        for (unsigned i = 0; i < count; ++i) {
+          out.append(i == 0 ? "%zu" : ",%zu", values[i]);
+        }
+        out.append("]");
+      }
+
+      inline void write_prometheus_sample(text_writer &out, const char *prefix, const char *name,
+                                          const char *node, size_t value) noexcept
+      {
+        if (node) {
+          out.append("%s_%s{node=\"%s\"} %zu\n", prefix, name, node, value);
+        }
+        else {
+          out.append("%s_%s %zu\n", prefix, name, value);
+        }
+      }
+
+      inline void write_prometheus_histogram(text_writer &out, const char *prefix, const char *name,
+                                             const char *label, const size_t *values,
+                                             unsigned count) noexcept
+      {
+        out.append("# TYPE %s_%s counter\n", prefix, name);
+        for (unsigned i = 0; i < count; ++i) {
+          if (values[i] != 0) {
+            out.append("%s_%s{%s=\"%u\"} %zu\n", prefix, name, label, i, values[i]);
+          }
+        }
+      }
+
+      template <class Stats>
+      void write_histograms_json(text_writer &out, const Stats &stats) noexcept
+      {
+        size_t values[3 * number_of_size_classes];
+        if (Stats::flags & StatsOptions::SizeHistogram) {
+          for (unsigned i = 0; i < number_of_size_classes; ++i) {
+            values[i] = stats.size_histogram(i);
+          }
+          write_json_array(out, "size_histogram", values, number_of_size_classes);
+        }
+        if (Stats::flags & StatsOptions::SlackHistogram) {
+          for (unsigned i = 0; i < number_of_size_classes; ++i) {
+            values[i] = stats.slack_histogram(i);
+          }
+          write_json_array(out, "slack_histogram", values, number_of_size_classes);
+        }
+        if (Stats::flags & StatsOptions::LatencyHistogram) {
+          const char *names[] = {"allocate_latency_histogram", "deallocate_latency_histogram",
+                                 "reallocate_latency_histogram"};
+          for (unsigned op = 0; op < 3; ++op) {
+            for (unsigned i = 0; i < number_of_size_classes; ++i) {
+              values[i] = stats.latency_histogram(static_cast<stats_operation>(op), i);
+            }
+            write_json_array(out, names[op], values, number_of_size_classes);
+          }
+        }
+      }
+
+      template <class Stats>
+      void write_histograms_prometheus(text_writer &out, const char *prefix,
+                                       const Stats &stats) noexcept
+      {
+        size_t values[number_of_size_classes];
+        if (Stats::flags & StatsOptions::SizeHistogram) {
+          for (unsigned i = 0; i < number_of_size_classes; ++i) {
+            values[i] = stats.size_histogram(i);
+          }
+          write_prometheus_histogram(out, prefix, "requests_total", "size_class", values,
+                                     number_of_size_classes);
+        }
+        if (Stats::flags & StatsOptions::SlackHistogram) {
+          for (unsigned i = 0; i < number_of_size_classes; ++i) {
+            values[i] = stats.slack_histogram(i);
+          }
+          write_prometheus_histogram(out, prefix, "slack_bytes_total", "size_class", values,
+                                     number_of_size_classes);
+        }
+        if (Stats::flags & StatsOptions::LatencyHistogram) {
+          const char *names[] = {"allocate_latency_total", "deallocate_latency_total",
+                                 "reallocate_latency_total"};
+          for (unsigned op = 0; op < 3; ++op) {
+            for (unsigned i = 0; i < number_of_size_classes; ++i) {
+              values[i] = stats.latency_histogram(static_cast<stats_operation>(op), i);
+            }
+            write_prometheus_histogram(out, prefix, names[op], "tick_class", values,
+                                       number_of_size_classes);
+          }
+        }
+      }
+    }
+
+    /**
+     * Writes all counters of the snapshot as one JSON object into the buffer,
+     * e.g. {"num_owns":0,"num_allocate":5,...}.
+     * Nothing is allocated. Like snprintf the result is truncated, if the buffer
+     * is too small, and always null terminated.
+     * \param buffer The destination
+     * \param size The size of the buffer in bytes
+     * \param s The counters
+     * \return The length of the complete text, without the terminating null
+     *
+     * \ingroup group_stats
+     */
+    inline size_t write_json(char *buffer, size_t size, const stats_snapshot &s) noexcept
+    {
+      internal::text_writer out(buffer, size);
+      internal::write_json_object(out, s);
+      out.append("}");
+      return out.length();
+    }
+
+    /**
+     * Same as above, but with all enabled histograms of the allocator as
+     * additional arrays with one element per size, resp. tick class.
+     *
+     * \ingroup group_stats
+     */
+    template <bool Shared, class Allocator, unsigned Flags>
+    size_t write_json(char *buffer, size_t size,
+                      const allocator_with_stats_base<Shared, Allocator, Flags> &stats) noexcept
+    {
+      internal::text_writer out(buffer, size);
+      internal::write_json_object(out, stats.snapshot());
+      internal::write_histograms_json(out, stats);
+      out.append("}");
+      return out.length();
+    }
+
+    /**
+     * Writes the counters of the snapshot in the Prometheus text exposition
+     * format into the buffer, e.g. "alb_num_allocate 5". The bytes_high_tide is
+     * typed as gauge, all others as counters.
+     * \param buffer The destination
+     * \param size The size of the buffer in bytes
+     * \param s The counters
+     * \param prefix The prefix of all metric names
+     * \return The length of the complete text, without the terminating null
+     *
+     * \ingroup group_stats
+     */
+    inline size_t write_prometheus(char *buffer, size_t size, const stats_snapshot &s,
+                                   const char *prefix = "alb") noexcept
+    {
+      internal::text_writer out(buffer, size);
+#define ALB_WRITE_PROMETHEUS_FIELD(name, isCounter)                            \
+  out.append("# TYPE %s_" #name " %s\n", prefix, isCounter ? "counter" : "gauge"); \
+  internal::write_prometheus_sample(out, prefix, #name, nullptr, s.name);
+      ALB_STATS_SNAPSHOT_FIELDS(ALB_WRITE_PROMETHEUS_FIELD)
+#undef ALB_WRITE_PROMETHEUS_FIELD
+      return out.length();
+    }
+
+    /**
+     * Same as above, but with all enabled histograms of the allocator. Each
+     * histogram is written as counter with the class as label, e.g.
+     * alb_requests_total{size_class="4"}, and only classes with a value are
+     * listed.
+     *
+     * \ingroup group_stats
+     */
+    template <bool Shared, class Allocator, unsigned Flags>
+    size_t write_prometheus(char *buffer, size_t size,
+                            const allocator_with_stats_base<Shared, Allocator, Flags> &stats,
+                            const char *prefix = "alb") noexcept
+    {
+      const auto length = write_prometheus(buffer, size, stats.snapshot(), prefix);
+      internal::text_writer out(length < size ? buffer + length : nullptr,
+                                length < size ? size - length : 0);
+      internal::write_histograms_prometheus(out, prefix, stats);
+      return length + out.length();
+    }
+
+    /**
+     * Writes the counters of all alb::allocator_with_stats within the composed
+     * allocator, see alb::for_each_stats_node, as one JSON object with the paths
+     * of the nodes as keys, e.g. {"/small/bucket[0]":{"num_owns":0,...},...}.
+     * \return The length of the complete text, without the terminating null
+     *
+     * \ingroup group_stats
+     */
+    template <class Allocator>
+    size_t write_json_tree(char *buffer, size_t size, const Allocator &allocator) noexcept
+    {
+      internal::text_writer out(buffer, size);
+      const char *separator = "{";
+      for_each_stats_node(allocator, [&](const char *path, const stats_snapshot &s) {
+        out.append("%s\"%s\":", separator, path);
+        internal::write_json_object(out, s);
+        out.append("}");
+        separator = ",";
+      });
+      out.append(*separator == '{' ? "{}" : "}");
+      return out.length();
+    }
+
+    /**
+     * Writes the counters of all alb::allocator_with_stats within the composed
+     * allocator in the Prometheus text exposition format. The path of each node
+     * is its label, e.g. alb_num_allocate{node="/large/fallback"} 3
+     * Each node is snapshotted once, before anything is written, so all counters
+     * of a node are from the same moment. The snapshots are kept on the stack,
+     * so the export does not allocate.
+     * \tparam MaxNodes The number of nodes that are exported, further ones are
+     *         omitted
+     * \return The length of the complete text, without the terminating null
+     *
+     * \ingroup group_stats
+     */
+    template <size_t MaxNodes = 64, class Allocator>
+    size_t write_prometheus_tree(char *buffer, size_t size, const Allocator &allocator,
+                                 const char *prefix = "alb") noexcept
+    {
+      struct node {
+        char path[internal::stats_path::max_length];
+        stats_snapshot snapshot;
+      };
+      node nodes[MaxNodes];
+      size_t count = 0;
+      for_each_stats_node(allocator, [&](const char *path, const stats_snapshot &s) {
+        if (count < MaxNodes) {
+          ::snprintf(nodes[count].path, sizeof(nodes[count].path), "%s", path);
+          nodes[count].snapshot = s;
+          ++count;
+        }
+      });
+
+      internal::text_writer out(buffer, size);
+#define ALB_WRITE_PROMETHEUS_FIELD(name, isCounter)                            \
+  out.append("# TYPE %s_" #name " %s\n", prefix, isCounter ? "counter" : "gauge"); \
+  for (size_t i = 0; i < count; ++i) {                                         \
+    internal::write_prometheus_sample(out, prefix, #name, nodes[i].path,       \
+                                      nodes[i].snapshot.name);                 \
+  }
+      ALB_STATS_SNAPSHOT_FIELDS(ALB_WRITE_PROMETHEUS_FIELD)
+#undef ALB_WRITE_PROMETHEUS_FIELD
+      return out.length();
+    }
+  }
+  using namespace v_100;
+}
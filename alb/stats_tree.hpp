@@ -0,0 +1,289 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "affix_allocator.hpp"
+#include "allocator_with_stats.hpp"
+#include "bucketizer.hpp"
+#include "cascading_allocator.hpp"
+#include "fallback_allocator.hpp"
+#include "freelist.hpp"
+#include "segregator.hpp"
+#include "side_table_allocator.hpp"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace alb {
+  inline namespace v_100 {
+    namespace internal {
+
+      /**
+       * The path of a node within the tree of allocators. It is kept in a fixed
+       * buffer, so that walking the tree does not allocate. Too long paths are
+       * truncated.
+       * \ingroup group_internal
+       */
+      class stats_path {
+      public:
+        static constexpr size_t max_length = 256;
+
+      private:
+        char buffer_[max_length];
+        size_t length_;
+
+      public:
+        stats_path() noexcept
+          : length_(0)
+        {
+          buffer_[0] = '\0';
+        }
+
+        stats_path(const stats_path &) = delete;
+        stats_path &operator=(const stats_path &) = delete;
+
+        const char *c_str() const noexcept
+        {
+          return length_ == 0 ? "/" : buffer_;
+        }
+
+        /**
+         * Appends "/name" or "/name[index]" as long as it exists
+         */
+        class segment {
+          stats_path &path_;
+          size_t previousLength_;
+
+        public:
+          segment(stats_path &path, const char *name, int index = -1) noexcept
+            : path_(path)
+            , previousLength_(path.length_)
+          {
+            const auto free = sizeof(path_.buffer_) - path_.length_;
+            const auto written =
+              index < 0 ? ::snprintf(path_.buffer_ + path_.length_, free, "/%s", name)
+                        : ::snprintf(path_.buffer_ + path_.length_, free, "/%s[%d]", name, index);
+            if (written > 0) {
+              path_.length_ += std::min(static_cast<size_t>(written), free - 1);
+            }
+          }
+
+          ~segment()
+          {
+            path_.length_ = previousLength_;
+            path_.buffer_[previousLength_] = '\0';
+          }
+
+          operator stats_path &() noexcept
+          {
+            return path_;
+          }
+        };
+      };
+
+      /**
+       * Visits all alb::allocator_with_stats within a composition of allocators.
+       * The primary template handles all allocators without parts.
+       * \ingroup group_internal
+       */
+      template <class Allocator>
+      struct stats_tree_walker {
+        template <typename Visitor>
+        static void visit(const Allocator &, stats_path &, Visitor &)
+        {
+        }
+      };
+
+      template <class Allocator, typename Visitor>
+      void visit_stats_tree(const Allocator &a, stats_path &path, Visitor &v)
+      {
+        stats_tree_walker<Allocator>::visit(a, path, v);
+      }
+
+      template <class StatsAllocator, typename Visitor>
+      void visit_stats_node(const StatsAllocator &a, stats_path &path, Visitor &v)
+      {
+        v(path.c_str(), a);
+        visit_stats_tree(a.allocator(), path, v);
+      }
+
+      template <class Allocator, unsigned Flags>
+      struct stats_tree_walker<allocator_with_stats<Allocator, Flags>> {
+        template <typename Visitor>
+        static void visit(const allocator_with_stats<Allocator, Flags> &a, stats_path &path,
+                          Visitor &v)
+        {
+          visit_stats_node(a, path, v);
+        }
+      };
+
+      template <class Allocator, unsigned Flags>
+      struct stats_tree_walker<shared_allocator_with_stats<Allocator, Flags>> {
+        template <typename Visitor>
+        static void visit(const shared_allocator_with_stats<Allocator, Flags> &a,
+                          stats_path &path, Visitor &v)
+        {
+          visit_stats_node(a, path, v);
+        }
+      };
+
+      template <size_t Threshold, class SmallAllocator, class LargeAllocator>
+      struct stats_tree_walker<segregator<Threshold, SmallAllocator, LargeAllocator>> {
+        template <typename Visitor>
+        static void visit(const segregator<Threshold, SmallAllocator, LargeAllocator> &a,
+                          stats_path &path, Visitor &v)
+        {
+          visit_stats_tree(a.small_part(), stats_path::segment(path, "small"), v);
+          visit_stats_tree(a.large_part(), stats_path::segment(path, "large"), v);
+        }
+      };
+
+      template <class Primary, class Fallback>
+      struct stats_tree_walker<fallback_allocator<Primary, Fallback>> {
+        template <typename Visitor>
+        static void visit(const fallback_allocator<Primary, Fallback> &a, stats_path &path,
+                          Visitor &v)
+        {
+          visit_stats_tree(a.primary_part(), stats_path::segment(path, "primary"), v);
+          visit_stats_tree(a.fallback_part(), stats_path::segment(path, "fallback"), v);
+        }
+      };
+
+      // The per allocation store of an allocator_with_stats with caller
+      // information is transparent, so it adds no segment to the path
+      template <class Allocator, typename Prefix, typename Sufix>
+      struct stats_tree_walker<affix_allocator<Allocator, Prefix, Sufix>> {
+        template <typename Visitor>
+        static void visit(const affix_allocator<Allocator, Prefix, Sufix> &a, stats_path &path,
+                          Visitor &v)
+        {
+          visit_stats_tree(a.parent(), path, v);
+        }
+      };
+
+      template <class Allocator, typename Metadata, class TableAllocator>
+      struct stats_tree_walker<side_table_allocator<Allocator, Metadata, TableAllocator>> {
+        template <typename Visitor>
+        static void visit(const side_table_allocator<Allocator, Metadata, TableAllocator> &a,
+                          stats_path &path, Visitor &v)
+        {
+          visit_stats_tree(a.parent(), path, v);
+        }
+      };
+
+      template <class Allocator, unsigned MinSize, unsigned MaxSize, unsigned StepSize>
+      struct stats_tree_walker<bucketizer<Allocator, MinSize, MaxSize, StepSize>> {
+        template <typename Visitor>
+        static void visit(const bucketizer<Allocator, MinSize, MaxSize, StepSize> &a,
+                          stats_path &path, Visitor &v)
+        {
+          for (unsigned i = 0; i < a.number_of_buckets; ++i) {
+            visit_stats_tree(a._buckets[i], stats_path::segment(path, "bucket", static_cast<int>(i)),
+                             v);
+          }
+        }
+      };
+
+      template <class Allocator, size_t MinSize, size_t MaxSize, size_t PoolSize,
+                size_t NumberOfBatchAllocations>
+      struct stats_tree_walker<
+        freelist<Allocator, MinSize, MaxSize, PoolSize, NumberOfBatchAllocations>> {
+        template <typename Visitor>
+        static void
+        visit(const freelist<Allocator, MinSize, MaxSize, PoolSize, NumberOfBatchAllocations> &a,
+              stats_path &path, Visitor &v)
+        {
+          visit_stats_tree(a.parent(), stats_path::segment(path, "parent"), v);
+        }
+      };
+
+      template <class Allocator, size_t MinSize, size_t MaxSize, size_t PoolSize,
+                size_t NumberOfBatchAllocations>
+      struct stats_tree_walker<
+        shared_freelist<Allocator, MinSize, MaxSize, PoolSize, NumberOfBatchAllocations>> {
+        template <typename Visitor>
+        static void visit(
+          const shared_freelist<Allocator, MinSize, MaxSize, PoolSize, NumberOfBatchAllocations> &a,
+          stats_path &path, Visitor &v)
+        {
+          visit_stats_tree(a.parent(), stats_path::segment(path, "parent"), v);
+        }
+      };
+
+      template <class Allocator>
+      struct stats_tree_walker<cascading_allocator<Allocator>> {
+        template <typename Visitor>
+        static void visit(const cascading_allocator<Allocator> &a, stats_path &path,
+                          Visitor &v)
+        {
+          int i = 0;
+          a.for_each_allocator([&](const Allocator &node) {
+            visit_stats_tree(node, stats_path::segment(path, "node", i++), v);
+          });
+        }
+      };
+
+      template <class Allocator>
+      struct stats_tree_walker<shared_cascading_allocator<Allocator>> {
+        template <typename Visitor>
+        static void visit(const shared_cascading_allocator<Allocator> &a, stats_path &path,
+                          Visitor &v)
+        {
+          int i = 0;
+          a.for_each_allocator([&](const Allocator &node) {
+            visit_stats_tree(node, stats_path::segment(path, "node", i++), v);
+          });
+        }
+      };
+    }
+
+    /**
+     * Walks at compile time through the tree of a composed allocator and calls
+     * f(const char *path, const stats_snapshot &) for each alb::allocator_with_stats
+     * and alb::shared_allocator_with_stats in it, parents before their parts.
+     * The path names the way from the root to the node, e.g.
+     * "/small/bucket[2]" or "/large/fallback". A node at the root has the path "/".
+     * Only the parts that are wrapped by an allocator_with_stats are counted,
+     * so all other parts of the composition stay without any overhead.
+     * The walk descends into alb::segregator, alb::fallback_allocator,
+     * alb::bucketizer, alb::freelist (its parent allocator, so its hit rate is
+     * 1 - parent.num_allocate / num_allocate), alb::cascading_allocator and the
+     * per allocation store of a node with caller information.
+     * \param allocator The root of the composition
+     * \param f A callable with the signature void(const char *, const stats_snapshot &)
+     *
+     * \ingroup group_stats
+     */
+    template <class Allocator, typename Function>
+    void for_each_stats_node(const Allocator &allocator, Function &&f)
+    {
+      internal::stats_path path;
+      auto visitor = [&f](const char *p, const auto &node) { f(p, node.snapshot()); };
+      internal::visit_stats_tree(allocator, path, visitor);
+    }
+
+    /**
+     * Names each alb::allocator_with_stats within the composed allocator by its
+     * path, see alb::for_each_stats_node, so that its counters can be told apart
+     * in the shared memory segment (Option SharedMemoryCounters).
+     * \param allocator The root of the composition
+     *
+     * \ingroup group_stats
+     */
+    template <class Allocator>
+    void name_stats_nodes(const Allocator &allocator)
+    {
+      internal::stats_path path;
+      auto visitor = [](const char *p, const auto &node) { node.set_stats_name(p); };
+      internal::visit_stats_tree(allocator, path, visitor);
+    }
+  }
+  using namespace v_100;
+}
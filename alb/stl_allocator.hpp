@@ -9,7 +9,10 @@
 ///////////////////////////////////////////////////////////////////
 #pragma once
 
+#include <cassert>
 #include <cstddef>
+#include <new>
+#include <utility>
 #include "allocator_base.hpp"
 
 namespace alb {
@@ -129,4 +132,113 @@ namespace alb {
   {
     return false;
   }
+
+  template <typename T, class Allocator>
+  class sized_stl_allocator;
+
+  template <class Allocator>
+  class sized_stl_allocator<void, Allocator> {
+  public:
+    using pointer = void *;
+    using const_pointer = const void *;
+    using value_type = void;
+    template <class U> struct rebind {
+      typedef sized_stl_allocator<U, Allocator> other;
+    };
+  };
+
+  /**
+   * In contrast to the stl_allocator this adapter does not need a length_prefix
+   * in front of every allocated block. On deallocation the block is rebuilt from
+   * the number of elements that the container passes back, rounded by the
+   * good_size() of the allocator. So the allocator must provide good_size() and
+   * it must return exactly the length of the block that allocate() returns.
+   * \tparam T The value type of the container
+   * \tparam Allocator A global_allocator, e.g. alb::global_allocator<alb::heap<..>>
+   */
+  template <typename T, class Allocator>
+  class sized_stl_allocator {
+    typename Allocator::value_type &allocator_;
+
+  public:
+    using size_type = size_t;
+    using difference_type = ptrdiff_t;
+    using pointer = T *;
+    using const_pointer = const T *;
+    using reference = T &;
+    using const_reference = const T &;
+    using value_type = T;
+
+    template <typename U> struct rebind {
+      typedef sized_stl_allocator<U, Allocator> other;
+    };
+
+    sized_stl_allocator()
+      : allocator_(Allocator::instance())
+    {
+    }
+    sized_stl_allocator(const sized_stl_allocator &)
+      : allocator_(Allocator::instance())
+    {
+    }
+
+    template <typename U>
+    sized_stl_allocator(const sized_stl_allocator<U, Allocator> &)
+      : allocator_(Allocator::instance())
+    {
+    }
+
+    pointer address(reference r) const
+    {
+      return &r;
+    };
+    const_pointer address(const_reference r) const
+    {
+      return &r;
+    };
+
+    T *allocate(std::size_t n, const void * /*hint*/ = nullptr)
+    {
+      auto b = allocator_.allocate(n * sizeof(T));
+      if (b) {
+        assert(b.length == allocator_.good_size(n * sizeof(T)));
+        return static_cast<T *>(b.ptr);
+      }
+      throw std::bad_alloc();
+    }
+
+    void deallocate(T *ptr, std::size_t n)
+    {
+      block realBlock(ptr, allocator_.good_size(n * sizeof(T)));
+      allocator_.deallocate(realBlock);
+    }
+
+    size_t max_size() const
+    { // estimate maximum array size
+      return ((size_t)(-1) / sizeof(T));
+    }
+
+    template <class... U>
+    void construct(pointer ptr, U&&... val)
+    {
+      ::new (static_cast<void *>(ptr)) T(std::forward<U>(val)...);
+    };
+
+    void destroy(pointer p)
+    {
+      p->T::~T();
+    };
+  };
+
+  template <class Allocator, typename T1, typename T2>
+  bool operator==(const sized_stl_allocator<T1, Allocator> &, const sized_stl_allocator<T2, Allocator> &)
+  {
+    return true;
+  }
+
+  template <class Allocator, typename T1, typename T2>
+  bool operator!=(const sized_stl_allocator<T1, Allocator> &, const sized_stl_allocator<T2, Allocator> &)
+  {
+    return false;
+  }
 }
@@ -9,6 +9,7 @@
 ///////////////////////////////////////////////////////////////////
 #pragma once
 
+#include <cassert>
 #include <cstddef>
 #include <utility>
 #include "allocator_base.hpp"
@@ -128,6 +129,118 @@ namespace alb {
     {
       return !(x == y);
     }
+
+    template <typename T, class Allocator>
+    class sized_std_allocator_adapter;
+
+    template <class Allocator>
+    class sized_std_allocator_adapter<void, Allocator> {
+    public:
+      using pointer = void *;
+      using const_pointer = const void *;
+      using value_type = void;
+      template <class U> struct rebind {
+        typedef sized_std_allocator_adapter<U, Allocator> other;
+      };
+    };
+
+    /**
+     * In contrast to the std_allocator_adapter this adapter does not need a
+     * prefix with the length in front of every allocated block. On deallocation
+     * the block is rebuilt from the number of elements that the container passes
+     * back, rounded by the good_size() of the Allocator. So the Allocator must
+     * provide good_size() and it must return exactly the length of the block
+     * that allocate() returns.
+     */
+    template <typename T, class Allocator>
+    class sized_std_allocator_adapter {
+      const Allocator& allocator_;
+
+    public:
+      using size_type = size_t;
+      using difference_type = ptrdiff_t;
+      using pointer = T *;
+      using const_pointer = const T *;
+      using reference = T &;
+      using const_reference = const T &;
+      using value_type = T;
+
+      template <typename U> struct rebind {
+        typedef sized_std_allocator_adapter<U, Allocator> other;
+      };
+
+      explicit sized_std_allocator_adapter(const Allocator& allocator) noexcept
+        : allocator_(allocator)
+      {
+      }
+
+      const Allocator& allocator() const
+      {
+        return allocator_;
+      }
+
+      template <typename U>
+      sized_std_allocator_adapter(const sized_std_allocator_adapter<U, Allocator> &other) noexcept
+        : allocator_(other.allocator())
+      {
+      }
+
+      pointer address(reference r) const
+      {
+        return &r;
+      };
+
+      const_pointer address(const_reference r) const
+      {
+        return &r;
+      };
+
+      T *allocate(std::size_t n, const void * /*hint*/ = nullptr)
+      {
+        auto b = const_cast<Allocator&>(allocator_).allocate(n * sizeof(T));
+        if (b) {
+          assert(b.length == allocator_.good_size(n * sizeof(T)));
+          return static_cast<T *>(b.ptr);
+        }
+        return nullptr;
+      }
+
+      void deallocate(T *ptr, std::size_t n)
+      {
+        block realBlock(ptr, allocator_.good_size(n * sizeof(T)));
+        const_cast<Allocator&>(allocator_).deallocate(realBlock);
+      }
+
+      size_t max_size() const
+      { // estimate maximum array size
+        return ((size_t)(-1) / sizeof(T));
+      }
+
+      template <class... U>
+      void construct(pointer ptr, U&&... val)
+      {
+        ::new (static_cast<void *>(ptr)) T(std::forward<U>(val)...);
+      };
+
+      void destroy(pointer p)
+      {
+        p->T::~T();
+      };
+    };
+
+    template <class Allocator, typename T1, typename T2>
+    bool operator==(const sized_std_allocator_adapter<T1, Allocator> &x,
+                    const sized_std_allocator_adapter<T2, Allocator> &y)
+    {
+      return &x.allocator() == &y.allocator();
+    }
+
+    template <class Allocator, typename T1, typename T2>
+    bool operator!=(const sized_std_allocator_adapter<T1, Allocator> &x,
+                    const sized_std_allocator_adapter<T2, Allocator> &y)
+    {
+      return !(x == y);
+    }
   }
 
   using namespace v_100;
@@ -0,0 +1,433 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "allocator_base.hpp"
+#include "internal/heap_helpers.hpp"
+#include "internal/reallocator.hpp"
+
+#include <cassert>
+#include <cstdint>
+
+namespace alb {
+  inline namespace v_100 {
+
+    namespace internal {
+      inline constexpr unsigned constexpr_highest_bit(size_t n) noexcept
+      {
+        return n <= 1 ? 0 : 1 + constexpr_highest_bit(n >> 1);
+      }
+    }
+
+    /**
+     * The TLSF (two-level segregated fit) allocator manages a pre-allocated
+     * area of Size bytes with strict O(1) allocation and deallocation, without
+     * any loop over blocks or lists.
+     * The free blocks are kept in lists by their size: The first level is the
+     * power of two of the size, and each power of two is divided into 16
+     * linear second level classes. Two bitmaps tell, which lists are not
+     * empty, so the smallest list, whose blocks all fit a request, is found
+     * with two bit scans. Only if there is none, the first block of the list
+     * of the size itself is checked, too. The sizes are rounded to 16 bytes, and each block
+     * has a header of 16 bytes with its size and the link to its physical
+     * predecessor, so that a freed block is immediately merged with its free
+     * neighbours.
+     * expand() absorbs the following free block and a reallocation to a
+     * smaller size returns the rest of the block, both in place.
+     * \tparam Allocator The allocator that provides the area
+     * \tparam Size The size of the area in bytes
+     *
+     * \ingroup group_allocators
+     */
+    template <class Allocator, size_t Size>
+    class tlsf_allocator {
+      struct header {
+        // The physical predecessor, nullptr for the first block
+        header *prev_phys;
+        // The size of the payload, with the free flags in the lowest bits
+        size_t size;
+      };
+
+      // Within the payload of the free blocks
+      struct free_links {
+        header *next;
+        header *prev;
+      };
+
+      static constexpr size_t granularity = 16;
+      static constexpr size_t header_size = sizeof(header);
+      static constexpr size_t min_payload = sizeof(free_links);
+      static constexpr size_t free_bit = 1;
+      static constexpr size_t prev_free_bit = 2;
+      static constexpr size_t flag_bits = free_bit | prev_free_bit;
+
+      static constexpr unsigned sl_bits = 4;
+      static constexpr unsigned sl_count = 1u << sl_bits;
+      // Below small_size, all sizes fall into the first level
+      static constexpr unsigned fl_shift = sl_bits + 4;
+      static constexpr size_t small_size = size_t(1) << fl_shift;
+      static constexpr unsigned fl_count = internal::constexpr_highest_bit(Size) - fl_shift + 2;
+
+      static_assert(header_size == granularity, "The header must keep the granularity!");
+      static_assert(min_payload <= granularity, "The links do not fit into the smallest block!");
+      static_assert(Size >= 4 * small_size, "The Size is too small!");
+      static_assert(fl_count <= 64, "The Size is too large!");
+
+      Allocator allocator_;
+      block buffer_;
+      uint64_t flBitmap_;
+      uint32_t slBitmap_[fl_count];
+      header *lists_[fl_count][sl_count];
+
+      tlsf_allocator(const tlsf_allocator &) = delete;
+      tlsf_allocator &operator=(const tlsf_allocator &) = delete;
+
+      static size_t size_of(const header *h) noexcept
+      {
+        return h->size & ~flag_bits;
+      }
+
+      static void set_size(header *h, size_t size) noexcept
+      {
+        h->size = size | (h->size & flag_bits);
+      }
+
+      static bool is_free(const header *h) noexcept
+      {
+        return (h->size & free_bit) != 0;
+      }
+
+      static void set_free(header *h, bool free) noexcept
+      {
+        h->size = free ? (h->size | free_bit) : (h->size & ~free_bit);
+      }
+
+      static bool is_prev_free(const header *h) noexcept
+      {
+        return (h->size & prev_free_bit) != 0;
+      }
+
+      static void set_prev_free(header *h, bool free) noexcept
+      {
+        h->size = free ? (h->size | prev_free_bit) : (h->size & ~prev_free_bit);
+      }
+
+      static char *payload_of(header *h) noexcept
+      {
+        return reinterpret_cast<char *>(h) + header_size;
+      }
+
+      static header *header_of(void *p) noexcept
+      {
+        return reinterpret_cast<header *>(static_cast<char *>(p) - header_size);
+      }
+
+      static header *next_phys(header *h) noexcept
+      {
+        return reinterpret_cast<header *>(payload_of(h) + size_of(h));
+      }
+
+      static free_links *links_of(header *h) noexcept
+      {
+        return reinterpret_cast<free_links *>(payload_of(h));
+      }
+
+      static size_t round_up(size_t n) noexcept
+      {
+        return n < min_payload ? min_payload : internal::round_to_alignment(granularity, n);
+      }
+
+      // The list, in which a free block of the size is kept
+      static void mapping_insert(size_t size, unsigned &fl, unsigned &sl) noexcept
+      {
+        if (size < small_size) {
+          fl = 0;
+          sl = static_cast<unsigned>(size / (small_size / sl_count));
+        }
+        else {
+          const auto bit = helpers::highest_set_bit(size);
+          sl = static_cast<unsigned>(size >> (bit - sl_bits)) ^ sl_count;
+          fl = bit - fl_shift + 1;
+        }
+      }
+
+      // The first list, in which all blocks fit the size
+      static void mapping_search(size_t size, unsigned &fl, unsigned &sl) noexcept
+      {
+        if (size >= small_size) {
+          size += (size_t(1) << (helpers::highest_set_bit(size) - sl_bits)) - 1;
+        }
+        mapping_insert(size, fl, sl);
+      }
+
+      void insert(header *h) noexcept
+      {
+        unsigned fl, sl;
+        mapping_insert(size_of(h), fl, sl);
+        auto links = links_of(h);
+        links->prev = nullptr;
+        links->next = lists_[fl][sl];
+        if (links->next) {
+          links_of(links->next)->prev = h;
+        }
+        lists_[fl][sl] = h;
+        flBitmap_ |= uint64_t(1) << fl;
+        slBitmap_[fl] |= 1u << sl;
+      }
+
+      void remove(header *h) noexcept
+      {
+        unsigned fl, sl;
+        mapping_insert(size_of(h), fl, sl);
+        auto links = links_of(h);
+        if (links->prev) {
+          links_of(links->prev)->next = links->next;
+        }
+        else {
+          lists_[fl][sl] = links->next;
+          if (!links->next) {
+            slBitmap_[fl] &= ~(1u << sl);
+            if (slBitmap_[fl] == 0) {
+              flBitmap_ &= ~(uint64_t(1) << fl);
+            }
+          }
+        }
+        if (links->next) {
+          links_of(links->next)->prev = links->prev;
+        }
+      }
+
+      header *find_suitable(size_t size) noexcept
+      {
+        unsigned fl, sl;
+        mapping_search(size, fl, sl);
+        if (fl < fl_count) {
+          auto slMap = slBitmap_[fl] & (~0u << sl);
+          if (slMap == 0) {
+            const auto flMap = fl + 1 < 64 ? flBitmap_ & (~uint64_t(0) << (fl + 1)) : 0;
+            if (flMap != 0) {
+              fl = helpers::lowest_set_bit(flMap);
+              slMap = slBitmap_[fl];
+            }
+          }
+          if (slMap != 0) {
+            return lists_[fl][helpers::lowest_set_bit(slMap)];
+          }
+        }
+        // Only the list of the size itself is left, whose first block may fit
+        mapping_insert(size, fl, sl);
+        auto h = lists_[fl][sl];
+        return h && size_of(h) >= size ? h : nullptr;
+      }
+
+      // Merges the free block with its physical successor, if this is free
+      header *merge_next(header *h) noexcept
+      {
+        auto next = next_phys(h);
+        if (is_free(next)) {
+          remove(next);
+          set_size(h, size_of(h) + header_size + size_of(next));
+          next_phys(h)->prev_phys = h;
+        }
+        return h;
+      }
+
+      // Returns the part of the used block beyond size as free block
+      void trim(header *h, size_t size) noexcept
+      {
+        if (size_of(h) < size + header_size + min_payload) {
+          return;
+        }
+        auto rest = reinterpret_cast<header *>(payload_of(h) + size);
+        rest->prev_phys = h;
+        rest->size = (size_of(h) - size - header_size) | free_bit;
+        set_size(h, size);
+        next_phys(rest)->prev_phys = rest;
+        merge_next(rest);
+        set_prev_free(next_phys(rest), true);
+        insert(rest);
+      }
+
+      void shrink() noexcept
+      {
+        allocator_.deallocate(buffer_);
+      }
+
+    public:
+      using allocator = Allocator;
+
+      static constexpr bool supports_truncated_deallocation = true;
+      static constexpr unsigned alignment =
+        Allocator::alignment < granularity ? Allocator::alignment : granularity;
+      /// The largest possible allocation, the whole area minus the headers of
+      /// the block and of the end marker
+      static constexpr size_t max_allocation = Size / granularity * granularity - 2 * header_size;
+
+      tlsf_allocator() noexcept
+      {
+        buffer_ = allocator_.allocate(Size);
+        deallocate_all();
+      }
+
+      ~tlsf_allocator()
+      {
+        shrink();
+      }
+
+      /**
+       * Returns the length of the block that an allocation of n bytes results in
+       */
+      static size_t good_size(size_t n) noexcept
+      {
+        return round_up(n);
+      }
+
+      /**
+       * Returns the complete memory area that is managed by this allocator. All
+       * returned blocks are located within it.
+       */
+      block memory_region() const noexcept
+      {
+        return buffer_;
+      }
+
+      bool owns(const block &b) const noexcept
+      {
+        return b && buffer_.ptr <= b.ptr &&
+               b.ptr < (static_cast<char *>(buffer_.ptr) + buffer_.length);
+      }
+
+      /**
+       * Takes a block of the first non empty list, whose blocks all fit n
+       * bytes, and returns the rest of it as a free block.
+       * \param n The requested size
+       * \return The block of n bytes rounded up to 16 or an empty block
+       */
+      block allocate(size_t n) noexcept
+      {
+        if (n == 0 || n > max_allocation) {
+          return {};
+        }
+        const auto size = round_up(n);
+        auto h = find_suitable(size);
+        if (!h) {
+          return {};
+        }
+        remove(h);
+        set_free(h, false);
+        set_prev_free(next_phys(h), false);
+        trim(h, size);
+        return block(payload_of(h), size);
+      }
+
+      /**
+       * Frees the block and merges it immediately with its free neighbours
+       * \param b The block to free
+       */
+      void deallocate(block &b) noexcept
+      {
+        if (!owns(b)) {
+          return;
+        }
+        auto h = header_of(b.ptr);
+        assert(!is_free(h));
+        set_free(h, true);
+        if (is_prev_free(h)) {
+          auto prev = h->prev_phys;
+          remove(prev);
+          set_size(prev, size_of(prev) + header_size + size_of(h));
+          h = prev;
+          next_phys(h)->prev_phys = h;
+        }
+        merge_next(h);
+        set_prev_free(next_phys(h), true);
+        insert(h);
+        b.reset();
+      }
+
+      /**
+       * Grows the block in place into the following free block.
+       * \param b The block to expand
+       * \param delta The number of additional bytes
+       * \return True, if the block was expanded
+       */
+      bool expand(block &b, size_t delta) noexcept
+      {
+        if (delta == 0) {
+          return true;
+        }
+        const auto size = round_up(b.length + delta);
+        auto h = header_of(b.ptr);
+        if (size_of(h) < size) {
+          auto next = next_phys(h);
+          if (!is_free(next) || size_of(h) + header_size + size_of(next) < size) {
+            return false;
+          }
+          remove(next);
+          set_size(h, size_of(h) + header_size + size_of(next));
+          next_phys(h)->prev_phys = h;
+          set_prev_free(next_phys(h), false);
+          trim(h, size);
+        }
+        b.length = size;
+        return true;
+      }
+
+      /**
+       * Shrinks the block in place by returning its rest as free block.
+       * A growing is done by expand() if possible, otherwise by a copy.
+       */
+      bool reallocate(block &b, size_t n) noexcept
+      {
+        if (internal::is_reallocation_handled_default(*this, b, n)) {
+          return true;
+        }
+        if (n < b.length) {
+          const auto size = round_up(n);
+          trim(header_of(b.ptr), size);
+          b.length = size;
+          return true;
+        }
+        return internal::reallocate_with_copy(*this, *this, b, n);
+      }
+
+      /**
+       * Frees all blocks at once. Beware of dangling pointers!
+       */
+      void deallocate_all() noexcept
+      {
+        flBitmap_ = 0;
+        for (auto &m : slBitmap_) {
+          m = 0;
+        }
+        for (auto &l : lists_) {
+          for (auto &h : l) {
+            h = nullptr;
+          }
+        }
+        if (!buffer_) {
+          return;
+        }
+        auto first = static_cast<header *>(buffer_.ptr);
+        first->prev_phys = nullptr;
+        first->size = max_allocation | free_bit;
+        // The used end marker prevents a merge beyond the area
+        auto last = next_phys(first);
+        last->prev_phys = first;
+        last->size = prev_free_bit;
+        insert(first);
+      }
+    };
+
+    template <class Allocator, size_t Size>
+    constexpr size_t tlsf_allocator<Allocator, Size>::max_allocation;
+  }
+  using namespace v_100;
+}
@@ -0,0 +1,346 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "allocator_base.hpp"
+#include "internal/spin_lock.hpp"
+#include "internal/stats_shards.hpp"
+#include "internal/traits.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+
+namespace alb {
+  inline namespace v_100 {
+
+    /**
+     * The operations in an allocation trace
+     *
+     * \ingroup group_stats
+     */
+    enum class trace_operation : uint8_t {
+      allocate,
+      deallocate,
+      reallocate,
+      expand,
+      deallocate_all
+    };
+
+    /**
+     * One record of an allocation trace, as it is stored in the file. The address
+     * of a block serves as its id; a replay maps it to the block of the replaying
+     * allocator.
+     *
+     * \ingroup group_stats
+     */
+    struct trace_record {
+      trace_operation op;
+      /// 1, if the operation was successful
+      uint8_t success;
+      /// Index of the calling thread in the order of the first allocator call
+      uint16_t thread;
+      uint32_t reserved;
+      /// The requested size, resp. the delta of an expand
+      uint64_t size;
+      /// The id of the block before the operation, 0 for an allocate
+      uint64_t block;
+      /// The id of the block after the operation, 0 for a deallocate
+      uint64_t result;
+    };
+
+    static_assert(sizeof(trace_record) == 32, "The trace record must not contain padding!");
+
+    /**
+     * The file starts with this header, followed by the records
+     *
+     * \ingroup group_stats
+     */
+    struct trace_header {
+      char magic[8];
+      uint32_t version;
+      uint32_t record_size;
+    };
+
+    namespace internal {
+      static constexpr char trace_magic[8] = {'A', 'L', 'B', 'T', 'R', 'A', 'C', 'E'};
+      static constexpr uint32_t trace_version = 1;
+    }
+
+    /**
+     * Calls f(const trace_record&) for each record of the trace file
+     * \return False, if the file could not be opened or is not a trace
+     *
+     * \ingroup group_stats
+     */
+    template <typename Function>
+    bool for_each_trace_record(const char *path, Function &&f)
+    {
+      auto file = ::fopen(path, "rb");
+      if (!file) {
+        return false;
+      }
+      trace_header header;
+      if (::fread(&header, sizeof(header), 1, file) != 1 ||
+          ::memcmp(header.magic, internal::trace_magic, sizeof(header.magic)) != 0 ||
+          header.version != internal::trace_version || header.record_size != sizeof(trace_record)) {
+        ::fclose(file);
+        return false;
+      }
+      trace_record records[1024];
+      size_t count;
+      while ((count = ::fread(records, sizeof(trace_record), 1024, file)) > 0) {
+        for (size_t i = 0; i < count; ++i) {
+          f(static_cast<const trace_record &>(records[i]));
+        }
+      }
+      ::fclose(file);
+      return true;
+    }
+
+    /**
+     * This allocator writes a binary trace of all operations on the Allocator,
+     * with their sizes, block ids and thread ids, into a file. The trace can be
+     * replayed later against an other composition, e.g. by the tool alb-replay,
+     * to evaluate it with real traffic.
+     * The records are collected in a buffer of BufferSize records, that is
+     * written when it is full, by flush() and at the destruction. As long as no
+     * file is opened, nothing is recorded.
+     * An allocation is recorded after the Allocator returned the block, a
+     * deallocation before the block is passed to the Allocator, so the trace
+     * of several threads never contains a block twice. A reallocation, that
+     * may move the block, is recorded while the lock of the shared recorder is
+     * held across the call of the Allocator, so no other thread can record an
+     * allocation of the released address before it.
+     * \tparam Shared If true, the recorder is thread safe
+     * \tparam Allocator The allocator that performs all operations
+     * \tparam BufferSize The number of records that are written at once
+     *
+     * \ingroup group_allocators group_stats
+     */
+    template <bool Shared, class Allocator, unsigned BufferSize>
+    class trace_recorder_base {
+      using lock_type = typename traits::type_switch<internal::spin_lock, internal::no_lock,
+                                                     Shared>::type;
+
+      Allocator allocator_;
+      lock_type lock_;
+      std::atomic<FILE *> file_;
+      unsigned used_;
+      size_t written_;
+      trace_record buffer_[BufferSize];
+
+      void write_buffer() noexcept
+      {
+        if (file_.load() && used_ > 0) {
+          written_ += ::fwrite(buffer_, sizeof(trace_record), used_, file_.load());
+        }
+        used_ = 0;
+      }
+
+      static trace_record make_record(trace_operation op, bool success, size_t size,
+                                      const void *before, const void *after) noexcept
+      {
+        trace_record r;
+        r.op = op;
+        r.success = success ? 1 : 0;
+        r.thread = static_cast<uint16_t>(internal::this_thread_shard_index());
+        r.reserved = 0;
+        r.size = size;
+        r.block = reinterpret_cast<uintptr_t>(before);
+        r.result = reinterpret_cast<uintptr_t>(after);
+        return r;
+      }
+
+      // The caller must hold the lock
+      void append(const trace_record &r) noexcept
+      {
+        if (!file_.load(std::memory_order_relaxed)) {
+          return;
+        }
+        buffer_[used_++] = r;
+        if (used_ == BufferSize) {
+          write_buffer();
+        }
+      }
+
+      void record(trace_operation op, bool success, size_t size, const void *before,
+                  const void *after) noexcept
+      {
+        if (!file_.load(std::memory_order_relaxed)) {
+          return;
+        }
+        const auto r = make_record(op, success, size, before, after);
+        std::lock_guard<lock_type> guard(lock_);
+        append(r);
+      }
+
+      trace_recorder_base(const trace_recorder_base &) = delete;
+      trace_recorder_base &operator=(const trace_recorder_base &) = delete;
+
+    public:
+      using allocator = Allocator;
+
+      static constexpr bool supports_truncated_deallocation =
+        Allocator::supports_truncated_deallocation;
+      static constexpr unsigned alignment = Allocator::alignment;
+
+      trace_recorder_base() noexcept
+        : file_(nullptr)
+        , used_(0)
+        , written_(0)
+      {}
+
+      ~trace_recorder_base()
+      {
+        close();
+      }
+
+      /**
+       * Starts the recording into the file. A previous recording is closed.
+       * \return False, if the file could not be created
+       */
+      bool open(const char *path) noexcept
+      {
+        close();
+        auto file = ::fopen(path, "wb");
+        if (!file) {
+          return false;
+        }
+        trace_header header;
+        ::memcpy(header.magic, internal::trace_magic, sizeof(header.magic));
+        header.version = internal::trace_version;
+        header.record_size = sizeof(trace_record);
+        ::fwrite(&header, sizeof(header), 1, file);
+
+        std::lock_guard<lock_type> guard(lock_);
+        file_.store(file);
+        used_ = 0;
+        written_ = 0;
+        return true;
+      }
+
+      /**
+       * Writes all buffered records and stops the recording
+       */
+      void close() noexcept
+      {
+        std::lock_guard<lock_type> guard(lock_);
+        if (auto file = file_.load()) {
+          write_buffer();
+          ::fclose(file);
+          file_.store(nullptr);
+        }
+      }
+
+      /**
+       * Writes all buffered records into the file
+       */
+      void flush() noexcept
+      {
+        std::lock_guard<lock_type> guard(lock_);
+        write_buffer();
+        if (auto file = file_.load()) {
+          ::fflush(file);
+        }
+      }
+
+      /**
+       * Returns the number of records that are written into the file so far
+       */
+      size_t number_of_written_records() noexcept
+      {
+        std::lock_guard<lock_type> guard(lock_);
+        return written_;
+      }
+
+      const Allocator &parent() const noexcept
+      {
+        return allocator_;
+      }
+
+      block allocate(size_t n) noexcept
+      {
+        auto result = allocator_.allocate(n);
+        record(trace_operation::allocate, result.ptr != nullptr, n, nullptr, result.ptr);
+        return result;
+      }
+
+      void deallocate(block &b) noexcept
+      {
+        if (b) {
+          record(trace_operation::deallocate, true, b.length, b.ptr, nullptr);
+        }
+        allocator_.deallocate(b);
+      }
+
+      bool reallocate(block &b, size_t n) noexcept
+      {
+        if (!file_.load(std::memory_order_relaxed)) {
+          return allocator_.reallocate(b, n);
+        }
+        const auto before = b.ptr;
+        std::lock_guard<lock_type> guard(lock_);
+        const auto result = allocator_.reallocate(b, n);
+        append(make_record(trace_operation::reallocate, result, n, before, b.ptr));
+        return result;
+      }
+
+      template <typename U = Allocator>
+      typename std::enable_if<traits::has_expand<U>::value, bool>::type
+        expand(block &b, size_t delta) noexcept
+      {
+        const auto result = allocator_.expand(b, delta);
+        record(trace_operation::expand, result, delta, b.ptr, b.ptr);
+        return result;
+      }
+
+      template <typename U = Allocator>
+      typename std::enable_if<traits::has_owns<U>::value, bool>::type
+        owns(const block &b) const noexcept
+      {
+        return allocator_.owns(b);
+      }
+
+      template <typename U = Allocator>
+      typename std::enable_if<traits::has_deallocate_all<U>::value, void>::type
+        deallocate_all() noexcept
+      {
+        record(trace_operation::deallocate_all, true, 0, nullptr, nullptr);
+        allocator_.deallocate_all();
+      }
+    };
+
+    /**
+     * Single threaded variant of the trace recorder. For details see
+     * alb::trace_recorder_base
+     *
+     * \ingroup group_allocators group_stats
+     */
+    template <class Allocator, unsigned BufferSize = 1024>
+    class trace_recorder : public trace_recorder_base<false, Allocator, BufferSize>
+    {
+    };
+
+    /**
+     * Thread safe variant of the trace recorder. For details see
+     * alb::trace_recorder_base
+     *
+     * \ingroup group_allocators group_stats group_shared
+     */
+    template <class Allocator, unsigned BufferSize = 1024>
+    class shared_trace_recorder : public trace_recorder_base<true, Allocator, BufferSize>
+    {
+    };
+  }
+  using namespace v_100;
+}
@@ -0,0 +1,270 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "trace_recorder.hpp"
+#include "internal/traits.hpp"
+#include "internal/tsc_clock.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace alb {
+  inline namespace v_100 {
+
+    /**
+     * The outcome of alb::replay_trace
+     *
+     * \ingroup group_stats
+     */
+    struct replay_result {
+      size_t records = 0;
+      size_t allocations = 0;
+      size_t deallocations = 0;
+      size_t reallocations = 0;
+      size_t expansions = 0;
+      /// Operations that failed in the replay. The failed operations of the
+      /// trace are not replayed.
+      size_t failures = 0;
+      /// Records of blocks that were not allocated within the trace, e.g.
+      /// because the recording started later, or that were allocated twice
+      size_t unmatched = 0;
+      /// The maximum of the sum of the lengths of all live blocks
+      size_t peak_bytes = 0;
+      /// The maximum of the sum of the requested bytes of all live blocks
+      size_t peak_requested_bytes = 0;
+      /// The number of threads that appear in the trace
+      size_t threads = 0;
+      /// The duration of the complete replay
+      double seconds = 0.0;
+      /// The ticks of the alb::internal::tsc_clock within the allocator calls
+      uint64_t allocator_ticks = 0;
+    };
+
+    namespace internal {
+      template <class Allocator>
+      class trace_replayer {
+        struct live_block {
+          block b;
+          size_t requested;
+        };
+
+        Allocator &allocator_;
+        replay_result &result_;
+        std::unordered_map<uint64_t, live_block> live_;
+        size_t bytes_ = 0;
+        size_t requested_ = 0;
+        std::unordered_set<uint16_t> threads_;
+
+        template <typename Operation>
+        auto timed(Operation &&op) -> decltype(op())
+        {
+          const auto start = tsc_clock::now();
+          auto r = op();
+          result_.allocator_ticks += tsc_clock::now() - start;
+          return r;
+        }
+
+        void add(uint64_t id, const block &b, size_t requested)
+        {
+          // A consistent trace never contains a live block twice. Otherwise the
+          // older block is dropped, so that it is not leaked
+          auto existing = live_.find(id);
+          if (existing != live_.end()) {
+            ++result_.unmatched;
+            release(existing);
+          }
+          live_[id] = live_block{b, requested};
+          bytes_ += b.length;
+          requested_ += requested;
+          result_.peak_bytes = std::max(result_.peak_bytes, bytes_);
+          result_.peak_requested_bytes = std::max(result_.peak_requested_bytes, requested_);
+        }
+
+        void release(typename std::unordered_map<uint64_t, live_block>::iterator it)
+        {
+          bytes_ -= it->second.b.length;
+          requested_ -= it->second.requested;
+          auto b = it->second.b;
+          live_.erase(it);
+          timed([&] {
+            allocator_.deallocate(b);
+            return 0;
+          });
+        }
+
+        void allocate(const trace_record &r)
+        {
+          ++result_.allocations;
+          auto b = timed([&] { return allocator_.allocate(static_cast<size_t>(r.size)); });
+          if (b) {
+            add(r.result, b, static_cast<size_t>(r.size));
+          }
+          else {
+            ++result_.failures;
+          }
+        }
+
+        void deallocate(const trace_record &r)
+        {
+          ++result_.deallocations;
+          auto it = live_.find(r.block);
+          if (it == live_.end()) {
+            ++result_.unmatched;
+            return;
+          }
+          release(it);
+        }
+
+        void reallocate(const trace_record &r)
+        {
+          ++result_.reallocations;
+          auto it = r.block == 0 ? live_.end() : live_.find(r.block);
+          if (r.block != 0 && it == live_.end()) {
+            ++result_.unmatched;
+            return;
+          }
+          live_block current{block(), 0};
+          if (it != live_.end()) {
+            current = it->second;
+            bytes_ -= current.b.length;
+            requested_ -= current.requested;
+            live_.erase(it);
+          }
+          const auto size = static_cast<size_t>(r.size);
+          const auto success = timed([&] { return allocator_.reallocate(current.b, size); });
+          if (!success) {
+            ++result_.failures;
+          }
+          if (current.b) {
+            add(r.result, current.b, success ? size : current.requested);
+          }
+        }
+
+        template <typename U = Allocator>
+        typename std::enable_if<traits::has_expand<U>::value, bool>::type
+          expand(block &b, size_t delta)
+        {
+          return allocator_.expand(b, delta);
+        }
+
+        template <typename U = Allocator>
+        typename std::enable_if<!traits::has_expand<U>::value, bool>::type
+          expand(block &, size_t)
+        {
+          return false;
+        }
+
+        void expand(const trace_record &r)
+        {
+          ++result_.expansions;
+          auto it = live_.find(r.block);
+          if (it == live_.end()) {
+            ++result_.unmatched;
+            return;
+          }
+          auto &l = it->second;
+          const auto length = l.b.length;
+          const auto delta = static_cast<size_t>(r.size);
+          if (timed([&] { return expand(l.b, delta); })) {
+            bytes_ += l.b.length - length;
+            l.requested += delta;
+            requested_ += delta;
+            result_.peak_bytes = std::max(result_.peak_bytes, bytes_);
+            result_.peak_requested_bytes = std::max(result_.peak_requested_bytes, requested_);
+          }
+          else {
+            ++result_.failures;
+          }
+        }
+
+      public:
+        trace_replayer(Allocator &allocator, replay_result &result)
+          : allocator_(allocator)
+          , result_(result)
+        {}
+
+        ~trace_replayer()
+        {
+          while (!live_.empty()) {
+            release(live_.begin());
+          }
+        }
+
+        void operator()(const trace_record &r)
+        {
+          ++result_.records;
+          threads_.insert(r.thread);
+          if (!r.success) {
+            // A failed operation did not change anything
+            return;
+          }
+          switch (r.op) {
+          case trace_operation::allocate:
+            allocate(r);
+            break;
+          case trace_operation::deallocate:
+            deallocate(r);
+            break;
+          case trace_operation::reallocate:
+            reallocate(r);
+            break;
+          case trace_operation::expand:
+            expand(r);
+            break;
+          case trace_operation::deallocate_all:
+            while (!live_.empty()) {
+              release(live_.begin());
+            }
+            break;
+          }
+        }
+
+        size_t number_of_threads() const noexcept
+        {
+          return threads_.size();
+        }
+      };
+    }
+
+    /**
+     * Replays a trace, that was recorded by alb::trace_recorder, in the recorded
+     * order against the given allocator. All blocks that are still alive at the
+     * end are deallocated. The allocations are made from the calling thread, so
+     * the result shows the costs and the footprint of the composition, but not
+     * the contention between the recorded threads.
+     * \param allocator The allocator or composition under test
+     * \param path The trace file
+     * \param result The counters of the replay
+     * \return False, if the file could not be read
+     *
+     * \ingroup group_stats
+     */
+    template <class Allocator>
+    bool replay_trace(Allocator &allocator, const char *path, replay_result &result)
+    {
+      result = replay_result();
+      const auto start = std::chrono::steady_clock::now();
+      bool success;
+      {
+        internal::trace_replayer<Allocator> replayer(allocator, result);
+        success = for_each_trace_record(path, replayer);
+        result.threads = replayer.number_of_threads();
+      }
+      result.seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      return success;
+    }
+  }
+  using namespace v_100;
+}
@@ -0,0 +1,163 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "benchmark_runner.hpp"
+#include "fragmentation.hpp"
+#include "latency.hpp"
+#include "threaded_workloads.hpp"
+
+#include <alb/aligned_mallocator.hpp>
+#include <alb/bucketizer.hpp>
+#include <alb/buddy_allocator.hpp>
+#include <alb/cascading_allocator.hpp>
+#include <alb/fallback_allocator.hpp>
+#include <alb/freelist.hpp>
+#include <alb/heap.hpp>
+#include <alb/mallocator.hpp>
+#include <alb/per_cpu_allocator.hpp>
+#include <alb/segregator.hpp>
+#include <alb/shared_heap.hpp>
+#include <alb/shared_pool.hpp>
+#include <alb/slab_allocator.hpp>
+#include <alb/stack_allocator.hpp>
+#include <alb/tlsf_allocator.hpp>
+
+#include <functional>
+#include <vector>
+
+namespace alb_benchmark {
+
+  // Each allocator must serve all sizes up to max_request_size. The ones with a
+  // limited capacity or size range fall back to the mallocator, like they would
+  // be used in a program.
+
+  using heap_under_test = alb::fallback_allocator<alb::heap<alb::mallocator, 131072, 64>,
+                                                  alb::mallocator>;
+
+  using shared_heap_under_test =
+    alb::fallback_allocator<alb::shared_heap<alb::mallocator, 131072, 64>, alb::mallocator>;
+
+  using buddy_allocator_under_test =
+    alb::fallback_allocator<alb::buddy_allocator<alb::mallocator, 64, 17>, alb::mallocator>;
+
+  using freelist_under_test = alb::segregator<64, alb::freelist<alb::mallocator, 0, 64>,
+                                              alb::mallocator>;
+
+  using bucketizer_under_test = alb::segregator<
+    1024, alb::bucketizer<alb::freelist<alb::mallocator, alb::internal::DynasticDynamicSet,
+                                        alb::internal::DynasticDynamicSet>,
+                          1, 1024, 64>,
+    alb::mallocator>;
+
+  template <size_t ObjectSize>
+  using Slab = alb::slab_allocator<alb::aligned_mallocator<4096>, ObjectSize>;
+
+  using slab_allocator_under_test = alb::segregator<
+    32, Slab<32>,
+    alb::segregator<64, Slab<64>,
+                    alb::segregator<128, Slab<128>, alb::segregator<256, Slab<256>, alb::mallocator>>>>;
+
+  using tlsf_allocator_under_test =
+    alb::fallback_allocator<alb::tlsf_allocator<alb::mallocator, 131072 * 64>, alb::mallocator>;
+
+  using stack_allocator_under_test =
+    alb::fallback_allocator<alb::stack_allocator<1024 * 1024>, alb::mallocator>;
+
+  using cascading_allocator_under_test =
+    alb::cascading_allocator<alb::heap<alb::mallocator, 16384, 64>>;
+
+  // The composition with jemalloc like buckets of the README
+  using FList = alb::freelist<alb::mallocator, alb::internal::DynasticDynamicSet,
+                              alb::internal::DynasticDynamicSet>;
+
+  using readme_composition = alb::segregator<
+    8, alb::freelist<alb::mallocator, 0, 8>,
+    alb::segregator<
+      128, alb::bucketizer<FList, 1, 128, 16>,
+      alb::segregator<
+        256, alb::bucketizer<FList, 129, 256, 32>,
+        alb::segregator<
+          512, alb::bucketizer<FList, 257, 512, 64>,
+          alb::segregator<
+            1024, alb::bucketizer<FList, 513, 1024, 128>,
+            alb::segregator<
+              2048, alb::bucketizer<FList, 1025, 2048, 256>,
+              alb::segregator<3584, alb::bucketizer<FList, 2049, 3584, 512>,
+                              alb::segregator<4072 * 1024,
+                                              alb::cascading_allocator<
+                                                alb::heap<alb::mallocator, 1024, 4096>>,
+                                              alb::mallocator>>>>>>>>;
+
+  /**
+   * An allocator or composition under test
+   */
+  struct benchmark_case {
+    const char *name;
+    std::function<run_result(workload, const run_input &, perf_counters *)> run;
+    std::function<void(const run_input &, size_t, const fragmentation_sink &)> run_fragmentation;
+    std::function<latency_result(latency_workload, unsigned, const run_input &)> run_latency;
+  };
+
+  template <class Allocator>
+  benchmark_case make_case(const char *name)
+  {
+    return benchmark_case{name, &run<Allocator>, &run_fragmentation<Allocator>,
+                          &run_latency<Allocator>};
+  }
+
+  /**
+   * Returns all allocators and compositions under test
+   */
+  inline std::vector<benchmark_case> all_benchmark_cases()
+  {
+    return {make_case<alb::mallocator>("mallocator"),
+            make_case<heap_under_test>("heap"),
+            make_case<shared_heap_under_test>("shared_heap"),
+            make_case<buddy_allocator_under_test>("buddy_allocator"),
+            make_case<freelist_under_test>("freelist"),
+            make_case<bucketizer_under_test>("bucketizer"),
+            make_case<slab_allocator_under_test>("slab_allocator"),
+            make_case<stack_allocator_under_test>("stack_allocator"),
+            make_case<tlsf_allocator_under_test>("tlsf_allocator"),
+            make_case<cascading_allocator_under_test>("cascading_allocator"),
+            make_case<readme_composition>("readme_composition")};
+  }
+
+  // The thread safe allocators for the threaded workloads
+
+  using shared_freelist_under_test =
+    alb::segregator<64, alb::shared_freelist<alb::mallocator, 0, 64>, alb::mallocator>;
+
+  // Larger requests and those beyond the capacity fail in the pool
+  using shared_pool_under_test =
+    alb::fallback_allocator<alb::shared_pool<64, 16384>, alb::mallocator>;
+
+  // The blocks of the freelists and of the mallocator are interchangeable
+  // between the CPUs
+  using per_cpu_freelist_under_test = alb::per_cpu_allocator<freelist_under_test>;
+
+  using shared_cascading_allocator_under_test =
+    alb::shared_cascading_allocator<alb::shared_heap<alb::mallocator, 16384, 64>>;
+
+  /**
+   * Returns all thread safe allocators and compositions under test
+   */
+  inline std::vector<threaded_benchmark_case> all_threaded_benchmark_cases()
+  {
+    return {make_threaded_case<alb::mallocator>("mallocator"),
+            make_threaded_case<shared_heap_under_test>("shared_heap"),
+            make_threaded_case<shared_freelist_under_test>("shared_freelist"),
+            make_threaded_case<shared_pool_under_test>("shared_pool"),
+            make_threaded_case<per_cpu_freelist_under_test>("per_cpu_freelist"),
+            make_threaded_case<shared_cascading_allocator_under_test>(
+              "shared_cascading_allocator")};
+  }
+}
@@ -0,0 +1,150 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "perf_counters.hpp"
+#include "size_distribution.hpp"
+
+#include <alb/allocator_base.hpp>
+
+#include <chrono>
+#include <random>
+#include <vector>
+
+namespace alb_benchmark {
+
+  /**
+   * The patterns of allocations and deallocations
+   */
+  enum class workload {
+    /// Each block is freed directly after its allocation
+    pairs,
+    /// A window of live_set_size blocks, in which each step frees a randomly
+    /// chosen block and allocates a new one in its place
+    live_set
+  };
+
+  static constexpr size_t live_set_size = 1024;
+
+  static const workload all_workloads[] = {workload::pairs, workload::live_set};
+
+  inline const char *name_of(workload w)
+  {
+    switch (w) {
+    case workload::pairs:
+      return "pairs";
+    case workload::live_set:
+      return "live_set";
+    }
+    return "unknown";
+  }
+
+  /**
+   * The requests of one run. They are prepared before the measurement.
+   */
+  struct run_input {
+    std::vector<size_t> sizes;
+    std::vector<size_t> slots;
+
+    run_input(size_distribution d, size_t count)
+      : sizes(make_sizes(d, count))
+    {
+      std::mt19937_64 engine(4711);
+      std::uniform_int_distribution<size_t> slot(0, live_set_size - 1);
+      slots.reserve(count);
+      for (size_t i = 0; i < count; ++i) {
+        slots.push_back(slot(engine));
+      }
+    }
+  };
+
+  /**
+   * The outcome of one run. Each allocate and each deallocate is one operation.
+   */
+  struct run_result {
+    size_t operations = 0;
+    size_t failed_allocations = 0;
+    double seconds = 0.0;
+    /// The hardware events of the run, if they were counted
+    perf_counter_values counters;
+  };
+
+  namespace internal {
+    // Touch the memory, so that the allocation cannot be optimized away and
+    // the page faults of fresh memory are part of the measurement
+    inline void touch(const alb::block &b)
+    {
+      if (b) {
+        *static_cast<volatile char *>(b.ptr) = 1;
+      }
+    }
+  }
+
+  /**
+   * Measures the workload on a new instance of the Allocator. The construction
+   * and the destruction of the allocator are not part of the measurement.
+   * The instance lives on the stack, because e.g. the stack_allocator cannot be
+   * created on the heap.
+   * If counters are given, they count the hardware events of the measurement.
+   */
+  template <class Allocator>
+  run_result run(workload w, const run_input &input, perf_counters *counters)
+  {
+    Allocator allocator;
+    std::vector<alb::block> live(w == workload::live_set ? live_set_size : 0);
+    run_result result;
+
+    if (counters) {
+      counters->start();
+    }
+    const auto start = std::chrono::steady_clock::now();
+    if (w == workload::pairs) {
+      for (auto n : input.sizes) {
+        auto b = allocator.allocate(n);
+        internal::touch(b);
+        if (b) {
+          allocator.deallocate(b);
+          result.operations += 2;
+        }
+        else {
+          ++result.failed_allocations;
+          ++result.operations;
+        }
+      }
+    }
+    else {
+      for (size_t i = 0; i < input.sizes.size(); ++i) {
+        auto &b = live[input.slots[i]];
+        if (b) {
+          allocator.deallocate(b);
+          ++result.operations;
+        }
+        b = allocator.allocate(input.sizes[i]);
+        internal::touch(b);
+        ++result.operations;
+        if (!b) {
+          ++result.failed_allocations;
+        }
+      }
+    }
+    result.seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (counters) {
+      result.counters = counters->stop();
+    }
+
+    for (auto &b : live) {
+      if (b) {
+        allocator.deallocate(b);
+      }
+    }
+    return result;
+  }
+}
@@ -0,0 +1,132 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "benchmark_runner.hpp"
+#include "fragmentation.hpp"
+#include "latency.hpp"
+
+#include <cstdio>
+#include <string>
+#include <utility>
+
+namespace alb_benchmark {
+
+  /**
+   * Writes the results as comma separated values, one line per run, so that
+   * the output of several commits can be joined by the label.
+   */
+  class csv_writer {
+    FILE *out_;
+    std::string label_;
+    bool withCounters_;
+
+  public:
+    csv_writer(FILE *out, std::string label)
+      : out_(out)
+      , label_(std::move(label))
+      , withCounters_(false)
+    {
+    }
+
+    /**
+     * Adds the columns of the hardware events per operation to the header and
+     * the rows. They stay empty for an event, that was not counted.
+     */
+    void add_counter_columns()
+    {
+      withCounters_ = true;
+    }
+
+    void header() const
+    {
+      fprintf(out_, "label,allocator,workload,distribution,threads,operations,failed_allocations,"
+                    "seconds,ops_per_sec,ns_per_op");
+      if (withCounters_) {
+        for (auto c : all_perf_counters) {
+          fprintf(out_, ",%s_per_op", name_of(c));
+        }
+      }
+      fprintf(out_, "\n");
+    }
+
+    template <typename Workload>
+    void row(const char *allocator, Workload w, size_distribution d, unsigned threads,
+             const run_result &r) const
+    {
+      const auto opsPerSecond = r.seconds > 0.0 ? r.operations / r.seconds : 0.0;
+      const auto nsPerOperation = r.operations > 0 ? r.seconds * 1e9 / r.operations : 0.0;
+      fprintf(out_, "%s,%s,%s,%s,%u,%zu,%zu,%.6f,%.0f,%.2f", label_.c_str(), allocator,
+              name_of(w), name_of(d), threads, r.operations, r.failed_allocations, r.seconds,
+              opsPerSecond, nsPerOperation);
+      if (withCounters_) {
+        for (unsigned i = 0; i < number_of_perf_counters; ++i) {
+          if (r.counters.valid[i] && r.operations > 0) {
+            fprintf(out_, ",%.3f", static_cast<double>(r.counters.values[i]) / r.operations);
+          }
+          else {
+            fprintf(out_, ",");
+          }
+        }
+      }
+      fprintf(out_, "\n");
+      fflush(out_);
+    }
+
+    void fragmentation_header() const
+    {
+      fprintf(out_, "label,allocator,distribution,step,live_blocks,requested_bytes,block_bytes,"
+                    "rss_bytes,failed_allocations,heap_free_bytes,heap_largest_free_bytes,"
+                    "heap_failed_with_enough_space\n");
+    }
+
+    /**
+     * The heap columns stay empty, if the allocator does not contain a heap
+     */
+    void fragmentation_row(const char *allocator, size_distribution d,
+                           const fragmentation_sample &s) const
+    {
+      fprintf(out_, "%s,%s,%s,%zu,%zu,%zu,%zu,%zu,%zu", label_.c_str(), allocator, name_of(d),
+              s.step, s.live_blocks, s.requested_bytes, s.block_bytes, s.rss_bytes,
+              s.failed_allocations);
+      if (s.has_heap) {
+        fprintf(out_, ",%zu,%zu,%zu\n", s.heap_free_bytes, s.heap_largest_free_bytes,
+                s.heap_failed_with_enough_space);
+      }
+      else {
+        fprintf(out_, ",,,\n");
+      }
+      fflush(out_);
+    }
+
+    void latency_header() const
+    {
+      fprintf(out_, "label,allocator,workload,distribution,threads,operation,count,p50_ns,p99_ns,"
+                    "p99.9_ns,max_ns\n");
+    }
+
+    /**
+     * Writes one line per operation with the percentiles in nanoseconds
+     */
+    void latency_rows(const char *allocator, latency_workload w, size_distribution d,
+                      unsigned threads, const latency_result &r, double nsPerTick) const
+    {
+      for (auto o : all_latency_operations) {
+        const auto &h = r[o];
+        fprintf(out_, "%s,%s,%s,%s,%u,%s,%llu,%.1f,%.1f,%.1f,%.1f\n", label_.c_str(), allocator,
+                name_of(w), name_of(d), threads, name_of(o),
+                static_cast<unsigned long long>(h.count()), h.percentile(50.0) * nsPerTick,
+                h.percentile(99.0) * nsPerTick, h.percentile(99.9) * nsPerTick,
+                h.max() * nsPerTick);
+      }
+      fflush(out_);
+    }
+  };
+}
@@ -0,0 +1,242 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "benchmark_runner.hpp"
+
+#include <alb/cascading_allocator.hpp>
+#include <alb/fallback_allocator.hpp>
+#include <alb/heap.hpp>
+#include <alb/segregator.hpp>
+#include <alb/shared_heap.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+#if defined(__linux__)
+#include <unistd.h>
+#endif
+
+namespace alb_benchmark {
+
+  /**
+   * The live set of the fragmentation mode. It is larger than the one of the
+   * throughput runs, so that the heaps under test get filled up.
+   */
+  static constexpr size_t fragmentation_live_set_size = 4096;
+
+  /**
+   * The memory usage at one point of a fragmentation run. All byte counts
+   * refer to the live blocks at that point.
+   */
+  struct fragmentation_sample {
+    size_t step = 0;
+    size_t live_blocks = 0;
+    /// The sum of the requested sizes
+    size_t requested_bytes = 0;
+    /// The sum of the lengths of the blocks that the allocator handed out
+    size_t block_bytes = 0;
+    /// The resident set size of the whole process, 0 if it is unknown
+    size_t rss_bytes = 0;
+    size_t failed_allocations = 0;
+    /// True, if the allocator contains alb::heap instances, that the following
+    /// refer to
+    bool has_heap = false;
+    /// The sum over all heaps
+    size_t heap_free_bytes = 0;
+    /// The largest free run of all heaps
+    size_t heap_largest_free_bytes = 0;
+    /// Requests that a heap, which was asked, could not serve, although it had
+    /// enough free space in total
+    size_t heap_failed_with_enough_space = 0;
+  };
+
+  using fragmentation_sink = std::function<void(const fragmentation_sample &)>;
+
+  /**
+   * Returns the resident set size of the process or 0, if it is not available
+   * on this platform
+   */
+  inline size_t rss_bytes()
+  {
+#if defined(__linux__)
+    size_t pages = 0, residentPages = 0;
+    auto statm = ::fopen("/proc/self/statm", "r");
+    if (!statm) {
+      return 0;
+    }
+    const auto read = ::fscanf(statm, "%zu %zu", &pages, &residentPages);
+    ::fclose(statm);
+    return read == 2 ? residentPages * static_cast<size_t>(::sysconf(_SC_PAGESIZE)) : 0;
+#else
+    return 0;
+#endif
+  }
+
+  namespace internal {
+
+    // Selects all heaps of an allocator in for_each_heap
+    static constexpr size_t all_sizes = static_cast<size_t>(-1);
+
+    // Within the class all overloads are visible to each other, independent
+    // of their order, so the compositions may be nested in any way
+    struct heap_visitor {
+      template <class Allocator, typename Function>
+      static void visit(const Allocator &, size_t, Function &&)
+      {
+      }
+
+      template <class Allocator, size_t NumberOfChunks, size_t ChunkSize, typename Function>
+      static void visit(const alb::heap<Allocator, NumberOfChunks, ChunkSize> &h, size_t,
+                        Function &&f)
+      {
+        f(h);
+      }
+
+      template <class Allocator, size_t NumberOfChunks, size_t ChunkSize, typename Function>
+      static void visit(const alb::shared_heap<Allocator, NumberOfChunks, ChunkSize> &h, size_t,
+                        Function &&f)
+      {
+        f(h);
+      }
+
+      template <class Primary, class Fallback, typename Function>
+      static void visit(const alb::fallback_allocator<Primary, Fallback> &a, size_t n,
+                        Function &&f)
+      {
+        visit(a.primary_part(), n, f);
+      }
+
+      template <class Allocator, typename Function>
+      static void visit(const alb::cascading_allocator<Allocator> &a, size_t n, Function &&f)
+      {
+        a.for_each_allocator([n, &f](const Allocator &node) { visit(node, n, f); });
+      }
+
+      template <class Allocator, typename Function>
+      static void visit(const alb::shared_cascading_allocator<Allocator> &a, size_t n,
+                        Function &&f)
+      {
+        a.for_each_allocator([n, &f](const Allocator &node) { visit(node, n, f); });
+      }
+
+      template <size_t Threshold, class SmallAllocator, class LargeAllocator, typename Function>
+      static void visit(const alb::segregator<Threshold, SmallAllocator, LargeAllocator> &a,
+                        size_t n, Function &&f)
+      {
+        if (n <= Threshold || n == all_sizes) {
+          visit(a.small_part(), n, f);
+        }
+        if (n > Threshold) {
+          visit(a.large_part(), n, f);
+        }
+      }
+    };
+
+    // Calls f with each heap of the allocator, that a request of n bytes is
+    // sent to, in the order in which they are asked, resp. with all heaps for
+    // all_sizes. A heap is found on its own, as the primary part of a
+    // fallback_allocator, within the nodes of a cascading_allocator and within
+    // the parts of a segregator.
+    template <class Allocator, typename Function>
+    void for_each_heap(const Allocator &a, size_t n, Function &&f)
+    {
+      heap_visitor::visit(a, n, f);
+    }
+  }
+
+  /**
+   * Runs the live set workload with fragmentation_live_set_size blocks on a new
+   * instance of the Allocator and passes numberOfSamples evenly spread samples
+   * of the memory usage, and one before the first step, to the sink.
+   * The process RSS also contains the memory, that the previous runs returned
+   * to the C runtime but not to the system, so it is only comparable between
+   * runs in the same order.
+   */
+  template <class Allocator>
+  void run_fragmentation(const run_input &input, size_t numberOfSamples,
+                         const fragmentation_sink &sink)
+  {
+    struct live_block {
+      alb::block b;
+      size_t requested;
+    };
+
+    Allocator allocator;
+    std::vector<live_block> live(fragmentation_live_set_size, live_block{alb::block(), 0});
+    fragmentation_sample sample;
+    const auto sampleDistance = std::max(size_t(1), input.sizes.size() / numberOfSamples);
+
+    auto takeSample = [&](size_t step) {
+      sample.step = step;
+      sample.rss_bytes = rss_bytes();
+      sample.heap_free_bytes = 0;
+      sample.heap_largest_free_bytes = 0;
+      internal::for_each_heap(allocator, internal::all_sizes, [&sample](const auto &h) {
+        const auto summary = h.free_chunks();
+        sample.has_heap = true;
+        sample.heap_free_bytes += summary.free_chunks * h.chunk_size();
+        sample.heap_largest_free_bytes = std::max(sample.heap_largest_free_bytes,
+                                                  summary.largest_free_run * h.chunk_size());
+      });
+      sink(sample);
+    };
+
+    takeSample(0);
+    for (size_t i = 0; i < input.sizes.size(); ++i) {
+      auto &l = live[(input.slots[i] * 4 + i) % fragmentation_live_set_size];
+      if (l.b) {
+        sample.requested_bytes -= l.requested;
+        sample.block_bytes -= l.b.length;
+        --sample.live_blocks;
+        allocator.deallocate(l.b);
+      }
+      const auto n = input.sizes[i];
+      l.b = allocator.allocate(n);
+      l.requested = n;
+      if (l.b) {
+        // Like a program writes into its blocks, so that their pages become resident
+        ::memset(l.b.ptr, 0x5a, n);
+        sample.requested_bytes += n;
+        sample.block_bytes += l.b.length;
+        ++sample.live_blocks;
+        // Only the heaps in front of the one, that served the request, were asked
+        bool served = false;
+        bool failedWithEnoughSpace = false;
+        internal::for_each_heap(allocator, n, [&](const auto &h) {
+          if (served || h.owns(l.b)) {
+            served = true;
+          }
+          else if (h.free_chunks().free_chunks * h.chunk_size() >= n) {
+            failedWithEnoughSpace = true;
+          }
+        });
+        if (failedWithEnoughSpace) {
+          ++sample.heap_failed_with_enough_space;
+        }
+      }
+      else {
+        ++sample.failed_allocations;
+      }
+      if ((i + 1) % sampleDistance == 0) {
+        takeSample(i + 1);
+      }
+    }
+
+    for (auto &l : live) {
+      if (l.b) {
+        allocator.deallocate(l.b);
+      }
+    }
+  }
+}
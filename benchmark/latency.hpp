@@ -0,0 +1,277 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "benchmark_runner.hpp"
+#include "latency_histogram.hpp"
+
+#include <alb/internal/tsc_clock.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace alb_benchmark {
+
+  /**
+   * The patterns of the latency measurement
+   */
+  enum class latency_workload {
+    /// A filled live set, in which each step frees a randomly chosen block and
+    /// allocates a new one in its place. Every latency_reallocate_distance-th
+    /// step reallocates the block instead.
+    steady_state,
+    /// Repeatedly allocates latency_burst_size blocks at once, reallocates
+    /// every fourth of them and frees them all again, so that e.g. the refills
+    /// of freelists and the creation of new cascading nodes show up
+    burst
+  };
+
+  static constexpr size_t latency_reallocate_distance = 16;
+  static constexpr size_t latency_burst_size = 4096;
+
+  static const latency_workload all_latency_workloads[] = {latency_workload::steady_state,
+                                                           latency_workload::burst};
+
+  inline const char *name_of(latency_workload w)
+  {
+    switch (w) {
+    case latency_workload::steady_state:
+      return "steady_state";
+    case latency_workload::burst:
+      return "burst";
+    }
+    return "unknown";
+  }
+
+  /**
+   * The timed operations
+   */
+  enum class latency_operation { allocate, deallocate, reallocate };
+
+  static constexpr unsigned number_of_latency_operations = 3;
+
+  static const latency_operation all_latency_operations[] = {
+    latency_operation::allocate, latency_operation::deallocate, latency_operation::reallocate};
+
+  inline const char *name_of(latency_operation o)
+  {
+    switch (o) {
+    case latency_operation::allocate:
+      return "allocate";
+    case latency_operation::deallocate:
+      return "deallocate";
+    case latency_operation::reallocate:
+      return "reallocate";
+    }
+    return "unknown";
+  }
+
+  /**
+   * The durations of all operations of one run in ticks of the
+   * alb::internal::tsc_clock, reduced by the costs of reading the clock
+   */
+  struct latency_result {
+    latency_histogram histograms[number_of_latency_operations];
+    size_t failed_allocations = 0;
+
+    const latency_histogram &operator[](latency_operation o) const
+    {
+      return histograms[static_cast<unsigned>(o)];
+    }
+
+    void merge(const latency_result &other)
+    {
+      for (unsigned i = 0; i < number_of_latency_operations; ++i) {
+        histograms[i].merge(other.histograms[i]);
+      }
+      failed_allocations += other.failed_allocations;
+    }
+  };
+
+  namespace internal {
+    using alb::internal::tsc_clock;
+
+    // The smallest duration between two reads of the clock
+    inline tsc_clock::ticks clock_overhead()
+    {
+      auto result = ~tsc_clock::ticks(0);
+      for (int i = 0; i < 1000; ++i) {
+        const auto start = tsc_clock::now();
+        result = std::min(result, tsc_clock::now() - start);
+      }
+      return result;
+    }
+
+    template <class Allocator>
+    class latency_probe {
+      Allocator &allocator_;
+      latency_result &result_;
+      const tsc_clock::ticks overhead_;
+
+      void record(latency_operation o, tsc_clock::ticks start, tsc_clock::ticks end)
+      {
+        const auto duration = end - start;
+        result_.histograms[static_cast<unsigned>(o)].record(
+          duration > overhead_ ? duration - overhead_ : 0);
+      }
+
+    public:
+      latency_probe(Allocator &allocator, latency_result &result, tsc_clock::ticks overhead)
+        : allocator_(allocator)
+        , result_(result)
+        , overhead_(overhead)
+      {
+      }
+
+      alb::block allocate(size_t n)
+      {
+        const auto start = tsc_clock::now();
+        auto b = allocator_.allocate(n);
+        record(latency_operation::allocate, start, tsc_clock::now());
+        touch(b);
+        if (!b) {
+          ++result_.failed_allocations;
+        }
+        return b;
+      }
+
+      void deallocate(alb::block &b)
+      {
+        if (!b) {
+          return;
+        }
+        const auto start = tsc_clock::now();
+        allocator_.deallocate(b);
+        record(latency_operation::deallocate, start, tsc_clock::now());
+      }
+
+      void reallocate(alb::block &b, size_t n)
+      {
+        const auto start = tsc_clock::now();
+        allocator_.reallocate(b, n);
+        record(latency_operation::reallocate, start, tsc_clock::now());
+        touch(b);
+      }
+    };
+
+    template <class Allocator>
+    void steady_state(latency_probe<Allocator> &probe, Allocator &allocator,
+                      const run_input &input)
+    {
+      // The filling of the live set is not measured
+      std::vector<alb::block> live(live_set_size);
+      for (size_t i = 0; i < live.size(); ++i) {
+        live[i] = allocator.allocate(input.sizes[i % input.sizes.size()]);
+      }
+      for (size_t i = 0; i < input.sizes.size(); ++i) {
+        auto &b = live[input.slots[i]];
+        if (b && (i + 1) % latency_reallocate_distance == 0) {
+          probe.reallocate(b, input.sizes[i]);
+        }
+        else {
+          probe.deallocate(b);
+          b = probe.allocate(input.sizes[i]);
+        }
+      }
+      for (auto &b : live) {
+        if (b) {
+          allocator.deallocate(b);
+        }
+      }
+    }
+
+    template <class Allocator>
+    void burst(latency_probe<Allocator> &probe, const run_input &input)
+    {
+      std::vector<alb::block> blocks(latency_burst_size);
+      for (size_t i = 0; i < input.sizes.size(); i += latency_burst_size) {
+        const auto n = std::min(latency_burst_size, input.sizes.size() - i);
+        for (size_t j = 0; j < n; ++j) {
+          blocks[j] = probe.allocate(input.sizes[i + j]);
+        }
+        for (size_t j = 0; j < n; j += 4) {
+          if (blocks[j]) {
+            probe.reallocate(blocks[j], input.sizes[i + n - 1 - j]);
+          }
+        }
+        for (size_t j = 0; j < n; ++j) {
+          probe.deallocate(blocks[j]);
+        }
+      }
+    }
+  }
+
+  /**
+   * Times each allocate, deallocate and reallocate of the workload on a new
+   * instance of the Allocator. With more than one thread, all threads run
+   * the workload at the same time on the shared instance, so that the waits
+   * for its locks become part of the durations.
+   */
+  template <class Allocator>
+  latency_result run_latency(latency_workload w, unsigned threads, const run_input &input)
+  {
+    Allocator allocator;
+    const auto overhead = internal::clock_overhead();
+    std::vector<latency_result> results(threads);
+    std::atomic<unsigned> ready(0);
+    std::atomic<bool> go(false);
+
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < threads; ++i) {
+      workers.emplace_back([&, i] {
+        internal::latency_probe<Allocator> probe(allocator, results[i], overhead);
+        ++ready;
+        while (!go.load()) {
+          std::this_thread::yield();
+        }
+        if (w == latency_workload::steady_state) {
+          internal::steady_state(probe, allocator, input);
+        }
+        else {
+          internal::burst(probe, input);
+        }
+      });
+    }
+    while (ready.load() < threads) {
+      std::this_thread::yield();
+    }
+    go.store(true);
+    for (auto &t : workers) {
+      t.join();
+    }
+
+    latency_result result;
+    for (auto &r : results) {
+      result.merge(r);
+    }
+    return result;
+  }
+
+  /**
+   * Returns the nanoseconds per tick of the alb::internal::tsc_clock, measured
+   * against the steady_clock for the given duration
+   */
+  inline double nanoseconds_per_tick(std::chrono::milliseconds duration)
+  {
+    using alb::internal::tsc_clock;
+    const auto begin = std::chrono::steady_clock::now();
+    const auto beginTicks = tsc_clock::now();
+    std::chrono::steady_clock::time_point end;
+    do {
+      end = std::chrono::steady_clock::now();
+    } while (end - begin < duration);
+    const auto ticks = tsc_clock::now() - beginTicks;
+    return ticks > 0 ? std::chrono::duration<double, std::nano>(end - begin).count() / ticks
+                     : 1.0;
+  }
+}
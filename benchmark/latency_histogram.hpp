@@ -0,0 +1,128 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace alb_benchmark {
+
+  namespace internal {
+    inline unsigned highest_bit(uint64_t v)
+    {
+#if defined(_MSC_VER)
+      unsigned long result;
+      _BitScanReverse64(&result, v);
+      return static_cast<unsigned>(result);
+#else
+      return 63u - static_cast<unsigned>(__builtin_clzll(v));
+#endif
+    }
+  }
+
+  /**
+   * A histogram of durations in the manner of HdrHistogram: Each power of two
+   * is divided into sub_buckets linear buckets, so every recorded value is
+   * kept with a relative error below 1 / sub_buckets over the whole range of
+   * 64 bit, without any allocation while recording.
+   */
+  class latency_histogram {
+  public:
+    static constexpr unsigned sub_bucket_bits = 5;
+    static constexpr unsigned sub_buckets = 1u << sub_bucket_bits;
+    static constexpr unsigned number_of_buckets = (64 - sub_bucket_bits + 1) * sub_buckets;
+
+  private:
+    std::vector<uint64_t> counts_;
+    uint64_t count_;
+    uint64_t max_;
+
+    static unsigned index_of(uint64_t value) noexcept
+    {
+      if (value < sub_buckets) {
+        return static_cast<unsigned>(value);
+      }
+      const auto shift = internal::highest_bit(value) - sub_bucket_bits;
+      return (shift + 1) * sub_buckets + static_cast<unsigned>((value >> shift) - sub_buckets);
+    }
+
+    // The largest value that falls into the bucket
+    static uint64_t highest_value_of(unsigned index) noexcept
+    {
+      if (index < sub_buckets) {
+        return index;
+      }
+      const auto shift = index / sub_buckets - 1;
+      const auto lowest = static_cast<uint64_t>(index % sub_buckets + sub_buckets) << shift;
+      return lowest + ((uint64_t(1) << shift) - 1);
+    }
+
+  public:
+    latency_histogram()
+      : counts_(number_of_buckets, 0)
+      , count_(0)
+      , max_(0)
+    {
+    }
+
+    void record(uint64_t value) noexcept
+    {
+      ++counts_[index_of(value)];
+      ++count_;
+      max_ = std::max(max_, value);
+    }
+
+    void merge(const latency_histogram &other) noexcept
+    {
+      for (unsigned i = 0; i < number_of_buckets; ++i) {
+        counts_[i] += other.counts_[i];
+      }
+      count_ += other.count_;
+      max_ = std::max(max_, other.max_);
+    }
+
+    uint64_t count() const noexcept
+    {
+      return count_;
+    }
+
+    uint64_t max() const noexcept
+    {
+      return max_;
+    }
+
+    /**
+     * Returns the value, below or equal to which the given percentage of all
+     * recorded values are, e.g. percentile(99.9). The value is the upper bound
+     * of its bucket, but never larger than the maximum.
+     */
+    uint64_t percentile(double percent) const noexcept
+    {
+      if (count_ == 0) {
+        return 0;
+      }
+      const auto rank = std::max(uint64_t(1), static_cast<uint64_t>(std::ceil(percent / 100.0 * count_)));
+      uint64_t cumulated = 0;
+      for (unsigned i = 0; i < number_of_buckets; ++i) {
+        cumulated += counts_[i];
+        if (cumulated >= rank) {
+          return std::min(highest_value_of(i), max_);
+        }
+      }
+      return max_;
+    }
+  };
+}
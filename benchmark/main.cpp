@@ -0,0 +1,250 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+
+// ALBBenchmark measures the throughput of the allocators and compositions
+// for several workloads and size distributions and writes the results as CSV
+// to stdout, e.g.
+//
+//   ALBBenchmark --label $(git rev-parse --short HEAD) > new.csv
+//
+// Each run is repeated and only the fastest repetition is reported, so that
+// the results of two commits can be compared line by line. The threaded suite
+// runs the thread safe allocators with 1, 2, 4, ... threads, so that the lines
+// of one allocator and workload form its scaling curve.
+// The fragmentation suite writes, with its own columns, samples of the
+// requested bytes, the handed out bytes and the process RSS over a live set
+// run, and for the heaps their free and largest free bytes.
+// The latency suite times each allocate, deallocate and reallocate and writes
+// their percentiles per operation, single threaded for all allocators and
+// with 2, 4, ... threads for the thread safe ones.
+// With --counters the single threaded runs count the cycles, instructions,
+// cache, TLB and branch misses per operation with perf_event_open. If no
+// counter is available, only the wall time is reported.
+
+#include "allocators_under_test.hpp"
+#include "csv_writer.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace {
+  struct options {
+    size_t operations = 200000;
+    unsigned repetitions = 3;
+    std::string filter;
+    std::string label = "current";
+    bool header = true;
+    bool single = true;
+    bool threaded = true;
+    bool fragmentation = false;
+    bool latency = false;
+    bool counters = false;
+    size_t samples = 20;
+    unsigned maxThreads = std::max(2u, std::thread::hardware_concurrency());
+  };
+
+  void print_usage(const char *program)
+  {
+    fprintf(stderr,
+            "usage: %s [--operations <n>] [--repetitions <n>] [--filter <text>] "
+            "[--label <text>] [--no-header] [--suite single|threaded|all|fragmentation|latency] [--threads <n>] [--samples <n>] [--counters]\n"
+            "  --operations   number of allocations per run (default 200000)\n"
+            "  --repetitions  runs per measurement, the fastest is reported (default 3)\n"
+            "  --filter       only run the allocators whose name contains the text\n"
+            "  --label        first column of each line, e.g. the commit\n"
+            "  --no-header    omit the CSV header line\n"
+            "  --suite        only the single or the multithreaded runs (default all),\n"
+            "                 or the memory usage over time or the latency percentiles\n"
+            "  --threads      maximum number of threads (default number of cores)\n"
+            "  --samples      samples per fragmentation run (default 20)\n"
+            "  --counters     hardware events per operation of the single threaded runs\n",
+            program);
+  }
+
+  bool parse(int argc, char *argv[], options &o)
+  {
+    for (int i = 1; i < argc; ++i) {
+      const bool hasValue = i + 1 < argc;
+      if (strcmp(argv[i], "--operations") == 0 && hasValue) {
+        o.operations = strtoull(argv[++i], nullptr, 10);
+      }
+      else if (strcmp(argv[i], "--repetitions") == 0 && hasValue) {
+        o.repetitions = static_cast<unsigned>(strtoul(argv[++i], nullptr, 10));
+      }
+      else if (strcmp(argv[i], "--filter") == 0 && hasValue) {
+        o.filter = argv[++i];
+      }
+      else if (strcmp(argv[i], "--label") == 0 && hasValue) {
+        o.label = argv[++i];
+      }
+      else if (strcmp(argv[i], "--no-header") == 0) {
+        o.header = false;
+      }
+      else if (strcmp(argv[i], "--suite") == 0 && hasValue) {
+        const std::string suite = argv[++i];
+        o.single = suite == "single" || suite == "all";
+        o.threaded = suite == "threaded" || suite == "all";
+        o.fragmentation = suite == "fragmentation";
+        o.latency = suite == "latency";
+      }
+      else if (strcmp(argv[i], "--samples") == 0 && hasValue) {
+        o.samples = strtoull(argv[++i], nullptr, 10);
+      }
+      else if (strcmp(argv[i], "--counters") == 0) {
+        o.counters = true;
+      }
+      else if (strcmp(argv[i], "--threads") == 0 && hasValue) {
+        o.maxThreads = static_cast<unsigned>(strtoul(argv[++i], nullptr, 10));
+      }
+      else {
+        return false;
+      }
+    }
+    return o.operations > 0 && o.repetitions > 0 && o.maxThreads > 0 && o.samples > 0 &&
+           (o.single || o.threaded || o.fragmentation || o.latency);
+  }
+
+  bool selected(const options &o, const char *name)
+  {
+    return o.filter.empty() || std::string(name).find(o.filter) != std::string::npos;
+  }
+
+  template <class Case, typename Run>
+  alb_benchmark::run_result fastest(const options &o, const Case &c, Run &&run)
+  {
+    alb_benchmark::run_result best;
+    for (unsigned r = 0; r < o.repetitions; ++r) {
+      const auto result = run(c);
+      if (r == 0 || result.seconds < best.seconds) {
+        best = result;
+      }
+    }
+    return best;
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  using namespace alb_benchmark;
+
+  options o;
+  if (!parse(argc, argv, o)) {
+    print_usage(argv[0]);
+    return 1;
+  }
+
+  csv_writer out(stdout, o.label);
+  if (o.fragmentation) {
+    if (o.header) {
+      out.fragmentation_header();
+    }
+    for (auto d : all_size_distributions) {
+      const run_input input(d, o.operations);
+      for (auto &c : all_benchmark_cases()) {
+        if (selected(o, c.name)) {
+          c.run_fragmentation(input, o.samples, [&](const fragmentation_sample &s) {
+            out.fragmentation_row(c.name, d, s);
+          });
+        }
+      }
+    }
+    return 0;
+  }
+
+  if (o.latency) {
+    if (o.header) {
+      out.latency_header();
+    }
+    const auto nsPerTick = nanoseconds_per_tick(std::chrono::milliseconds(100));
+    for (auto d : all_size_distributions) {
+      const run_input input(d, o.operations);
+      for (auto &c : all_benchmark_cases()) {
+        if (selected(o, c.name)) {
+          for (auto w : all_latency_workloads) {
+            out.latency_rows(c.name, w, d, 1, c.run_latency(w, 1, input), nsPerTick);
+          }
+        }
+      }
+    }
+    const auto d = size_distribution::power_law;
+    const run_input input(d, o.operations);
+    for (auto &c : all_threaded_benchmark_cases()) {
+      if (!selected(o, c.name)) {
+        continue;
+      }
+      for (auto threads : thread_counts(o.maxThreads)) {
+        if (threads < 2) {
+          continue;
+        }
+        for (auto w : all_latency_workloads) {
+          out.latency_rows(c.name, w, d, threads, c.run_latency(w, threads, input), nsPerTick);
+        }
+      }
+    }
+    return 0;
+  }
+
+  std::unique_ptr<perf_counters> counters;
+  if (o.counters) {
+    counters.reset(new perf_counters());
+    if (counters->available()) {
+      out.add_counter_columns();
+    }
+    else {
+      fprintf(stderr, "No hardware counters available, only the wall time is reported\n");
+      counters.reset();
+    }
+  }
+  if (o.header) {
+    out.header();
+  }
+
+  for (auto d : all_size_distributions) {
+    if (!o.single) {
+      break;
+    }
+    const run_input input(d, o.operations);
+    for (auto &c : all_benchmark_cases()) {
+      if (!selected(o, c.name)) {
+        continue;
+      }
+      for (auto w : all_workloads) {
+        out.row(c.name, w, d, 1,
+                fastest(o, c, [&](const benchmark_case &x) { return x.run(w, input, counters.get()); }));
+      }
+    }
+  }
+
+  if (o.threaded) {
+    const auto d = size_distribution::power_law;
+    const run_input input(d, o.operations);
+    for (auto &c : all_threaded_benchmark_cases()) {
+      if (!selected(o, c.name)) {
+        continue;
+      }
+      for (auto w : all_threaded_workloads) {
+        for (auto threads : thread_counts(o.maxThreads)) {
+          if (w == threaded_workload::xmalloc && threads < 2) {
+            continue;
+          }
+          out.row(c.name, w, d, threads, fastest(o, c, [&](const threaded_benchmark_case &x) {
+                    return x.run(w, threads, input);
+                  }));
+        }
+      }
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,192 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <cstdint>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace alb_benchmark {
+
+  /**
+   * The hardware events, that the benchmark can count
+   */
+  enum class perf_counter {
+    cycles,
+    instructions,
+    l1d_misses,
+    llc_misses,
+    dtlb_misses,
+    branch_misses
+  };
+
+  static constexpr unsigned number_of_perf_counters = 6;
+
+  static const perf_counter all_perf_counters[] = {
+    perf_counter::cycles,      perf_counter::instructions, perf_counter::l1d_misses,
+    perf_counter::llc_misses, perf_counter::dtlb_misses,  perf_counter::branch_misses};
+
+  inline const char *name_of(perf_counter c)
+  {
+    switch (c) {
+    case perf_counter::cycles:
+      return "cycles";
+    case perf_counter::instructions:
+      return "instructions";
+    case perf_counter::l1d_misses:
+      return "l1d_misses";
+    case perf_counter::llc_misses:
+      return "llc_misses";
+    case perf_counter::dtlb_misses:
+      return "dtlb_misses";
+    case perf_counter::branch_misses:
+      return "branch_misses";
+    }
+    return "unknown";
+  }
+
+  /**
+   * The counted events of one measurement. An event is only valid, if its
+   * counter could be opened.
+   */
+  struct perf_counter_values {
+    bool valid[number_of_perf_counters] = {};
+    uint64_t values[number_of_perf_counters] = {};
+
+    bool any_valid() const noexcept
+    {
+      for (auto v : valid) {
+        if (v) {
+          return true;
+        }
+      }
+      return false;
+    }
+  };
+
+  /**
+   * Counts the hardware events of the calling thread in user space between
+   * start() and stop() with perf_event_open. Each event has its own counter,
+   * so that an event that the CPU or the kernel does not support, does not
+   * disable the others. If the kernel multiplexes the counters, the values
+   * are scaled up to the whole duration.
+   * On other platforms than Linux, or if e.g. the perf_event_paranoid setting
+   * does not allow the counting, no counter is available and the benchmark
+   * only reports the wall time.
+   */
+  class perf_counters {
+    int fds_[number_of_perf_counters];
+
+#if defined(__linux__)
+    static int open(uint32_t type, uint64_t config) noexcept
+    {
+      perf_event_attr attr = {};
+      attr.size = sizeof(attr);
+      attr.type = type;
+      attr.config = config;
+      attr.disabled = 1;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+      return static_cast<int>(::syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+
+    static uint64_t cache_miss(uint64_t cache) noexcept
+    {
+      return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    }
+#endif
+
+    perf_counters(const perf_counters &) = delete;
+    perf_counters &operator=(const perf_counters &) = delete;
+
+  public:
+    perf_counters() noexcept
+    {
+#if defined(__linux__)
+      fds_[0] = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+      fds_[1] = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+      fds_[2] = open(PERF_TYPE_HW_CACHE, cache_miss(PERF_COUNT_HW_CACHE_L1D));
+      fds_[3] = open(PERF_TYPE_HW_CACHE, cache_miss(PERF_COUNT_HW_CACHE_LL));
+      fds_[4] = open(PERF_TYPE_HW_CACHE, cache_miss(PERF_COUNT_HW_CACHE_DTLB));
+      fds_[5] = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+#else
+      for (auto &fd : fds_) {
+        fd = -1;
+      }
+#endif
+    }
+
+    ~perf_counters()
+    {
+#if defined(__linux__)
+      for (auto fd : fds_) {
+        if (fd >= 0) {
+          ::close(fd);
+        }
+      }
+#endif
+    }
+
+    /**
+     * Returns true, if at least one of the events can be counted
+     */
+    bool available() const noexcept
+    {
+      for (auto fd : fds_) {
+        if (fd >= 0) {
+          return true;
+        }
+      }
+      return false;
+    }
+
+    void start() noexcept
+    {
+#if defined(__linux__)
+      for (auto fd : fds_) {
+        if (fd >= 0) {
+          ::ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+          ::ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+      }
+#endif
+    }
+
+    perf_counter_values stop() noexcept
+    {
+      perf_counter_values result;
+#if defined(__linux__)
+      for (auto fd : fds_) {
+        if (fd >= 0) {
+          ::ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        }
+      }
+      for (unsigned i = 0; i < number_of_perf_counters; ++i) {
+        // value, time enabled, time running
+        uint64_t data[3];
+        if (fds_[i] < 0 || ::read(fds_[i], data, sizeof(data)) != sizeof(data) || data[2] == 0) {
+          continue;
+        }
+        result.valid[i] = true;
+        result.values[i] = data[2] < data[1]
+                             ? static_cast<uint64_t>(static_cast<double>(data[0]) * data[1] / data[2])
+                             : data[0];
+      }
+#endif
+      return result;
+    }
+  };
+}
@@ -0,0 +1,94 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace alb_benchmark {
+
+  /**
+   * The distributions of the requested sizes. All sizes are within
+   * [min_request_size, max_request_size].
+   */
+  enum class size_distribution {
+    /// Always fixed_request_size bytes
+    fixed,
+    /// Equally distributed over [16, 4096]
+    uniform,
+    /// Pareto distributed with shape 1.2 from 16 bytes on, so most requests are
+    /// small and few are large, like in most programs
+    power_law,
+    /// 90% between 16 and 64 bytes and 10% between 2048 and 8192 bytes
+    bimodal
+  };
+
+  static constexpr size_t min_request_size = 1;
+  static constexpr size_t max_request_size = 8192;
+  static constexpr size_t fixed_request_size = 64;
+
+  static const size_distribution all_size_distributions[] = {
+    size_distribution::fixed, size_distribution::uniform, size_distribution::power_law,
+    size_distribution::bimodal};
+
+  inline const char *name_of(size_distribution d)
+  {
+    switch (d) {
+    case size_distribution::fixed:
+      return "fixed";
+    case size_distribution::uniform:
+      return "uniform";
+    case size_distribution::power_law:
+      return "power_law";
+    case size_distribution::bimodal:
+      return "bimodal";
+    }
+    return "unknown";
+  }
+
+  /**
+   * Returns count sizes of the distribution. The sizes are generated before
+   * any measurement and with a fixed seed, so that all allocators and all
+   * commits get exactly the same requests.
+   */
+  inline std::vector<size_t> make_sizes(size_distribution d, size_t count, uint64_t seed = 42)
+  {
+    std::mt19937_64 engine(seed);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    std::uniform_int_distribution<size_t> uniform(16, 4096);
+    std::uniform_int_distribution<size_t> small(16, 64);
+    std::uniform_int_distribution<size_t> large(2048, 8192);
+
+    std::vector<size_t> result;
+    result.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+      size_t n = fixed_request_size;
+      switch (d) {
+      case size_distribution::fixed:
+        break;
+      case size_distribution::uniform:
+        n = uniform(engine);
+        break;
+      case size_distribution::power_law:
+        n = static_cast<size_t>(16.0 / std::pow(1.0 - unit(engine), 1.0 / 1.2));
+        break;
+      case size_distribution::bimodal:
+        n = unit(engine) < 0.9 ? small(engine) : large(engine);
+        break;
+      }
+      result.push_back(std::min(std::max(n, min_request_size), max_request_size));
+    }
+    return result;
+  }
+}
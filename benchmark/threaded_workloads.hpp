@@ -0,0 +1,290 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "benchmark_runner.hpp"
+#include "latency.hpp"
+
+#include <boost/lockfree/spsc_queue.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace alb_benchmark {
+
+  /**
+   * The multithreaded patterns. Each thread performs the given number of
+   * allocations, so with perfect scaling the ops/sec grow with the threads.
+   */
+  enum class threaded_workload {
+    /// Like threadtest: each thread allocates a batch of blocks and frees them
+    /// again by itself
+    threadtest,
+    /// Like larson: each thread replaces randomly chosen blocks of a live set.
+    /// After each epoch the live sets are handed over to the next thread, so
+    /// most blocks are freed by another thread than the one that allocated them
+    larson,
+    /// Like xmalloc: pairs of threads, in which the producer allocates and the
+    /// consumer frees each block, as in a pipeline. It needs at least two threads.
+    xmalloc
+  };
+
+  static constexpr size_t threaded_batch_size = 256;
+  static constexpr size_t larson_epochs = 8;
+  static constexpr size_t xmalloc_queue_size = 1024;
+
+  static const threaded_workload all_threaded_workloads[] = {
+    threaded_workload::threadtest, threaded_workload::larson, threaded_workload::xmalloc};
+
+  inline const char *name_of(threaded_workload w)
+  {
+    switch (w) {
+    case threaded_workload::threadtest:
+      return "threadtest";
+    case threaded_workload::larson:
+      return "larson";
+    case threaded_workload::xmalloc:
+      return "xmalloc";
+    }
+    return "unknown";
+  }
+
+  namespace internal {
+
+    /**
+     * Lets a fixed number of threads wait for each other, without a lock so that
+     * the waiting does not go through the allocator under test.
+     */
+    class spinning_barrier {
+      const unsigned count_;
+      std::atomic<unsigned> waiting_;
+      std::atomic<unsigned> generation_;
+
+    public:
+      explicit spinning_barrier(unsigned count)
+        : count_(count)
+        , waiting_(0)
+        , generation_(0)
+      {
+      }
+
+      void wait()
+      {
+        const auto generation = generation_.load();
+        if (waiting_.fetch_add(1) + 1 == count_) {
+          waiting_.store(0);
+          generation_.fetch_add(1);
+          return;
+        }
+        while (generation_.load() == generation) {
+          std::this_thread::yield();
+        }
+      }
+    };
+
+    template <class Allocator>
+    size_t threadtest(Allocator &allocator, const run_input &input, size_t &failed)
+    {
+      size_t operations = 0;
+      alb::block batch[threaded_batch_size];
+      for (size_t i = 0; i < input.sizes.size(); i += threaded_batch_size) {
+        const auto n = std::min(threaded_batch_size, input.sizes.size() - i);
+        for (size_t j = 0; j < n; ++j) {
+          batch[j] = allocator.allocate(input.sizes[i + j]);
+          touch(batch[j]);
+        }
+        for (size_t j = 0; j < n; ++j) {
+          if (batch[j]) {
+            allocator.deallocate(batch[j]);
+            ++operations;
+          }
+          else {
+            ++failed;
+          }
+        }
+        operations += n;
+      }
+      return operations;
+    }
+
+    template <class Allocator>
+    size_t larson(Allocator &allocator, const run_input &input, unsigned index, unsigned threads,
+                  std::vector<std::vector<alb::block>> &liveSets, spinning_barrier &barrier,
+                  size_t &failed)
+    {
+      size_t operations = 0;
+      const auto stepsPerEpoch = input.sizes.size() / larson_epochs;
+      for (size_t epoch = 0; epoch < larson_epochs; ++epoch) {
+        auto &live = liveSets[(index + epoch) % threads];
+        for (size_t i = epoch * stepsPerEpoch; i < (epoch + 1) * stepsPerEpoch; ++i) {
+          auto &b = live[input.slots[i] % threaded_batch_size];
+          if (b) {
+            allocator.deallocate(b);
+            ++operations;
+          }
+          b = allocator.allocate(input.sizes[i]);
+          touch(b);
+          ++operations;
+          if (!b) {
+            ++failed;
+          }
+        }
+        barrier.wait();
+      }
+      return operations;
+    }
+
+    template <class Allocator>
+    size_t xmalloc_producer(Allocator &allocator, const run_input &input,
+                            boost::lockfree::spsc_queue<alb::block> &queue, size_t &failed)
+    {
+      for (auto n : input.sizes) {
+        auto b = allocator.allocate(n);
+        touch(b);
+        if (!b) {
+          ++failed;
+        }
+        while (!queue.push(b)) {
+          std::this_thread::yield();
+        }
+      }
+      return input.sizes.size();
+    }
+
+    template <class Allocator>
+    size_t xmalloc_consumer(Allocator &allocator, const run_input &input,
+                            boost::lockfree::spsc_queue<alb::block> &queue)
+    {
+      size_t operations = 0;
+      for (size_t i = 0; i < input.sizes.size();) {
+        alb::block b;
+        if (!queue.pop(b)) {
+          std::this_thread::yield();
+          continue;
+        }
+        if (b) {
+          touch(b);
+          allocator.deallocate(b);
+          ++operations;
+        }
+        ++i;
+      }
+      return operations;
+    }
+  }
+
+  /**
+   * Measures the workload with the given number of threads on one shared
+   * instance of the Allocator. The measurement starts, when all threads are
+   * ready, and ends, when the last one has finished.
+   */
+  template <class Allocator>
+  run_result run_threaded(threaded_workload w, unsigned threads, const run_input &input)
+  {
+    Allocator allocator;
+    std::vector<std::vector<alb::block>> liveSets(
+      threads, std::vector<alb::block>(threaded_batch_size));
+    std::vector<std::unique_ptr<boost::lockfree::spsc_queue<alb::block>>> queues;
+    for (unsigned i = 0; i < threads / 2; ++i) {
+      queues.emplace_back(new boost::lockfree::spsc_queue<alb::block>(xmalloc_queue_size));
+    }
+    internal::spinning_barrier barrier(threads);
+    std::atomic<unsigned> ready(0);
+    std::atomic<bool> go(false);
+    std::atomic<size_t> operations(0);
+    std::atomic<size_t> failedAllocations(0);
+
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < threads; ++i) {
+      workers.emplace_back([&, i] {
+        ++ready;
+        while (!go.load()) {
+          std::this_thread::yield();
+        }
+        size_t done = 0;
+        size_t failed = 0;
+        switch (w) {
+        case threaded_workload::threadtest:
+          done = internal::threadtest(allocator, input, failed);
+          break;
+        case threaded_workload::larson:
+          done = internal::larson(allocator, input, i, threads, liveSets, barrier, failed);
+          break;
+        case threaded_workload::xmalloc:
+          if (i / 2 < queues.size()) {
+            auto &queue = *queues[i / 2];
+            done = i % 2 == 0 ? internal::xmalloc_producer(allocator, input, queue, failed)
+                              : internal::xmalloc_consumer(allocator, input, queue);
+          }
+          break;
+        }
+        operations += done;
+        failedAllocations += failed;
+      });
+    }
+
+    while (ready.load() < threads) {
+      std::this_thread::yield();
+    }
+    const auto begin = std::chrono::steady_clock::now();
+    go.store(true);
+    for (auto &t : workers) {
+      t.join();
+    }
+    run_result result;
+    result.seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    result.operations = operations.load();
+    result.failed_allocations = failedAllocations.load();
+
+    for (auto &live : liveSets) {
+      for (auto &b : live) {
+        if (b) {
+          allocator.deallocate(b);
+        }
+      }
+    }
+    return result;
+  }
+
+  /**
+   * A thread safe allocator or composition under test
+   */
+  struct threaded_benchmark_case {
+    const char *name;
+    std::function<run_result(threaded_workload, unsigned, const run_input &)> run;
+    std::function<latency_result(latency_workload, unsigned, const run_input &)> run_latency;
+  };
+
+  template <class Allocator>
+  threaded_benchmark_case make_threaded_case(const char *name)
+  {
+    return threaded_benchmark_case{name, &run_threaded<Allocator>, &run_latency<Allocator>};
+  }
+
+  /**
+   * Returns the thread counts of the scaling curve: 1, 2, 4, ... up to and
+   * including maxThreads
+   */
+  inline std::vector<unsigned> thread_counts(unsigned maxThreads)
+  {
+    std::vector<unsigned> result;
+    for (unsigned t = 1; t < maxThreads; t *= 2) {
+      result.push_back(t);
+    }
+    result.push_back(maxThreads);
+    return result;
+  }
+}
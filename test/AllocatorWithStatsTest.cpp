@@ -16,6 +16,8 @@
 #include "TestHelpers/Base.h"
 
 #include <algorithm>
+#include <future>
+#include <vector>
 
 namespace {
   typedef alb::allocator_with_stats<
@@ -661,3 +663,279 @@ TEST_F(AllocatorWithStatsWithLimitedExpandingTest, ThatFailedExpandingIsStored)
 
   afterDeallocatinEverything.checkThatExpectationsAreFulfilled();
 }
+
+TEST(AllocatorWithStatsWithoutCallerInfoTest, ThatOnlyTheCountersAreCollected)
+{
+  alb::allocator_with_stats<alb::mallocator, alb::StatsOptions::NumAll | alb::StatsOptions::BytesAll>
+    sut;
+  static_assert(!decltype(sut)::has_per_allocation_state, "No prefix expected!");
+
+  auto mem = sut.allocate(8);
+  EXPECT_TRUE(sut.reallocate(mem, 16));
+  sut.deallocate(mem);
+
+  auto snapshot = sut.snapshot();
+  EXPECT_EQ(1u, snapshot.num_allocate);
+  EXPECT_EQ(1u, snapshot.num_reallocate);
+  EXPECT_EQ(1u, snapshot.num_deallocate);
+  EXPECT_EQ(snapshot.bytes_allocated, snapshot.bytes_deallocated);
+  EXPECT_EQ(16u, snapshot.bytes_high_tide);
+}
+
+TEST_F(AllocatorWithStatsTest, ThatDeallocatingTheNewestAllocationKeepsTheOlderOnes)
+{
+  auto mem1st = ALLOCATE((*sut), 4);
+  auto mem2nd = ALLOCATE((*sut), 8);
+  sut->deallocate(mem2nd);
+
+  auto allocations = sut->allocations();
+  ASSERT_FALSE(allocations.empty());
+  EXPECT_EQ(4u, (*allocations.cbegin())->callerSize);
+
+  sut->deallocate(mem1st);
+  EXPECT_TRUE(sut->allocations().empty());
+}
+
+TEST(SharedAllocatorWithStatsTest, ThatTheCountersAndAllocationsOfAllThreadsAreCollected)
+{
+  using AllocatorUnderTest = alb::shared_allocator_with_stats<alb::mallocator>;
+  const size_t NumberOfThreads = 4;
+  const size_t AllocationsPerThread = 1000;
+  auto sut = std::make_unique<AllocatorUnderTest>();
+
+  std::vector<std::future<std::vector<alb::block>>> workers;
+  for (size_t t = 0; t < NumberOfThreads; ++t) {
+    workers.push_back(std::async(std::launch::async, [&sut]() {
+      std::vector<alb::block> blocks, remaining;
+      for (size_t i = 0; i < AllocationsPerThread; ++i) {
+        blocks.push_back(ALLOCATE((*sut), 16));
+      }
+      for (auto &b : blocks) {
+        EXPECT_TRUE(sut->reallocate(b, 32));
+      }
+      for (size_t i = 0; i < blocks.size(); ++i) {
+        if (i % 2 == 0) {
+          sut->deallocate(blocks[i]);
+        }
+        else {
+          remaining.push_back(blocks[i]);
+        }
+      }
+      return remaining;
+    }));
+  }
+  std::vector<alb::block> remaining;
+  for (auto &w : workers) {
+    auto r = w.get();
+    remaining.insert(remaining.end(), r.begin(), r.end());
+  }
+
+  const size_t NumberOfRemainingBlocks = NumberOfThreads * AllocationsPerThread / 2;
+  auto snapshot = sut->snapshot();
+  EXPECT_EQ(NumberOfThreads * AllocationsPerThread, snapshot.num_allocate);
+  EXPECT_EQ(NumberOfThreads * AllocationsPerThread, snapshot.num_reallocate_ok);
+  EXPECT_EQ(NumberOfRemainingBlocks, snapshot.num_deallocate);
+  EXPECT_EQ(NumberOfRemainingBlocks * 32, snapshot.bytes_allocated - snapshot.bytes_deallocated);
+  EXPECT_LE(NumberOfRemainingBlocks * 32, snapshot.bytes_high_tide);
+
+  size_t outstanding = 0;
+  sut->for_each_allocation([&outstanding](const AllocatorUnderTest::AllocationInfo &info) {
+    EXPECT_EQ(16u, info.callerSize);
+    ++outstanding;
+  });
+  EXPECT_EQ(NumberOfRemainingBlocks, outstanding);
+
+  for (auto &b : remaining) {
+    sut->deallocate(b);
+  }
+  outstanding = 0;
+  sut->for_each_allocation([&outstanding](const AllocatorUnderTest::AllocationInfo &) {
+    ++outstanding;
+  });
+  EXPECT_EQ(0u, outstanding);
+  EXPECT_EQ(sut->bytes_allocated(), sut->bytes_deallocated());
+}
+
+TEST(AllocatorWithStatsHistogramTest, ThatRequestsAndTheirSlackAreCountedPerSizeClass)
+{
+  alb::allocator_with_stats<alb::stack_allocator<256, 16>,
+                            alb::StatsOptions::BytesSlack | alb::StatsOptions::HistogramAll>
+    sut;
+
+  auto mem1 = sut.allocate(5);
+  auto mem2 = sut.allocate(7);
+  auto mem3 = sut.allocate(32);
+  EXPECT_EQ(9u + 11u, sut.bytes_slack());
+
+  EXPECT_EQ(2u, sut.size_histogram(2));
+  EXPECT_EQ(20u, sut.slack_histogram(2));
+  EXPECT_EQ(1u, sut.size_histogram(5));
+  EXPECT_EQ(0u, sut.slack_histogram(5));
+  EXPECT_EQ(0u, sut.size_histogram(3));
+
+  EXPECT_TRUE(sut.reallocate(mem3, 40));
+  EXPECT_EQ(2u, sut.size_histogram(5));
+  EXPECT_EQ(8u, sut.slack_histogram(5));
+
+  sut.deallocate(mem3);
+  sut.deallocate(mem2);
+  sut.deallocate(mem1);
+}
+
+TEST(AllocatorWithStatsHistogramTest, ThatEverySampledCallIsMeasured)
+{
+  using AllocatorUnderTest =
+    alb::allocator_with_stats<alb::mallocator, alb::StatsOptions::LatencyHistogram>;
+  AllocatorUnderTest sut;
+
+  for (unsigned i = 0; i < AllocatorUnderTest::latency_sampling_rate; ++i) {
+    auto mem = sut.allocate(16);
+    sut.deallocate(mem);
+  }
+
+  size_t measuredCalls = 0;
+  for (auto op : {alb::stats_operation::allocate, alb::stats_operation::deallocate}) {
+    for (unsigned i = 0; i < alb::internal::number_of_size_classes; ++i) {
+      measuredCalls += sut.latency_histogram(op, i);
+    }
+  }
+  EXPECT_EQ(2u, measuredCalls);
+  EXPECT_EQ(0u, sut.size_histogram(4));
+}
+
+TEST(AllocatorWithStatsCallSiteTest, ThatTheLiveBytesAreAggregatedPerCallSite)
+{
+  alb::allocator_with_stats<alb::mallocator,
+                            alb::StatsOptions::CallerFile | alb::StatsOptions::CallerLine |
+                              alb::StatsOptions::CallSites>
+    sut;
+
+  std::vector<alb::block> blocks;
+  for (int i = 0; i < 3; ++i) {
+    blocks.push_back(sut.allocate(16, __FILE__, __FUNCTION__, 1));
+    blocks.push_back(sut.allocate(64, __FILE__, __FUNCTION__, 2));
+  }
+  auto mem = sut.allocate(32, __FILE__, __FUNCTION__, 3);
+  EXPECT_TRUE(sut.reallocate(mem, 512));
+
+  alb::call_site_stats top[2];
+  ASSERT_EQ(2u, sut.top_call_sites(top, 2));
+  EXPECT_EQ(3, top[0].line);
+  EXPECT_EQ(512u, top[0].live_bytes);
+  EXPECT_EQ(512u, top[0].peak_bytes);
+  EXPECT_EQ(512u, top[0].total_bytes);
+  EXPECT_EQ(2, top[1].line);
+  EXPECT_EQ(192u, top[1].live_bytes);
+  EXPECT_EQ(3u, top[1].live_count);
+
+  sut.deallocate(mem);
+  for (auto &b : blocks) {
+    sut.deallocate(b);
+  }
+
+  size_t sites = 0;
+  sut.for_each_call_site([&sites](const alb::call_site_stats &s) {
+    EXPECT_EQ(0u, s.live_bytes);
+    EXPECT_EQ(0u, s.live_count);
+    EXPECT_EQ(s.line == 3 ? 1u : 3u, s.total_count);
+    ++sites;
+  });
+  EXPECT_EQ(3u, sites);
+  EXPECT_EQ(0u, sut.number_of_dropped_call_sites());
+}
+
+TEST(AllocatorWithStatsCallSiteTest, ThatAllThreadsAreCollected)
+{
+  using AllocatorUnderTest =
+    alb::shared_allocator_with_stats<alb::mallocator,
+                                     alb::StatsOptions::CallerFile | alb::StatsOptions::CallerLine |
+                                       alb::StatsOptions::CallSites>;
+  const size_t NumberOfThreads = 4;
+  const int AllocationsPerThread = 1000;
+  auto sut = std::make_unique<AllocatorUnderTest>();
+
+  std::vector<std::future<void>> workers;
+  for (size_t t = 0; t < NumberOfThreads; ++t) {
+    workers.push_back(std::async(std::launch::async, [&sut]() {
+      std::vector<alb::block> blocks;
+      for (int i = 0; i < AllocationsPerThread; ++i) {
+        blocks.push_back(sut->allocate(8, __FILE__, __FUNCTION__, i % 10));
+      }
+      for (auto &b : blocks) {
+        sut->deallocate(b);
+      }
+    }));
+  }
+  for (auto &w : workers) {
+    w.get();
+  }
+
+  size_t totalCount = 0;
+  sut->for_each_call_site([&totalCount](const alb::call_site_stats &s) {
+    EXPECT_EQ(0u, s.live_bytes);
+    totalCount += s.total_count;
+  });
+  EXPECT_EQ(NumberOfThreads * AllocationsPerThread, totalCount);
+}
+
+TEST(AllocatorWithStatsCompactTest, ThatOnlyAnIndexIsPrependedToEachBlock)
+{
+  using AllocatorUnderTest =
+    alb::allocator_with_stats<alb::stack_allocator<1024, 4>,
+                              alb::StatsOptions::CallerAll | alb::StatsOptions::CompactCallerInfo>;
+  AllocatorUnderTest sut;
+
+  auto mem1 = sut.allocate(8, __FILE__, __FUNCTION__, 4711);
+  auto mem2 = sut.allocate(8, __FILE__, __FUNCTION__, 4712);
+  EXPECT_EQ(static_cast<char *>(mem1.ptr) + 8 + sizeof(uint32_t), mem2.ptr);
+
+  std::vector<int> lines;
+  sut.for_each_allocation([&lines](const AllocatorUnderTest::AllocationInfo &info) {
+    EXPECT_EQ(8u, info.callerSize);
+    EXPECT_STREQ(__FILE__, info.callerFile);
+    EXPECT_NE(nullptr, info.callerFunction);
+    EXPECT_LE(std::chrono::system_clock::now() - std::chrono::seconds(5), info.callerTime);
+    lines.push_back(info.callerLine);
+  });
+  EXPECT_EQ((std::vector<int>{4712, 4711}), lines);
+
+  sut.deallocate(mem1);
+  lines.clear();
+  sut.for_each_allocation([&lines](const AllocatorUnderTest::AllocationInfo &info) {
+    lines.push_back(info.callerLine);
+  });
+  EXPECT_EQ(std::vector<int>{4712}, lines);
+  EXPECT_EQ(0u, sut.number_of_untracked_allocations());
+
+  sut.deallocate(mem2);
+}
+
+TEST(AllocatorWithStatsCompactTest, ThatAMovingReallocationKeepsTheRecordAndTheCallSite)
+{
+  using AllocatorUnderTest =
+    alb::allocator_with_stats<alb::mallocator, alb::StatsOptions::CallerAll |
+                                                 alb::StatsOptions::CallSites |
+                                                 alb::StatsOptions::CompactCallerInfo>;
+  AllocatorUnderTest sut;
+
+  auto mem = sut.allocate(16, __FILE__, __FUNCTION__, 1);
+  EXPECT_TRUE(sut.reallocate(mem, 1024 * 1024));
+
+  size_t allocations = 0;
+  sut.for_each_allocation([&allocations](const AllocatorUnderTest::AllocationInfo &info) {
+    EXPECT_EQ(16u, info.callerSize);
+    EXPECT_EQ(1, info.callerLine);
+    ++allocations;
+  });
+  EXPECT_EQ(1u, allocations);
+
+  alb::call_site_stats top[1];
+  ASSERT_EQ(1u, sut.top_call_sites(top, 1));
+  EXPECT_EQ(1024u * 1024u, top[0].live_bytes);
+  EXPECT_STREQ(__FUNCTION__, top[0].function);
+
+  sut.deallocate(mem);
+  ASSERT_EQ(1u, sut.top_call_sites(top, 1));
+  EXPECT_EQ(0u, top[0].live_bytes);
+  EXPECT_EQ(0u, top[0].live_count);
+}
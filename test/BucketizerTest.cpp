@@ -57,6 +57,31 @@ TEST_F(BucketizerTest, ThatGoodSizeReturnsTheNextMatchingBucketSize)
   EXPECT_EQ(64u, AllocatorUnderTest::good_size(64));
 }
 
+TEST(BucketizerGoodSizeTest, ThatGoodSizeReturnsTheUpperEdgeOfTheBucketIfTheFirstBucketStartsAtOne)
+{
+  using BucketizerFromOne = alb::bucketizer<alb::freelist<alb::mallocator,
+      alb::internal::DynasticDynamicSet, alb::internal::DynasticDynamicSet>, 1, 64, 16>;
+
+  EXPECT_EQ(16u, BucketizerFromOne::good_size(1));
+  EXPECT_EQ(16u, BucketizerFromOne::good_size(16));
+  EXPECT_EQ(32u, BucketizerFromOne::good_size(17));
+  EXPECT_EQ(64u, BucketizerFromOne::good_size(64));
+}
+
+TEST(BucketizerGoodSizeTest, ThatGoodSizeReturnsTheNearestBucketForSizesOutsideOfTheRange)
+{
+  using Bucketizer = alb::bucketizer<alb::freelist<alb::mallocator,
+      alb::internal::DynasticDynamicSet, alb::internal::DynasticDynamicSet>, 129, 1024, 128>;
+
+  EXPECT_EQ(256u, Bucketizer::good_size(0));
+  EXPECT_EQ(256u, Bucketizer::good_size(64));
+  EXPECT_EQ(256u, Bucketizer::good_size(128));
+  EXPECT_EQ(256u, Bucketizer::good_size(129));
+  EXPECT_EQ(1024u, Bucketizer::good_size(1024));
+  EXPECT_EQ(1024u, Bucketizer::good_size(1025));
+  EXPECT_EQ(1024u, Bucketizer::good_size(5000));
+}
+
 TEST_F(BucketizerTest, ThatAllocatingBeyondTheAllocatorsRangeResultsInAnEmptyBlock)
 {
   auto mem = sut.allocate(0);
@@ -0,0 +1,175 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#include <gtest/gtest.h>
+#include <alb/buddy_allocator.hpp>
+#include <alb/mallocator.hpp>
+
+#include "TestHelpers/AllocatorBaseTest.h"
+
+#include <cstring>
+#include <vector>
+
+namespace {
+  const size_t MinBlock = 64;
+  const unsigned MaxOrder = 6;
+}
+
+class BuddyAllocatorTest
+  : public alb::test_helpers::AllocatorBaseTest<alb::buddy_allocator<alb::mallocator, MinBlock, MaxOrder>> {
+protected:
+  size_t offset_of(const alb::block &b) const
+  {
+    return static_cast<char *>(b.ptr) - static_cast<char *>(sut.memory_region().ptr);
+  }
+
+  // Checks, that the whole area is free again as one block
+  void expectCompletelyMerged() const
+  {
+    EXPECT_EQ(1u, sut.number_of_free_blocks(MaxOrder));
+    for (unsigned order = 0; order < MaxOrder; ++order) {
+      EXPECT_EQ(0u, sut.number_of_free_blocks(order)) << "order " << order;
+    }
+  }
+};
+
+TEST_F(BuddyAllocatorTest, ThatAllocationsAreRoundedUpToThePowerOfTwoOfMinBlock)
+{
+  EXPECT_FALSE(sut.allocate(0));
+  EXPECT_FALSE(sut.allocate(sut.max_block + 1));
+
+  auto mem = sut.allocate(1);
+  EXPECT_EQ(MinBlock, mem.length);
+  EXPECT_TRUE(sut.owns(mem));
+  auto mem2 = sut.allocate(MinBlock + 1);
+  EXPECT_EQ(2 * MinBlock, mem2.length);
+  EXPECT_EQ(0u, offset_of(mem2) % mem2.length);
+  auto mem3 = sut.allocate(5 * MinBlock);
+  EXPECT_EQ(8 * MinBlock, mem3.length);
+  EXPECT_EQ(0u, offset_of(mem3) % mem3.length);
+  EXPECT_EQ(sut.good_size(5 * MinBlock), mem3.length);
+
+  this->deallocateAndCheckBlockIsThenEmpty(mem);
+  this->deallocateAndCheckBlockIsThenEmpty(mem2);
+  this->deallocateAndCheckBlockIsThenEmpty(mem3);
+  expectCompletelyMerged();
+}
+
+TEST_F(BuddyAllocatorTest, ThatTheWholeAreaCanBeAllocatedOnceAndThenNothingElse)
+{
+  auto mem = sut.allocate(sut.max_block);
+  ASSERT_NE(nullptr, mem.ptr);
+  EXPECT_EQ(sut.memory_region().ptr, mem.ptr);
+  EXPECT_FALSE(sut.allocate(1));
+  this->deallocateAndCheckBlockIsThenEmpty(mem);
+  expectCompletelyMerged();
+}
+
+TEST_F(BuddyAllocatorTest, ThatFreedBuddiesAreMergedInAnyOrder)
+{
+  std::vector<alb::block> blocks;
+  for (size_t i = 0; i < (size_t(1) << MaxOrder); ++i) {
+    blocks.push_back(sut.allocate(MinBlock));
+    ASSERT_NE(nullptr, blocks.back().ptr);
+  }
+  EXPECT_FALSE(sut.allocate(1));
+
+  // Free every second block first, so that no buddies can be merged yet
+  for (size_t i = 0; i < blocks.size(); i += 2) {
+    sut.deallocate(blocks[i]);
+  }
+  EXPECT_EQ(blocks.size() / 2, sut.number_of_free_blocks(0));
+  EXPECT_FALSE(sut.allocate(2 * MinBlock));
+
+  for (size_t i = blocks.size() - 1; i < blocks.size(); i -= 2) {
+    sut.deallocate(blocks[i]);
+  }
+  expectCompletelyMerged();
+}
+
+TEST_F(BuddyAllocatorTest, ThatAnExpandAbsorbsTheFreeUpperBuddies)
+{
+  auto mem = sut.allocate(MinBlock);
+  ASSERT_EQ(0u, offset_of(mem));
+  std::memset(mem.ptr, 0x42, mem.length);
+
+  EXPECT_TRUE(sut.expand(mem, 3 * MinBlock));
+  EXPECT_EQ(4 * MinBlock, mem.length);
+  EXPECT_EQ(0u, offset_of(mem));
+
+  // The upper half is still free and fits a block of the same size
+  auto other = sut.allocate(4 * MinBlock);
+  EXPECT_EQ(4 * MinBlock, offset_of(other));
+  EXPECT_FALSE(sut.expand(mem, 1));
+  EXPECT_EQ(4 * MinBlock, mem.length);
+
+  sut.deallocate(other);
+  EXPECT_TRUE(sut.expand(mem, 1));
+  EXPECT_EQ(8 * MinBlock, mem.length);
+  EXPECT_EQ(0x42, static_cast<char *>(mem.ptr)[MinBlock - 1]);
+
+  this->deallocateAndCheckBlockIsThenEmpty(mem);
+  expectCompletelyMerged();
+}
+
+TEST_F(BuddyAllocatorTest, ThatAnUpperBuddyCannotBeExpanded)
+{
+  auto lower = sut.allocate(MinBlock);
+  auto upper = sut.allocate(MinBlock);
+  ASSERT_EQ(MinBlock, offset_of(upper));
+  sut.deallocate(lower);
+  EXPECT_FALSE(sut.expand(upper, 1));
+  EXPECT_EQ(MinBlock, upper.length);
+  sut.deallocate(upper);
+  expectCompletelyMerged();
+}
+
+TEST_F(BuddyAllocatorTest, ThatAShrinkingReallocationSplitsTheBlockInPlace)
+{
+  auto mem = sut.allocate(sut.max_block);
+  const auto ptr = mem.ptr;
+  EXPECT_TRUE(sut.reallocate(mem, MinBlock + 1));
+  EXPECT_EQ(ptr, mem.ptr);
+  EXPECT_EQ(2 * MinBlock, mem.length);
+  for (unsigned order = 1; order < MaxOrder; ++order) {
+    EXPECT_EQ(1u, sut.number_of_free_blocks(order)) << "order " << order;
+  }
+
+  // Growing again takes back the free buddies
+  EXPECT_TRUE(sut.reallocate(mem, sut.max_block / 2));
+  EXPECT_EQ(ptr, mem.ptr);
+  EXPECT_EQ(sut.max_block / 2, mem.length);
+
+  this->deallocateAndCheckBlockIsThenEmpty(mem);
+  expectCompletelyMerged();
+}
+
+TEST_F(BuddyAllocatorTest, ThatAGrowingReallocationCopiesIfTheBuddyIsUsed)
+{
+  auto mem = sut.allocate(MinBlock);
+  auto blocker = sut.allocate(MinBlock);
+  std::memset(mem.ptr, 0x17, mem.length);
+
+  EXPECT_TRUE(sut.reallocate(mem, 2 * MinBlock));
+  EXPECT_EQ(2 * MinBlock, mem.length);
+  EXPECT_EQ(2 * MinBlock, offset_of(mem));
+  EXPECT_EQ(0x17, static_cast<char *>(mem.ptr)[MinBlock - 1]);
+
+  sut.deallocate(blocker);
+  this->deallocateAndCheckBlockIsThenEmpty(mem);
+  expectCompletelyMerged();
+}
+
+TEST_F(BuddyAllocatorTest, ThatDeallocateAllFreesTheWholeArea)
+{
+  sut.allocate(MinBlock);
+  sut.allocate(3 * MinBlock);
+  sut.deallocate_all();
+  expectCompletelyMerged();
+}
@@ -0,0 +1,146 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#include <gtest/gtest.h>
+#include <alb/composition_generator.hpp>
+#include <alb/mallocator.hpp>
+#include <alb/trace_recorder.hpp>
+
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+  const char *ProfileFile = "alb_composition_generator_test.profile";
+
+  std::string header_of(const alb::composition_plan &plan)
+  {
+    auto file = ::tmpfile();
+    alb::write_composition_header(file, plan, "test");
+    std::string result(static_cast<size_t>(::ftell(file)), '\0');
+    ::rewind(file);
+    EXPECT_EQ(result.size(), ::fread(&result[0], 1, result.size(), file));
+    ::fclose(file);
+    return result;
+  }
+}
+
+class CompositionGeneratorTest : public ::testing::Test {
+protected:
+  void TearDown() override
+  {
+    ::remove(ProfileFile);
+  }
+};
+
+TEST_F(CompositionGeneratorTest, ThatBucketsFitExactlyToEquidistantSizes)
+{
+  alb::size_profile profile;
+  for (size_t size = 16; size <= 256; size += 16) {
+    profile.add(size, 1000, 100);
+  }
+
+  const auto plan = alb::plan_composition(profile);
+  EXPECT_EQ(0u, plan.slack_bytes());
+  EXPECT_EQ(0u, plan.heap_chunk_size);
+  ASSERT_FALSE(plan.bands.empty());
+  EXPECT_EQ(1u, plan.bands.front().min_size);
+  EXPECT_EQ(256u, plan.bands.back().max_size);
+  for (auto &band : plan.bands) {
+    EXPECT_EQ(16u, band.step_size);
+    EXPECT_EQ(128u, band.pool_size);
+  }
+}
+
+TEST_F(CompositionGeneratorTest, ThatTheBandsCoverAllSizesWithinTheLimits)
+{
+  alb::size_profile profile;
+  for (size_t size = 1; size <= 3000; size = size * 3 / 2 + 1) {
+    profile.add(size, 10, 10);
+  }
+  alb::composition_options options;
+  options.max_levels = 3;
+  options.max_buckets = 8;
+
+  const auto plan = alb::plan_composition(profile, options);
+  ASSERT_FALSE(plan.bands.empty());
+  EXPECT_GE(3u, plan.bands.size());
+  size_t next = 1;
+  for (auto &band : plan.bands) {
+    EXPECT_EQ(next, band.min_size);
+    EXPECT_EQ(0u, (band.max_size - band.min_size + 1) % band.step_size);
+    EXPECT_EQ(0u, band.step_size % options.granularity);
+    EXPECT_GE(options.max_buckets, band.number_of_buckets());
+    next = band.max_size + 1;
+  }
+  EXPECT_LE(plan.requested_bytes, plan.footprint_bytes);
+}
+
+TEST_F(CompositionGeneratorTest, ThatLargerSizesAreServedByAHeapThatCanHoldThem)
+{
+  alb::size_profile profile;
+  profile.add(32, 100, 100);
+  profile.add(8192, 10, 10);
+  profile.add(65536, 10, 10);
+  profile.add(2 * 1024 * 1024, 1, 1);
+
+  const auto plan = alb::plan_composition(profile);
+  EXPECT_EQ(65536u, plan.heap_threshold);
+  ASSERT_NE(0u, plan.heap_chunk_size);
+  EXPECT_EQ(0u, plan.heap_number_of_chunks % 64);
+  EXPECT_LE(plan.heap_threshold, plan.heap_chunk_size * plan.heap_number_of_chunks);
+  EXPECT_EQ(32u, plan.bands.back().max_size);
+
+  const auto header = header_of(plan);
+  EXPECT_NE(std::string::npos, header.find("namespace alb_replay"));
+  EXPECT_NE(std::string::npos, header.find("using composition ="));
+  EXPECT_NE(std::string::npos, header.find("alb::segregator<65536, alb::cascading_allocator"));
+  EXPECT_NE(std::string::npos, header.find("alb::mallocator>>;"));
+}
+
+TEST_F(CompositionGeneratorTest, ThatTheProfileOfATraceContainsThePeakOfTheLiveBlocks)
+{
+  auto recorder = std::make_unique<alb::trace_recorder<alb::mallocator>>();
+  ASSERT_TRUE(recorder->open(ProfileFile));
+  std::vector<alb::block> blocks;
+  for (int i = 0; i < 3; ++i) {
+    blocks.push_back(recorder->allocate(48));
+  }
+  for (auto &b : blocks) {
+    recorder->deallocate(b);
+  }
+  auto b = recorder->allocate(48);
+  recorder->reallocate(b, 100);
+  recorder->deallocate(b);
+  recorder->close();
+
+  alb::size_profile profile;
+  ASSERT_TRUE(profile.add_trace(ProfileFile));
+  ASSERT_EQ(2u, profile.entries().size());
+  EXPECT_EQ(4u, profile.entries().at(48).requests);
+  EXPECT_EQ(3u, profile.entries().at(48).peak_live);
+  EXPECT_EQ(1u, profile.entries().at(100).requests);
+  EXPECT_EQ(1u, profile.entries().at(100).peak_live);
+  EXPECT_EQ(3u * 48, profile.peak_requested_bytes());
+}
+
+TEST_F(CompositionGeneratorTest, ThatAHistogramWithoutPeaksAssumesAllRequestsAsLive)
+{
+  auto file = ::fopen(ProfileFile, "w");
+  ASSERT_NE(nullptr, file);
+  fprintf(file, "# size requests peak_live\n16 40\n64 100 5\n");
+  ::fclose(file);
+
+  alb::size_profile profile;
+  ASSERT_TRUE(profile.add_histogram(ProfileFile));
+  EXPECT_EQ(40u, profile.entries().at(16).peak_live);
+  EXPECT_EQ(5u, profile.entries().at(64).peak_live);
+  EXPECT_FALSE(profile.add_histogram("not_existing.profile"));
+}
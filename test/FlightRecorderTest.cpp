@@ -0,0 +1,143 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#include <gtest/gtest.h>
+#include <alb/flight_recorder.hpp>
+#include <alb/mallocator.hpp>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+namespace {
+  // Each test uses its own number of events, so that it sees only its own rings
+  template <unsigned NumberOfEvents>
+  std::vector<alb::flight_event> eventsOf(unsigned tier)
+  {
+    std::vector<alb::flight_event> result;
+    alb::for_each_flight_event<NumberOfEvents>([&](const alb::flight_event &e) {
+      if (e.tier == tier) {
+        result.push_back(e);
+      }
+    });
+    return result;
+  }
+}
+
+TEST(FlightRecorderTest, ThatEachOperationIsRecordedInOrder)
+{
+  alb::flight_recorder<alb::mallocator, 7, 16> sut;
+  auto mem = sut.allocate(32);
+  auto first = mem.ptr;
+  EXPECT_TRUE(sut.reallocate(mem, 64));
+  sut.deallocate(mem);
+
+  auto events = eventsOf<16>(7);
+  ASSERT_EQ(3u, events.size());
+  EXPECT_EQ(alb::flight_operation::allocate, events[0].op);
+  EXPECT_EQ(32u, events[0].size);
+  EXPECT_EQ(first, events[0].ptr);
+  EXPECT_EQ(alb::flight_operation::reallocate, events[1].op);
+  EXPECT_EQ(64u, events[1].size);
+  EXPECT_EQ(alb::flight_operation::deallocate, events[2].op);
+  EXPECT_EQ(events[1].ptr, events[2].ptr);
+  EXPECT_LE(events[0].ticks, events[2].ticks);
+  EXPECT_LT(events[0].sequence, events[1].sequence);
+}
+
+TEST(FlightRecorderTest, ThatOnlyTheLastEventsAreRetained)
+{
+  alb::flight_recorder<alb::mallocator, 1, 8> sut;
+  for (size_t i = 1; i <= 20; ++i) {
+    auto mem = sut.allocate(i);
+    sut.deallocate(mem);
+  }
+  auto events = eventsOf<8>(1);
+  ASSERT_EQ(8u, events.size());
+  EXPECT_EQ(alb::flight_operation::allocate, events[0].op);
+  EXPECT_EQ(17u, events[0].size);
+  EXPECT_EQ(20u, events[7].size);
+  EXPECT_EQ(39u, events[7].sequence);
+}
+
+TEST(FlightRecorderTest, ThatEachThreadRecordsIntoItsOwnRing)
+{
+  alb::flight_recorder<alb::mallocator, 2, 32> sut;
+  std::atomic<int> finished(0);
+  std::vector<std::thread> threads;
+  for (size_t t = 1; t <= 4; ++t) {
+    threads.emplace_back([&sut, &finished, t] {
+      for (int i = 0; i < 5; ++i) {
+        auto mem = sut.allocate(t);
+        sut.deallocate(mem);
+      }
+      // the ring of an ended thread could be reused by a later one
+      ++finished;
+      while (finished.load() < 4) {
+        std::this_thread::yield();
+      }
+    });
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+
+  auto events = eventsOf<32>(2);
+  EXPECT_EQ(40u, events.size());
+  for (auto &e : events) {
+    for (auto &other : events) {
+      if (e.ring == other.ring) {
+        EXPECT_EQ(e.size, other.size);
+      }
+    }
+  }
+}
+
+TEST(FlightRecorderTest, ThatTheEventsAreDumpedAsText)
+{
+  alb::flight_recorder<alb::mallocator, 3, 24> sut;
+  auto mem = sut.allocate(48);
+  sut.deallocate(mem);
+
+  int fds[2];
+  ASSERT_EQ(0, ::pipe(fds));
+  alb::dump_flight_events<24>(fds[1]);
+  ::close(fds[1]);
+  std::string text;
+  char buffer[256];
+  ssize_t n;
+  while ((n = ::read(fds[0], buffer, sizeof(buffer))) > 0) {
+    text.append(buffer, static_cast<size_t>(n));
+  }
+  ::close(fds[0]);
+
+  EXPECT_NE(std::string::npos, text.find("tier 3 allocate size 48 ptr 0x"));
+  EXPECT_NE(std::string::npos, text.find("tier 3 deallocate size 48 ptr 0x"));
+}
+
+TEST(FlightRecorderTest, ThatTheLongestEventFitsIntoTheLineBuffer)
+{
+  alb::flight_event e;
+  e.sequence = UINT64_MAX;
+  e.ticks = UINT64_MAX;
+  e.ring = UINT32_MAX;
+  e.op = alb::flight_operation::deallocate_all;
+  e.tier = UINT32_MAX;
+  e.size = SIZE_MAX;
+  e.ptr = reinterpret_cast<void *>(UINTPTR_MAX);
+
+  char line[alb::internal::flight_event_line_size + 1];
+  line[alb::internal::flight_event_line_size] = 'x';
+  const auto length = alb::internal::format_flight_event(line, e);
+  EXPECT_LE(length, alb::internal::flight_event_line_size);
+  EXPECT_EQ('x', line[alb::internal::flight_event_line_size]);
+}
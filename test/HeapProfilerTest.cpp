@@ -0,0 +1,153 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#include <gtest/gtest.h>
+#include <alb/heap_profiler.hpp>
+#include <alb/mallocator.hpp>
+
+#include <future>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+  template <class Profiler>
+  size_t numberOfSamples(const Profiler &p)
+  {
+    size_t result = 0;
+    p.for_each_sample([&result](const void *, const typename Profiler::sample &) { ++result; });
+    return result;
+  }
+
+  // With a sampling period of one byte, nearly every allocation is sampled
+  using ProfilerThatSamplesAll = alb::heap_profiler<alb::mallocator, 1>;
+}
+
+TEST(HeapProfilerTest, ThatOnlyTheLivingSampledAllocationsAreKept)
+{
+  auto sut = std::make_unique<ProfilerThatSamplesAll>();
+  std::vector<alb::block> blocks;
+  for (int i = 0; i < 10; ++i) {
+    blocks.push_back(sut->allocate(64));
+  }
+  EXPECT_EQ(10u, numberOfSamples(*sut));
+
+  for (int i = 0; i < 5; ++i) {
+    sut->deallocate(blocks[i]);
+  }
+  EXPECT_EQ(5u, numberOfSamples(*sut));
+
+  sut->for_each_sample([](const void *, const ProfilerThatSamplesAll::sample &s) {
+    EXPECT_EQ(64u, s.requested);
+    EXPECT_LT(0, s.depth);
+  });
+
+  for (int i = 5; i < 10; ++i) {
+    sut->deallocate(blocks[i]);
+  }
+  EXPECT_EQ(0u, numberOfSamples(*sut));
+}
+
+TEST(HeapProfilerTest, ThatTheSampleMovesWithAReallocatedBlock)
+{
+  auto sut = std::make_unique<ProfilerThatSamplesAll>();
+  auto mem = sut->allocate(64);
+  EXPECT_TRUE(sut->reallocate(mem, 100000));
+
+  size_t samples = 0;
+  sut->for_each_sample([&](const void *p, const ProfilerThatSamplesAll::sample &s) {
+    EXPECT_EQ(mem.ptr, p);
+    EXPECT_EQ(100000u, s.requested);
+    ++samples;
+  });
+  EXPECT_EQ(1u, samples);
+
+  sut->deallocate(mem);
+  EXPECT_EQ(0u, numberOfSamples(*sut));
+}
+
+TEST(HeapProfilerTest, ThatAboutOneAllocationPerSamplingPeriodIsSampled)
+{
+  using AllocatorUnderTest = alb::heap_profiler<alb::mallocator, 4096, 4, 4096>;
+  auto sut = std::make_unique<AllocatorUnderTest>();
+  std::vector<alb::block> blocks;
+  for (int i = 0; i < 100000; ++i) {
+    blocks.push_back(sut->allocate(64));
+  }
+  // 6400000 bytes / 4096 = 1562 expected samples
+  const auto samples = numberOfSamples(*sut);
+  EXPECT_LT(1300u, samples);
+  EXPECT_GT(1850u, samples);
+  EXPECT_EQ(0u, sut->number_of_dropped_samples());
+
+  for (auto &b : blocks) {
+    sut->deallocate(b);
+  }
+}
+
+TEST(HeapProfilerTest, ThatTheDumpIsInTheLegacyHeapProfileFormat)
+{
+  auto sut = std::make_unique<ProfilerThatSamplesAll>();
+  auto mem1 = sut->allocate(64);
+  auto mem2 = sut->allocate(32);
+
+  std::ostringstream out;
+  sut->dump(out);
+  std::istringstream in(out.str());
+
+  std::string line;
+  std::getline(in, line);
+  EXPECT_EQ("heap profile:      2:       96 [     2:       96] @ heap_v2/1", line);
+  std::getline(in, line);
+  EXPECT_EQ(0u, line.find("     1:       "));
+  EXPECT_NE(std::string::npos, line.find("] @ 0x"));
+  std::getline(in, line);
+  std::getline(in, line);
+  EXPECT_EQ("", line);
+  std::getline(in, line);
+  EXPECT_EQ("MAPPED_LIBRARIES:", line);
+
+  sut->deallocate(mem1);
+  sut->deallocate(mem2);
+}
+
+TEST(SharedHeapProfilerTest, ThatSamplesOfAllThreadsAreKept)
+{
+  using AllocatorUnderTest = alb::shared_heap_profiler<alb::mallocator, 1>;
+  auto sut = std::make_unique<AllocatorUnderTest>();
+  const int NumberOfThreads = 4;
+
+  std::vector<std::future<std::vector<alb::block>>> workers;
+  for (int t = 0; t < NumberOfThreads; ++t) {
+    workers.push_back(std::async(std::launch::async, [&sut]() {
+      std::vector<alb::block> blocks;
+      for (int i = 0; i < 100; ++i) {
+        blocks.push_back(sut->allocate(32));
+      }
+      for (int i = 0; i < 100; i += 2) {
+        sut->deallocate(blocks[i]);
+      }
+      return blocks;
+    }));
+  }
+  std::vector<alb::block> remaining;
+  for (auto &w : workers) {
+    for (auto &b : w.get()) {
+      if (b) {
+        remaining.push_back(b);
+      }
+    }
+  }
+  EXPECT_EQ(remaining.size() - sut->number_of_dropped_samples(), numberOfSamples(*sut));
+
+  for (auto &b : remaining) {
+    sut->deallocate(b);
+  }
+  EXPECT_EQ(0u, numberOfSamples(*sut));
+}
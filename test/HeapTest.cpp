@@ -409,6 +409,32 @@ TYPED_TEST(HeapWithSmallAllocationsTest,
   EXPECT_MEM_EQ(mem.ptr, (void *)ReferenceData.data(), origMem.length);
 }
 
+TYPED_TEST(HeapWithSmallAllocationsTest, ThatTheFreeChunksAndTheLongestFreeRunAreReported)
+{
+  auto summary = this->sut.free_chunks();
+  EXPECT_EQ(NumberOfChunks, summary.free_chunks);
+  EXPECT_EQ(NumberOfChunks, summary.largest_free_run);
+
+  alb::block blocks[6];
+  for (auto &b : blocks) {
+    b = this->sut.allocate(SmallChunkSize * 32);
+  }
+  // Every second block is freed, so 96 chunks are free, but at most 32 in a row
+  this->sut.deallocate(blocks[0]);
+  this->sut.deallocate(blocks[2]);
+  this->sut.deallocate(blocks[4]);
+  summary = this->sut.free_chunks();
+  EXPECT_EQ(96u, summary.free_chunks);
+  EXPECT_EQ(32u, summary.largest_free_run);
+  EXPECT_FALSE(this->sut.allocate(SmallChunkSize * 33));
+
+  this->sut.deallocate(blocks[1]);
+  EXPECT_EQ(96u, this->sut.free_chunks().largest_free_run);
+
+  this->sut.deallocate(blocks[3]);
+  this->sut.deallocate(blocks[5]);
+}
+
 template <class T> class HeapWithLargeAllocationsTest : public AllocatorBaseTest<T> {
 };
 
@@ -0,0 +1,154 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#include <gtest/gtest.h>
+#include <alb/freelist.hpp>
+#include <alb/heap.hpp>
+#include <alb/mallocator.hpp>
+#include <alb/per_cpu_allocator.hpp>
+
+#include "TestHelpers/AllocatorBaseTest.h"
+
+#include <cstring>
+#include <future>
+#include <memory>
+#include <vector>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+namespace {
+  using Heap = alb::heap<alb::mallocator, 256, 32>;
+  using FreeList = alb::freelist<alb::mallocator, 0, 64>;
+}
+
+TEST(CurrentCpuTest, ThatTheCpuIsTheOneOfTheSystem)
+{
+#if defined(__linux__)
+  // The thread may be moved in between, but not every time
+  bool matched = false;
+  for (int i = 0; i < 100 && !matched; ++i) {
+    const auto cpu = alb::internal::current_cpu();
+    matched = static_cast<int>(cpu) == ::sched_getcpu();
+  }
+  EXPECT_TRUE(matched);
+#endif
+}
+
+class PerCpuAllocatorTest
+    : public alb::test_helpers::AllocatorBaseTest<alb::per_cpu_allocator<Heap, 4>> {
+};
+
+TEST_F(PerCpuAllocatorTest, ThatTheInstancesAreCreatedOnTheirFirstUse)
+{
+  EXPECT_EQ(0u, sut.number_of_shards_in_use());
+  auto mem = sut.allocate(32);
+  ASSERT_NE(nullptr, mem.ptr);
+  EXPECT_EQ(32u, mem.length);
+  EXPECT_TRUE(sut.owns(mem));
+  EXPECT_LE(1u, sut.number_of_shards_in_use());
+
+  deallocateAndCheckBlockIsThenEmpty(mem);
+}
+
+TEST_F(PerCpuAllocatorTest, ThatReallocateAndExpandAreDoneByTheOwningInstance)
+{
+  auto mem = sut.allocate(32);
+  std::memset(mem.ptr, 0x33, mem.length);
+  const auto ptr = mem.ptr;
+  EXPECT_TRUE(sut.expand(mem, 32));
+  EXPECT_EQ(ptr, mem.ptr);
+  EXPECT_EQ(64u, mem.length);
+  EXPECT_TRUE(sut.reallocate(mem, 32));
+  EXPECT_EQ(ptr, mem.ptr);
+  EXPECT_EQ(32u, mem.length);
+  EXPECT_EQ(0x33, static_cast<char *>(mem.ptr)[31]);
+
+  deallocateAndCheckBlockIsThenEmpty(mem);
+}
+
+TEST_F(PerCpuAllocatorTest, ThatForeignBlocksAreNotOwned)
+{
+  alb::mallocator other;
+  auto mem = other.allocate(32);
+  sut.allocate(32);
+  EXPECT_FALSE(sut.owns(mem));
+  other.deallocate(mem);
+}
+
+TEST(PerCpuAllocatorWithThreadsTest, ThatBlocksCanBeFreedByThreadsOnOtherCpus)
+{
+  using Sut = alb::per_cpu_allocator<Heap>;
+  auto sut = std::unique_ptr<Sut>(new Sut);
+  const int NumberOfThreads = 8;
+  const int NumberOfBlocks = 16;
+
+  // Each thread frees the blocks, that the previous one has allocated
+  std::vector<std::vector<alb::block>> blocks(NumberOfThreads);
+  std::vector<std::future<bool>> allocators;
+  for (int t = 0; t < NumberOfThreads; ++t) {
+    allocators.push_back(std::async(std::launch::async, [&sut, &blocks, t] {
+      for (int i = 0; i < NumberOfBlocks; ++i) {
+        auto b = sut->allocate(32);
+        if (!b) {
+          return false;
+        }
+        std::memset(b.ptr, t, b.length);
+        blocks[t].push_back(b);
+      }
+      return true;
+    }));
+  }
+  for (auto &a : allocators) {
+    EXPECT_TRUE(a.get());
+  }
+
+  std::vector<std::future<bool>> freers;
+  for (int t = 0; t < NumberOfThreads; ++t) {
+    freers.push_back(std::async(std::launch::async, [&sut, &blocks, t] {
+      const auto owner = (t + 1) % NumberOfThreads;
+      for (auto &b : blocks[owner]) {
+        if (static_cast<char *>(b.ptr)[0] != owner) {
+          return false;
+        }
+        sut->deallocate(b);
+        if (b) {
+          return false;
+        }
+      }
+      return true;
+    }));
+  }
+  for (auto &f : freers) {
+    EXPECT_TRUE(f.get());
+  }
+}
+
+TEST(PerCpuAllocatorWithFreeListTest, ThatAFreeListPerCpuServesAllThreads)
+{
+  alb::per_cpu_allocator<FreeList> sut;
+  std::vector<std::future<bool>> workers;
+  for (int t = 0; t < 4; ++t) {
+    workers.push_back(std::async(std::launch::async, [&sut] {
+      for (int i = 0; i < 10000; ++i) {
+        auto b = sut.allocate(64);
+        if (!b) {
+          return false;
+        }
+        sut.deallocate(b);
+      }
+      return true;
+    }));
+  }
+  for (auto &w : workers) {
+    EXPECT_TRUE(w.get());
+  }
+  EXPECT_GE(std::thread::hardware_concurrency(), sut.number_of_shards_in_use());
+}
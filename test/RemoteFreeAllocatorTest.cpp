@@ -0,0 +1,167 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#include <gtest/gtest.h>
+#include <alb/heap.hpp>
+#include <alb/mallocator.hpp>
+#include <alb/remote_free_allocator.hpp>
+
+#include "TestHelpers/AllocatorBaseTest.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+  const size_t NumberOfChunks = 256;
+  const size_t ChunkSize = 32;
+
+  using Heap = alb::heap<alb::mallocator, NumberOfChunks, ChunkSize>;
+}
+
+class RemoteFreeAllocatorTest
+    : public alb::test_helpers::AllocatorBaseTest<alb::remote_free_allocator<Heap>> {
+protected:
+  size_t freeChunks() const
+  {
+    return sut.parent().free_chunks().free_chunks;
+  }
+
+  void freeInAnOtherThread(std::vector<alb::block> &blocks)
+  {
+    std::thread([this, &blocks] {
+      for (auto &b : blocks) {
+        sut.deallocate(b);
+      }
+    }).join();
+  }
+};
+
+TEST_F(RemoteFreeAllocatorTest, ThatTheOwnerFreesDirectly)
+{
+  auto mem = sut.allocate(ChunkSize);
+  ASSERT_NE(nullptr, mem.ptr);
+  EXPECT_TRUE(sut.owns(mem));
+  EXPECT_EQ(NumberOfChunks - 1, freeChunks());
+
+  deallocateAndCheckBlockIsThenEmpty(mem);
+  EXPECT_EQ(NumberOfChunks, freeChunks());
+  EXPECT_EQ(0u, sut.drain());
+}
+
+TEST_F(RemoteFreeAllocatorTest, ThatBlocksFreedByAnOtherThreadAreReturnedByTheNextAllocation)
+{
+  std::vector<alb::block> blocks;
+  for (int i = 0; i < 10; ++i) {
+    blocks.push_back(sut.allocate(2 * ChunkSize));
+  }
+  freeInAnOtherThread(blocks);
+  for (auto &b : blocks) {
+    EXPECT_FALSE(b);
+  }
+  // The blocks are still in the queue
+  EXPECT_EQ(NumberOfChunks - 20, freeChunks());
+
+  auto mem = sut.allocate(ChunkSize);
+  EXPECT_EQ(NumberOfChunks - 1, freeChunks());
+  deallocateAndCheckBlockIsThenEmpty(mem);
+}
+
+TEST_F(RemoteFreeAllocatorTest, ThatDrainReturnsTheQueuedBlocksWithTheirLength)
+{
+  std::vector<alb::block> blocks;
+  blocks.push_back(sut.allocate(ChunkSize));
+  blocks.push_back(sut.allocate(3 * ChunkSize));
+  blocks.push_back(sut.allocate(5 * ChunkSize));
+  freeInAnOtherThread(blocks);
+
+  EXPECT_EQ(3u, sut.drain());
+  EXPECT_EQ(NumberOfChunks, freeChunks());
+  EXPECT_EQ(0u, sut.drain());
+}
+
+TEST_F(RemoteFreeAllocatorTest, ThatAnAllocatorBoundToAnOtherThreadQueuesTheFreesOfTheCreator)
+{
+  alb::block mem;
+  std::thread([this, &mem] {
+    sut.bind_to_this_thread();
+    mem = sut.allocate(ChunkSize);
+  }).join();
+
+  sut.deallocate(mem);
+  EXPECT_FALSE(mem);
+  EXPECT_EQ(NumberOfChunks - 1, freeChunks());
+}
+
+TEST(RemoteFreeAllocatorSmallBlockTest, ThatBlocksSmallerThanTheQueueNodeCanBeFreedByAnOtherThread)
+{
+  alb::remote_free_allocator<alb::mallocator> sut;
+  std::vector<alb::block> blocks;
+  blocks.push_back(sut.allocate(1));
+  blocks.push_back(sut.allocate(8));
+  blocks.push_back(sut.allocate(24));
+  ASSERT_TRUE(sut.reallocate(blocks[2], 4));
+  for (auto &b : blocks) {
+    ASSERT_NE(nullptr, b.ptr);
+    EXPECT_LE(2 * sizeof(void *), b.length);
+  }
+
+  std::thread([&sut, &blocks] {
+    for (auto &b : blocks) {
+      sut.deallocate(b);
+    }
+  }).join();
+
+  EXPECT_EQ(3u, sut.drain());
+}
+
+TEST(RemoteFreeAllocatorPipelineTest, ThatTheConsumerCanFreeAllBlocksOfTheProducer)
+{
+  alb::remote_free_allocator<Heap> producerAllocator;
+  std::mutex mutex;
+  std::condition_variable ready;
+  std::deque<alb::block> queue;
+  const int NumberOfMessages = 20000;
+
+  std::thread producer([&] {
+    producerAllocator.bind_to_this_thread();
+    for (int i = 0; i < NumberOfMessages; ++i) {
+      alb::block b;
+      // The heap gets only full, if the consumer is behind
+      while (!(b = producerAllocator.allocate(ChunkSize * (1 + i % 3)))) {
+        std::this_thread::yield();
+      }
+      static_cast<int *>(b.ptr)[0] = i;
+      std::lock_guard<std::mutex> guard(mutex);
+      queue.push_back(b);
+      ready.notify_one();
+    }
+    // Wait until the consumer has freed the last block
+    producerAllocator.drain();
+    while (producerAllocator.parent().free_chunks().free_chunks != NumberOfChunks) {
+      std::this_thread::yield();
+      producerAllocator.drain();
+    }
+  });
+
+  bool inOrder = true;
+  for (int i = 0; i < NumberOfMessages; ++i) {
+    std::unique_lock<std::mutex> lock(mutex);
+    ready.wait(lock, [&] { return !queue.empty(); });
+    auto b = queue.front();
+    queue.pop_front();
+    lock.unlock();
+    inOrder = inOrder && static_cast<int *>(b.ptr)[0] == i;
+    producerAllocator.deallocate(b);
+  }
+  producer.join();
+  EXPECT_TRUE(inOrder);
+}
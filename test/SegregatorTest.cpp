@@ -118,3 +118,29 @@ TEST_F(SegregatorTest, ThatReallocatingALargeBlockToASmallerSizeGoesToTheSmallAl
   EXPECT_EQ(4u, mem.length);
   EXPECT_EQ(StartSmallAllocatorPtr, mem.ptr);
 }
+
+TEST_F(SegregatorTest, ThatTheBlocksOfBothAllocatorsAreOwned)
+{
+  mem = sut.allocate(4);
+  EXPECT_TRUE(sut.owns(mem));
+  deallocateAndCheckBlockIsThenEmpty(mem);
+
+  mem = sut.allocate(LargeBlockSize);
+  EXPECT_TRUE(sut.owns(mem));
+  deallocateAndCheckBlockIsThenEmpty(mem);
+
+  char buffer[LargeBlockSize];
+  EXPECT_FALSE(sut.owns(alb::block(buffer, sizeof(buffer))));
+}
+
+TEST(SegregatorWithoutOwnsTest, ThatItIsUsableIfOnlyOneAllocatorImplementsOwns)
+{
+  alb::segregator<32, alb::stack_allocator<64, 4>, alb::mallocator> sut;
+  auto small = sut.allocate(16);
+  auto large = sut.allocate(LargeBlockSize);
+  EXPECT_NE(nullptr, small.ptr);
+  EXPECT_NE(nullptr, large.ptr);
+  sut.deallocate(large);
+  sut.deallocate(small);
+  sut.deallocate_all();
+}
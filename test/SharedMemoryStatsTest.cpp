@@ -0,0 +1,94 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#include <gtest/gtest.h>
+#include <alb/allocator_with_stats.hpp>
+#include <alb/mallocator.hpp>
+#include <alb/stack_allocator.hpp>
+#include <alb/stats_tree.hpp>
+
+#if defined(ALB_HAS_SHM_STATS)
+
+#include <string>
+#include <unistd.h>
+
+namespace {
+  const unsigned Flags = alb::StatsOptions::NumAll | alb::StatsOptions::BytesAll |
+                         alb::StatsOptions::SharedMemoryCounters;
+
+  struct Published {
+    bool found = false;
+    uint64_t counters[alb::internal::shm_stats::number_of_counters];
+    uint64_t highTide = 0;
+  };
+
+  Published read_published(const std::string &name)
+  {
+    Published result;
+    alb::internal::shm_stats::reader reader;
+    EXPECT_TRUE(reader.open(::getpid()));
+    reader.for_each_slot([&](const char *n, const uint64_t *counters, uint64_t highTide) {
+      if (name == n) {
+        result.found = true;
+        std::copy(counters, counters + alb::internal::shm_stats::number_of_counters,
+                  result.counters);
+        result.highTide = highTide;
+      }
+    });
+    return result;
+  }
+}
+
+TEST(SharedMemoryStatsTest, ThatTheCountersAreVisibleInTheSegmentOfTheProcess)
+{
+  alb::allocator_with_stats<alb::mallocator, Flags> sut;
+  sut.set_stats_name("ThatTheCountersAreVisible");
+
+  auto mem1 = sut.allocate(64);
+  auto mem2 = sut.allocate(32);
+  sut.deallocate(mem1);
+
+  auto published = read_published("ThatTheCountersAreVisible");
+  ASSERT_TRUE(published.found);
+  EXPECT_EQ(2u, published.counters[1]);  // num_allocate
+  EXPECT_EQ(1u, published.counters[8]);  // num_deallocate
+  EXPECT_EQ(96u, published.counters[10]); // bytes_allocated
+  EXPECT_EQ(64u, published.counters[11]); // bytes_deallocated
+  EXPECT_EQ(96u, published.highTide);
+  EXPECT_EQ(2u, sut.num_allocate());
+
+  sut.deallocate(mem2);
+}
+
+TEST(SharedMemoryStatsTest, ThatTheSlotIsFreedWithTheAllocator)
+{
+  {
+    alb::shared_allocator_with_stats<alb::mallocator, Flags> sut;
+    sut.set_stats_name("ThatTheSlotIsFreed");
+    EXPECT_TRUE(read_published("ThatTheSlotIsFreed").found);
+  }
+  EXPECT_FALSE(read_published("ThatTheSlotIsFreed").found);
+}
+
+TEST(SharedMemoryStatsTest, ThatTheNodesOfACompositionAreNamedByTheirPath)
+{
+  alb::fallback_allocator<alb::allocator_with_stats<alb::stack_allocator<64>, Flags>,
+                          alb::allocator_with_stats<alb::mallocator, Flags>>
+    sut;
+  alb::name_stats_nodes(sut);
+
+  auto mem = sut.allocate(128);
+  EXPECT_EQ(1u, read_published("/primary").counters[1]);
+  EXPECT_EQ(0u, read_published("/primary").counters[2]);
+  EXPECT_EQ(1u, read_published("/fallback").counters[2]);
+
+  sut.deallocate(mem);
+}
+
+#endif
@@ -0,0 +1,143 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#include <gtest/gtest.h>
+#include <alb/shared_pool.hpp>
+
+#include "TestHelpers/AllocatorBaseTest.h"
+
+#include <cstring>
+#include <future>
+#include <memory>
+#include <set>
+#include <vector>
+
+class SharedPoolTest
+    : public alb::test_helpers::AllocatorBaseTest<alb::shared_pool<24, 8>> {
+protected:
+  std::vector<alb::block> allocateAll()
+  {
+    std::vector<alb::block> result;
+    for (size_t i = 0; i < sut.capacity; ++i) {
+      result.push_back(sut.allocate(sut.object_size));
+      EXPECT_NE(nullptr, result.back().ptr);
+    }
+    return result;
+  }
+};
+
+TEST_F(SharedPoolTest, ThatObjectsHaveTheSizeAndTheAlignment)
+{
+  EXPECT_FALSE(sut.allocate(0));
+  EXPECT_FALSE(sut.allocate(25));
+
+  auto mem = sut.allocate(1);
+  ASSERT_NE(nullptr, mem.ptr);
+  EXPECT_EQ(24u, mem.length);
+  EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(mem.ptr) % sut.alignment);
+  EXPECT_TRUE(sut.owns(mem));
+
+  deallocateAndCheckBlockIsThenEmpty(mem);
+}
+
+TEST_F(SharedPoolTest, ThatTheAllocationFailsIfThePoolIsExhausted)
+{
+  auto objects = allocateAll();
+  std::set<void *> distinct;
+  for (auto &b : objects) {
+    distinct.insert(b.ptr);
+  }
+  EXPECT_EQ(sut.capacity, distinct.size());
+  EXPECT_FALSE(sut.allocate(1));
+
+  // The last freed object is reused first
+  auto ptr = objects[5].ptr;
+  sut.deallocate(objects[5]);
+  objects[5] = sut.allocate(1);
+  EXPECT_EQ(ptr, objects[5].ptr);
+
+  for (auto &b : objects) {
+    deallocateAndCheckBlockIsThenEmpty(b);
+  }
+  allocateAll();
+  sut.deallocate_all();
+  allocateAll();
+}
+
+TEST_F(SharedPoolTest, ThatAReallocationWithinTheSizeKeepsTheObject)
+{
+  auto mem = sut.allocate(24);
+  const auto ptr = mem.ptr;
+  EXPECT_TRUE(sut.reallocate(mem, 12));
+  EXPECT_EQ(ptr, mem.ptr);
+  EXPECT_EQ(12u, mem.length);
+  EXPECT_FALSE(sut.reallocate(mem, 25));
+  EXPECT_EQ(ptr, mem.ptr);
+
+  deallocateAndCheckBlockIsThenEmpty(mem);
+}
+
+TEST_F(SharedPoolTest, ThatForeignBlocksAreNotOwned)
+{
+  char buffer[24];
+  alb::block foreign(buffer, sizeof(buffer));
+  EXPECT_FALSE(sut.owns(foreign));
+  sut.deallocate(foreign);
+  EXPECT_EQ(buffer, foreign.ptr);
+}
+
+TEST(SharedPoolWithThreadsTest, ThatConcurrentOperationsNeverHandOutAnObjectTwice)
+{
+  using Pool = alb::shared_pool<64, 256>;
+  auto sut = std::unique_ptr<Pool>(new Pool);
+  const int NumberOfThreads = 4;
+
+  std::vector<std::future<bool>> workers;
+  for (int t = 0; t < NumberOfThreads; ++t) {
+    workers.push_back(std::async(std::launch::async, [&sut, t]() {
+      std::vector<alb::block> blocks;
+      for (int i = 0; i < 20000; ++i) {
+        if (blocks.size() < 32) {
+          auto b = sut->allocate(64);
+          if (b) {
+            std::memset(b.ptr, t, b.length);
+            blocks.push_back(b);
+          }
+        }
+        if (i % 3 == 0 && !blocks.empty()) {
+          auto &b = blocks.back();
+          for (size_t j = 0; j < b.length; ++j) {
+            if (static_cast<char *>(b.ptr)[j] != t) {
+              return false;
+            }
+          }
+          sut->deallocate(b);
+          blocks.pop_back();
+        }
+      }
+      for (auto &b : blocks) {
+        sut->deallocate(b);
+      }
+      return true;
+    }));
+  }
+  for (auto &w : workers) {
+    EXPECT_TRUE(w.get());
+  }
+
+  // No object got lost or pushed twice
+  std::set<void *> distinct;
+  for (size_t i = 0; i < Pool::capacity; ++i) {
+    auto b = sut->allocate(64);
+    ASSERT_NE(nullptr, b.ptr);
+    distinct.insert(b.ptr);
+  }
+  EXPECT_EQ(Pool::capacity, distinct.size());
+  EXPECT_FALSE(sut->allocate(64));
+}
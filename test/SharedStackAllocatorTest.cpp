@@ -0,0 +1,170 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#include <gtest/gtest.h>
+#include <alb/shared_stack_allocator.hpp>
+
+#include "util.hpp"
+
+#include "TestHelpers/Base.h"
+#include "TestHelpers/AllocatorBaseTest.h"
+
+#include <cstring>
+#include <future>
+#include <set>
+#include <vector>
+
+class shared_stack_allocatorTest
+    : public alb::test_helpers::AllocatorBaseTest<alb::shared_stack_allocator<64, 4>> {
+};
+
+TEST_F(shared_stack_allocatorTest, ThatAllocatingZeroBytesReturnsAnEmptyMemoryBlock)
+{
+  auto mem = sut.allocate(0);
+  EXPECT_EQ(nullptr, mem.ptr);
+  EXPECT_EQ(0u, mem.length);
+
+  deallocateAndCheckBlockIsThenEmpty(mem);
+}
+
+TEST_F(shared_stack_allocatorTest, ThatAllocatingTwoMemoryBlocksUsesContiguousMemory)
+{
+  auto mem1 = sut.allocate(8);
+  auto mem2 = sut.allocate(5);
+  EXPECT_EQ(mem2.ptr, static_cast<char *>(mem1.ptr) + 8);
+  EXPECT_EQ(8u, mem1.length);
+  EXPECT_EQ(8u, mem2.length);
+
+  deallocateAndCheckBlockIsThenEmpty(mem2);
+  deallocateAndCheckBlockIsThenEmpty(mem1);
+}
+
+TEST_F(shared_stack_allocatorTest, ThatOnlyTheLastAllocatedBlockGetsReusedAfterADeallocation)
+{
+  auto mem1 = sut.allocate(8);
+  auto mem2 = sut.allocate(8);
+
+  auto ptrOf1stLocation = mem1.ptr;
+  auto ptrOf2ndLocation = mem2.ptr;
+  deallocateAndCheckBlockIsThenEmpty(mem1);
+
+  auto mem3 = sut.allocate(8);
+  EXPECT_NE(ptrOf1stLocation, mem3.ptr);
+
+  deallocateAndCheckBlockIsThenEmpty(mem3);
+  deallocateAndCheckBlockIsThenEmpty(mem2);
+
+  auto mem4 = sut.allocate(8);
+  EXPECT_EQ(ptrOf2ndLocation, mem4.ptr);
+
+  deallocateAndCheckBlockIsThenEmpty(mem4);
+}
+
+TEST_F(shared_stack_allocatorTest, ThatAFailedAllocationDoesNotConsumeMemory)
+{
+  auto mem1 = sut.allocate(48);
+  auto tooLarge = sut.allocate(32);
+  EXPECT_FALSE(tooLarge);
+  EXPECT_EQ(48u, sut.used());
+
+  auto mem2 = sut.allocate(16);
+  EXPECT_TRUE(static_cast<bool>(mem2));
+  EXPECT_EQ(static_cast<char *>(mem1.ptr) + 48, mem2.ptr);
+
+  deallocateAndCheckBlockIsThenEmpty(mem2);
+  deallocateAndCheckBlockIsThenEmpty(mem1);
+}
+
+TEST_F(shared_stack_allocatorTest, ThatExpandingTheLastBlockWorksAndOfAnOlderBlockFails)
+{
+  auto mem1 = sut.allocate(8);
+  auto mem2 = sut.allocate(8);
+
+  EXPECT_FALSE(sut.expand(mem1, 8));
+  EXPECT_EQ(8u, mem1.length);
+
+  EXPECT_TRUE(sut.expand(mem2, 8));
+  EXPECT_EQ(16u, mem2.length);
+
+  EXPECT_FALSE(sut.expand(mem2, 64));
+  EXPECT_EQ(16u, mem2.length);
+
+  deallocateAndCheckBlockIsThenEmpty(mem2);
+  deallocateAndCheckBlockIsThenEmpty(mem1);
+}
+
+TEST_F(shared_stack_allocatorTest, ThatAnIncreasingReallocationWithABlockInbetweenKeepsTheData)
+{
+  auto mem = sut.allocate(4);
+  auto memInbetween = sut.allocate(4);
+
+  auto memOiginalPtr = mem.ptr;
+  *static_cast<int *>(mem.ptr) = 42;
+  *static_cast<int *>(memInbetween.ptr) = 4711;
+  EXPECT_TRUE(sut.reallocate(mem, 8));
+
+  ASSERT_NE(memOiginalPtr, mem.ptr);
+  EXPECT_EQ(42, *static_cast<int *>(mem.ptr));
+  EXPECT_EQ(8u, mem.length);
+  EXPECT_EQ(4711, *static_cast<int *>(memInbetween.ptr));
+
+  deallocateAndCheckBlockIsThenEmpty(mem);
+  deallocateAndCheckBlockIsThenEmpty(memInbetween);
+}
+
+TEST_F(shared_stack_allocatorTest, ThatDeallocateAllMakesTheCompleteMemoryAvailableAgain)
+{
+  auto mem1 = sut.allocate(32);
+  auto mem2 = sut.allocate(32);
+  ignore_unused(mem2);
+
+  sut.deallocate_all();
+  EXPECT_EQ(0u, sut.used());
+
+  auto mem3 = sut.allocate(64);
+  EXPECT_EQ(mem1.ptr, mem3.ptr);
+  EXPECT_EQ(64u, mem3.length);
+}
+
+TEST(shared_stack_allocatorWithThreadsTest, ThatConcurrentAllocationsNeverOverlap)
+{
+  const size_t NumberOfThreads = 4;
+  const size_t AllocationsPerThread = 1000;
+  using AllocatorUnderTest =
+      alb::shared_stack_allocator<NumberOfThreads * AllocationsPerThread * 16, 16>;
+  auto sut = std::make_unique<AllocatorUnderTest>();
+
+  std::vector<std::future<std::vector<alb::block>>> workers;
+  for (size_t t = 0; t < NumberOfThreads; ++t) {
+    workers.push_back(std::async(std::launch::async, [&sut, t]() {
+      std::vector<alb::block> result;
+      for (size_t i = 0; i < AllocationsPerThread; ++i) {
+        auto b = sut->allocate(1 + (i + t) % 16);
+        if (b) {
+          ::memset(b.ptr, static_cast<int>(t), b.length);
+          result.push_back(b);
+        }
+      }
+      return result;
+    }));
+  }
+
+  std::set<void *> pointers;
+  size_t numberOfBlocks = 0;
+  for (auto &w : workers) {
+    for (auto &b : w.get()) {
+      EXPECT_EQ(16u, b.length);
+      pointers.insert(b.ptr);
+      ++numberOfBlocks;
+    }
+  }
+  EXPECT_EQ(NumberOfThreads * AllocationsPerThread, numberOfBlocks);
+  EXPECT_EQ(numberOfBlocks, pointers.size());
+  EXPECT_FALSE(sut->allocate(1));
+}
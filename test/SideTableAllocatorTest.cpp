@@ -0,0 +1,153 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#include <gtest/gtest.h>
+#include <alb/side_table_allocator.hpp>
+#include <alb/allocator_with_stats.hpp>
+#include <alb/freelist.hpp>
+#include <alb/heap.hpp>
+#include <alb/mallocator.hpp>
+
+#include "TestHelpers/AllocatorBaseTest.h"
+
+#include <cstring>
+
+namespace {
+  struct Metadata {
+    Metadata() : value(42) {}
+    int value;
+  };
+
+  const size_t ChunkSize = 64;
+  const size_t NumberOfChunks = 64;
+
+  using HeapWithSideTable =
+    alb::side_table_allocator<alb::heap<alb::mallocator, NumberOfChunks, ChunkSize>, Metadata>;
+  using FreeListWithSideTable = alb::side_table_allocator<
+    alb::freelist<alb::heap<alb::mallocator, NumberOfChunks, ChunkSize>, 0, ChunkSize>, Metadata>;
+
+  // Cannot provide the memory of the table
+  struct FailingTableAllocator {
+    static constexpr bool supports_truncated_deallocation = false;
+    static constexpr unsigned alignment = 4;
+
+    alb::block allocate(size_t) noexcept
+    {
+      return {};
+    }
+
+    void deallocate(alb::block &) noexcept
+    {
+    }
+  };
+}
+
+template <class T> class SideTableAllocatorTest : public alb::test_helpers::AllocatorBaseTest<T> {
+};
+
+using TypesForSideTableTest = ::testing::Types<HeapWithSideTable, FreeListWithSideTable>;
+
+TYPED_TEST_CASE(SideTableAllocatorTest, TypesForSideTableTest);
+
+TYPED_TEST(SideTableAllocatorTest, ThatAllocatingZeroBytesReturnsAnEmptyMemoryBlock)
+{
+  auto mem = this->sut.allocate(0);
+  EXPECT_EQ(nullptr, mem.ptr);
+  EXPECT_EQ(0u, mem.length);
+  EXPECT_EQ(nullptr, this->sut.metadata(mem));
+}
+
+TYPED_TEST(SideTableAllocatorTest, ThatTheReturnedBlocksAreNotShiftedByTheMetadata)
+{
+  auto mem = this->sut.allocate(ChunkSize);
+  EXPECT_EQ(ChunkSize, mem.length);
+  EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(mem.ptr) % TypeParam::alignment);
+
+  this->deallocateAndCheckBlockIsThenEmpty(mem);
+}
+
+TYPED_TEST(SideTableAllocatorTest, ThatEachBlockHasItsOwnMetadataOutsideOfTheBlock)
+{
+  auto mem1 = this->sut.allocate(ChunkSize);
+  auto mem2 = this->sut.allocate(ChunkSize);
+  ::memset(mem1.ptr, 0, mem1.length);
+  ::memset(mem2.ptr, 0, mem2.length);
+
+  auto m1 = this->sut.metadata(mem1);
+  auto m2 = this->sut.metadata(mem2);
+  ASSERT_NE(m1, m2);
+  EXPECT_EQ(42, m1->value);
+  EXPECT_EQ(42, m2->value);
+
+  m1->value = 1;
+  m2->value = 2;
+  EXPECT_EQ(1, this->sut.metadata(mem1)->value);
+  EXPECT_EQ(2, this->sut.metadata(mem2)->value);
+  EXPECT_EQ(0, *static_cast<char *>(mem1.ptr));
+
+  this->deallocateAndCheckBlockIsThenEmpty(mem2);
+  this->deallocateAndCheckBlockIsThenEmpty(mem1);
+}
+
+TEST(SideTableAllocatorOverHeapTest, ThatAMovingReallocationMovesTheMetadata)
+{
+  HeapWithSideTable sut;
+  auto mem = sut.allocate(ChunkSize);
+  auto blocker = sut.allocate(ChunkSize);
+  *static_cast<int *>(mem.ptr) = 4711;
+  sut.metadata(mem)->value = 7;
+
+  auto oldPtr = mem.ptr;
+  EXPECT_TRUE(sut.reallocate(mem, 2 * ChunkSize));
+  ASSERT_NE(oldPtr, mem.ptr);
+  EXPECT_EQ(2 * ChunkSize, mem.length);
+  EXPECT_EQ(4711, *static_cast<int *>(mem.ptr));
+  EXPECT_EQ(7, sut.metadata(mem)->value);
+  EXPECT_EQ(42, sut.metadata(blocker)->value);
+
+  sut.deallocate(blocker);
+  sut.deallocate(mem);
+}
+
+TEST(SideTableAllocatorWithoutTableTest, ThatNothingIsAllocatedIfTheTableCannotBeCreated)
+{
+  alb::side_table_allocator<alb::heap<alb::mallocator, NumberOfChunks, ChunkSize>, Metadata,
+                            FailingTableAllocator> sut;
+  auto mem = sut.allocate(ChunkSize);
+  EXPECT_EQ(nullptr, mem.ptr);
+
+  EXPECT_FALSE(sut.reallocate(mem, ChunkSize));
+  EXPECT_EQ(nullptr, mem.ptr);
+}
+
+TEST(SideTableAllocatorWithStatsTest, ThatTheCallerInformationIsStoredInTheSideTable)
+{
+  using Heap = alb::heap<alb::mallocator, NumberOfChunks, ChunkSize>;
+  alb::allocator_with_stats<alb::side_table_allocator<Heap, alb::affix_helper::no_affix>,
+                            alb::StatsOptions::All> sut;
+
+  auto mem1 = sut.allocate(ChunkSize, __FILE__, __FUNCTION__, 4711);
+  auto mem2 = sut.allocate(ChunkSize, __FILE__, __FUNCTION__, 4712);
+  EXPECT_EQ(ChunkSize, mem1.length);
+  EXPECT_EQ(static_cast<char *>(mem1.ptr) + ChunkSize, mem2.ptr);
+
+  auto allocations = sut.allocations();
+  auto it = allocations.cbegin();
+  ASSERT_NE(allocations.cend(), it);
+  EXPECT_EQ(ChunkSize, (*it)->callerSize);
+  EXPECT_EQ(4712, (*it)->callerLine);
+  ++it;
+  ASSERT_NE(allocations.cend(), it);
+  EXPECT_EQ(4711, (*it)->callerLine);
+  ++it;
+  EXPECT_EQ(allocations.cend(), it);
+
+  sut.deallocate(mem2);
+  sut.deallocate(mem1);
+}
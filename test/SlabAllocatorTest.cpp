@@ -0,0 +1,176 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#include <gtest/gtest.h>
+#include <alb/aligned_mallocator.hpp>
+#include <alb/slab_allocator.hpp>
+
+#include "TestHelpers/AllocatorBaseTest.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace {
+  const size_t SlabSize = 4096;
+
+  // Returns blocks, that are never aligned to the SlabSize
+  class misaligning_allocator {
+    alb::aligned_mallocator<SlabSize> allocator_;
+
+  public:
+    static constexpr bool supports_truncated_deallocation = false;
+    static constexpr unsigned alignment = 16;
+
+    alb::block allocate(size_t n) noexcept
+    {
+      auto b = allocator_.allocate(n + 16);
+      return b ? alb::block(static_cast<char *>(b.ptr) + 16, n) : alb::block();
+    }
+
+    void deallocate(alb::block &b) noexcept
+    {
+      alb::block original(static_cast<char *>(b.ptr) - 16, b.length + 16);
+      allocator_.deallocate(original);
+      b.reset();
+    }
+  };
+
+  uintptr_t slab_of(const alb::block &b)
+  {
+    return reinterpret_cast<uintptr_t>(b.ptr) & ~uintptr_t(SlabSize - 1);
+  }
+}
+
+template <class T> class SlabAllocatorTest : public alb::test_helpers::AllocatorBaseTest<T> {
+protected:
+  using sut_type = T;
+
+  std::vector<alb::block> allocateObjects(size_t n)
+  {
+    std::vector<alb::block> result;
+    for (size_t i = 0; i < n; ++i) {
+      result.push_back(this->sut.allocate(T::object_size));
+      EXPECT_NE(nullptr, result.back().ptr);
+    }
+    return result;
+  }
+};
+
+using TypesForSlabAllocatorTest =
+  ::testing::Types<alb::slab_allocator<alb::aligned_mallocator<SlabSize>, 32, SlabSize>,
+                   alb::slab_allocator<alb::aligned_mallocator<SlabSize>, 256, SlabSize>,
+                   alb::slab_allocator<alb::aligned_mallocator<SlabSize>, 8, SlabSize, 0>>;
+
+TYPED_TEST_CASE(SlabAllocatorTest, TypesForSlabAllocatorTest);
+
+TYPED_TEST(SlabAllocatorTest, ThatObjectsHaveTheObjectSizeAndAreOwned)
+{
+  auto mem = this->sut.allocate(TypeParam::object_size - 1);
+  ASSERT_NE(nullptr, mem.ptr);
+  EXPECT_EQ(TypeParam::object_size, mem.length);
+  EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(mem.ptr) % TypeParam::alignment);
+  EXPECT_TRUE(this->sut.owns(mem));
+
+  EXPECT_FALSE(this->sut.allocate(0));
+  EXPECT_FALSE(this->sut.allocate(TypeParam::object_size + 1));
+  this->deallocateAndCheckBlockIsThenEmpty(mem);
+}
+
+TYPED_TEST(SlabAllocatorTest, ThatTheObjectsArePackedIntoAsFewSlabsAsPossible)
+{
+  auto objects = this->allocateObjects(TypeParam::objects_per_slab);
+  EXPECT_EQ(1u, this->sut.number_of_slabs());
+  for (auto &b : objects) {
+    EXPECT_EQ(slab_of(objects.front()), slab_of(b));
+    EXPECT_LE(reinterpret_cast<uintptr_t>(b.ptr) + b.length, slab_of(b) + SlabSize);
+  }
+
+  auto next = this->sut.allocate(TypeParam::object_size);
+  EXPECT_EQ(2u, this->sut.number_of_slabs());
+  EXPECT_NE(slab_of(objects.front()), slab_of(next));
+
+  // A freed object is reused before the second slab gets another one
+  this->sut.deallocate(objects[3]);
+  objects[3] = this->sut.allocate(TypeParam::object_size);
+  EXPECT_EQ(slab_of(objects.front()), slab_of(objects[3]));
+
+  this->sut.deallocate(next);
+  for (auto &b : objects) {
+    this->deallocateAndCheckBlockIsThenEmpty(b);
+  }
+}
+
+TYPED_TEST(SlabAllocatorTest, ThatAllocationsComeFromTheFullestPartialSlab)
+{
+  auto first = this->allocateObjects(TypeParam::objects_per_slab);
+  auto second = this->allocateObjects(TypeParam::objects_per_slab);
+  ASSERT_EQ(2u, this->sut.number_of_slabs());
+
+  // The first slab has then two and the second one free object
+  this->sut.deallocate(first[0]);
+  this->sut.deallocate(first[1]);
+  this->sut.deallocate(second[0]);
+
+  auto mem = this->sut.allocate(TypeParam::object_size);
+  EXPECT_EQ(slab_of(second[1]), slab_of(mem));
+  auto mem2 = this->sut.allocate(TypeParam::object_size);
+  EXPECT_EQ(slab_of(first[2]), slab_of(mem2));
+
+  this->sut.deallocate(mem);
+  this->sut.deallocate(mem2);
+  for (auto &b : first) {
+    this->sut.deallocate(b);
+  }
+  for (auto &b : second) {
+    this->sut.deallocate(b);
+  }
+}
+
+TYPED_TEST(SlabAllocatorTest, ThatEmptySlabsAreReturnedBeyondTheKeptOnes)
+{
+  auto objects = this->allocateObjects(3 * TypeParam::objects_per_slab);
+  EXPECT_EQ(3u, this->sut.number_of_slabs());
+  for (auto &b : objects) {
+    this->sut.deallocate(b);
+  }
+  EXPECT_GE(1u, this->sut.number_of_slabs());
+  EXPECT_EQ(this->sut.number_of_slabs(), this->sut.number_of_empty_slabs());
+
+  objects = this->allocateObjects(TypeParam::objects_per_slab);
+  EXPECT_EQ(1u, this->sut.number_of_slabs());
+  this->sut.deallocate_all();
+  EXPECT_EQ(0u, this->sut.number_of_slabs());
+}
+
+TYPED_TEST(SlabAllocatorTest, ThatBlocksOfAnOtherInstanceAreNotOwned)
+{
+  TypeParam other;
+  auto mem = other.allocate(TypeParam::object_size);
+  EXPECT_TRUE(other.owns(mem));
+  EXPECT_FALSE(this->sut.owns(mem));
+  other.deallocate(mem);
+}
+
+TYPED_TEST(SlabAllocatorTest, ThatAReallocationWithinTheObjectSizeKeepsTheObject)
+{
+  auto mem = this->sut.allocate(TypeParam::object_size);
+  const auto ptr = mem.ptr;
+  EXPECT_TRUE(this->sut.reallocate(mem, TypeParam::object_size / 2));
+  EXPECT_EQ(ptr, mem.ptr);
+  EXPECT_FALSE(this->sut.reallocate(mem, TypeParam::object_size + 1));
+  EXPECT_EQ(ptr, mem.ptr);
+  this->deallocateAndCheckBlockIsThenEmpty(mem);
+}
+
+TEST(SlabAllocatorWithMisalignedParentTest, ThatTheAllocationFailsWithoutLeakingTheSlab)
+{
+  alb::slab_allocator<misaligning_allocator, 64, SlabSize> sut;
+  EXPECT_FALSE(sut.allocate(64));
+  EXPECT_EQ(0u, sut.number_of_slabs());
+}
@@ -0,0 +1,96 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#include <gtest/gtest.h>
+#include <alb/stats_exporter.hpp>
+#include <alb/mallocator.hpp>
+#include <alb/stack_allocator.hpp>
+
+#include <cstring>
+#include <string>
+
+namespace {
+  const unsigned Flags = alb::StatsOptions::NumAll | alb::StatsOptions::BytesAll;
+
+  bool contains(const char *text, const char *part)
+  {
+    return ::strstr(text, part) != nullptr;
+  }
+}
+
+TEST(StatsExporterTest, ThatAllCountersAreWrittenAsJson)
+{
+  alb::allocator_with_stats<alb::mallocator, Flags | alb::StatsOptions::SizeHistogram> sut;
+  auto mem = sut.allocate(16);
+  sut.deallocate(mem);
+
+  char buffer[4096];
+  const auto length = alb::write_json(buffer, sizeof(buffer), sut);
+  EXPECT_EQ(::strlen(buffer), length);
+  EXPECT_EQ('{', buffer[0]);
+  EXPECT_EQ('}', buffer[length - 1]);
+  EXPECT_TRUE(contains(buffer, "{\"num_owns\":0,\"num_allocate\":1,"));
+  EXPECT_TRUE(contains(buffer, "\"bytes_allocated\":16,\"bytes_deallocated\":16,"));
+  EXPECT_TRUE(contains(buffer, "\"bytes_high_tide\":16,\"size_histogram\":[0,0,0,0,1,0,"));
+  EXPECT_FALSE(contains(buffer, "slack_histogram"));
+}
+
+TEST(StatsExporterTest, ThatATooSmallBufferIsTruncatedAndTheNeededSizeIsReturned)
+{
+  alb::stats_snapshot snapshot{};
+  char full[1024];
+  const auto length = alb::write_json(full, sizeof(full), snapshot);
+
+  char buffer[16];
+  EXPECT_EQ(length, alb::write_json(buffer, sizeof(buffer), snapshot));
+  EXPECT_EQ(sizeof(buffer) - 1, ::strlen(buffer));
+  EXPECT_EQ(0, ::strncmp(full, buffer, sizeof(buffer) - 1));
+
+  EXPECT_EQ(length, alb::write_json(nullptr, 0, snapshot));
+}
+
+TEST(StatsExporterTest, ThatAllCountersAreWrittenInThePrometheusFormat)
+{
+  alb::allocator_with_stats<alb::mallocator, Flags | alb::StatsOptions::SizeHistogram> sut;
+  auto mem = sut.allocate(16);
+
+  char buffer[4096];
+  const auto length = alb::write_prometheus(buffer, sizeof(buffer), sut, "app");
+  EXPECT_EQ(::strlen(buffer), length);
+  EXPECT_TRUE(contains(buffer, "# TYPE app_num_allocate counter\napp_num_allocate 1\n"));
+  EXPECT_TRUE(contains(buffer, "# TYPE app_bytes_high_tide gauge\napp_bytes_high_tide 16\n"));
+  EXPECT_TRUE(contains(buffer, "# TYPE app_requests_total counter\n"
+                               "app_requests_total{size_class=\"4\"} 1\n"));
+
+  sut.deallocate(mem);
+}
+
+TEST(StatsExporterTest, ThatAllNodesOfACompositionAreWritten)
+{
+  alb::fallback_allocator<alb::allocator_with_stats<alb::stack_allocator<64>, Flags>,
+                          alb::allocator_with_stats<alb::mallocator, Flags>>
+    sut;
+  auto mem = sut.allocate(128);
+
+  char buffer[8192];
+  alb::write_json_tree(buffer, sizeof(buffer), sut);
+  EXPECT_TRUE(contains(buffer, "{\"/primary\":{\"num_owns\":"));
+  EXPECT_TRUE(contains(buffer, "},\"/fallback\":{\"num_owns\":0,\"num_allocate\":1,"));
+
+  alb::write_prometheus_tree(buffer, sizeof(buffer), sut);
+  EXPECT_TRUE(contains(buffer, "# TYPE alb_num_allocate_ok counter\n"
+                               "alb_num_allocate_ok{node=\"/primary\"} 0\n"
+                               "alb_num_allocate_ok{node=\"/fallback\"} 1\n"));
+
+  alb::write_prometheus_tree<1>(buffer, sizeof(buffer), sut);
+  EXPECT_TRUE(contains(buffer, "alb_num_allocate_ok{node=\"/primary\"} 0\n"));
+  EXPECT_FALSE(contains(buffer, "/fallback"));
+
+  sut.deallocate(mem);
+}
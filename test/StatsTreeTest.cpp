@@ -0,0 +1,116 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#include <gtest/gtest.h>
+#include <alb/stats_tree.hpp>
+#include <alb/heap.hpp>
+#include <alb/mallocator.hpp>
+#include <alb/stack_allocator.hpp>
+
+#include <map>
+#include <string>
+
+namespace {
+  const unsigned Flags = alb::StatsOptions::NumAll | alb::StatsOptions::BytesAll;
+
+  template <class Allocator>
+  using Counted = alb::allocator_with_stats<Allocator, Flags>;
+
+  using SmallAllocator = alb::bucketizer<
+    Counted<alb::freelist<Counted<alb::mallocator>, alb::internal::DynasticDynamicSet,
+                          alb::internal::DynasticDynamicSet>>,
+    1, 64, 16>;
+  using LargeAllocator =
+    alb::fallback_allocator<Counted<alb::stack_allocator<1024>>, Counted<alb::mallocator>>;
+  using Composition = Counted<alb::segregator<64, SmallAllocator, LargeAllocator>>;
+
+  template <class Allocator>
+  std::map<std::string, alb::stats_snapshot> collect(const Allocator &allocator)
+  {
+    std::map<std::string, alb::stats_snapshot> result;
+    alb::for_each_stats_node(allocator, [&result](const char *path, const alb::stats_snapshot &s) {
+      result[path] = s;
+    });
+    return result;
+  }
+}
+
+TEST(StatsTreeTest, ThatAllNodesOfTheCompositionAreVisited)
+{
+  Composition sut;
+  auto nodes = collect(sut);
+
+  EXPECT_EQ(1u + 4u * 2u + 2u, nodes.size());
+  EXPECT_EQ(1u, nodes.count("/"));
+  EXPECT_EQ(1u, nodes.count("/small/bucket[0]"));
+  EXPECT_EQ(1u, nodes.count("/small/bucket[3]/parent"));
+  EXPECT_EQ(1u, nodes.count("/large/primary"));
+  EXPECT_EQ(1u, nodes.count("/large/fallback"));
+}
+
+TEST(StatsTreeTest, ThatEachTierCountsTheRequestsItServed)
+{
+  Composition sut;
+  auto small1 = sut.allocate(10);
+  auto small2 = sut.allocate(40);
+  auto large1 = sut.allocate(100);
+  auto large2 = sut.allocate(2000);
+  sut.deallocate(small1);
+  small1 = sut.allocate(10);
+
+  auto nodes = collect(sut);
+  EXPECT_EQ(5u, nodes["/"].num_allocate);
+  EXPECT_EQ(2u, nodes["/small/bucket[0]"].num_allocate);
+  // The first request of a freelist fills its pool with a batch of 8 blocks,
+  // the second one is a hit
+  EXPECT_EQ(8u, nodes["/small/bucket[0]/parent"].num_allocate);
+  EXPECT_EQ(1u, nodes["/small/bucket[2]"].num_allocate);
+  EXPECT_EQ(0u, nodes["/small/bucket[1]"].num_allocate);
+  EXPECT_EQ(0u, nodes["/small/bucket[1]/parent"].num_allocate);
+  EXPECT_EQ(2u, nodes["/large/primary"].num_allocate);
+  EXPECT_EQ(1u, nodes["/large/primary"].num_allocate_ok);
+  EXPECT_EQ(1u, nodes["/large/fallback"].num_allocate);
+  EXPECT_EQ(2000u, nodes["/large/fallback"].bytes_allocated);
+
+  sut.deallocate(large2);
+  sut.deallocate(large1);
+  sut.deallocate(small2);
+  sut.deallocate(small1);
+}
+
+TEST(StatsTreeTest, ThatEachNodeOfACascadingAllocatorIsVisited)
+{
+  alb::cascading_allocator<Counted<alb::heap<alb::mallocator, 64, 64>>> sut;
+  auto mem1 = sut.allocate(2048);
+  auto mem2 = sut.allocate(2048);
+
+  auto nodes = collect(sut);
+  ASSERT_EQ(2u, nodes.size());
+  EXPECT_LE(2u, nodes["/node[0]"].num_allocate_ok);
+  EXPECT_LE(2u, nodes["/node[1]"].num_allocate_ok);
+
+  sut.deallocate(mem2);
+  sut.deallocate(mem1);
+}
+
+TEST(StatsTreeTest, ThatTheNodesBelowANodeWithCallerInformationAreVisited)
+{
+  const unsigned CallerFlags = Flags | alb::StatsOptions::CallerSize |
+                               alb::StatsOptions::CallerFile | alb::StatsOptions::CallerLine;
+  alb::allocator_with_stats<alb::segregator<64, SmallAllocator, LargeAllocator>, CallerFlags>
+    sut;
+  auto mem = sut.allocate(100);
+
+  auto nodes = collect(sut);
+  EXPECT_EQ(1u + 4u * 2u + 2u, nodes.size());
+  EXPECT_EQ(1u, nodes["/"].num_allocate);
+  EXPECT_EQ(1u, nodes["/large/primary"].num_allocate_ok);
+
+  sut.deallocate(mem);
+}
@@ -0,0 +1,79 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#include <gtest/gtest.h>
+#include <alb/global_allocator.hpp>
+#include <alb/heap.hpp>
+#include <alb/mallocator.hpp>
+#include <alb/segregator.hpp>
+#include <alb/stl_allocator.hpp>
+#include <alb/stl_allocator_adapter.hpp>
+
+#include <map>
+#include <vector>
+
+namespace {
+  const size_t ChunkSize = 32;
+  const size_t NumberOfChunks = 64;
+
+  using Heap = alb::heap<alb::mallocator, NumberOfChunks, ChunkSize>;
+}
+
+TEST(SizedStdAllocatorAdapterTest, ThatAVectorReturnsAllChunksToTheHeapWithoutAPrefix)
+{
+  Heap heap;
+  {
+    using Adapter = alb::sized_std_allocator_adapter<int, Heap>;
+    std::vector<int, Adapter> v{Adapter(heap)};
+    for (int i = 0; i < 100; ++i) {
+      v.push_back(i);
+    }
+    EXPECT_EQ(99, v.back());
+    EXPECT_TRUE(heap.owns(alb::block(v.data(), v.capacity() * sizeof(int))));
+  }
+  auto all = heap.allocate(NumberOfChunks * ChunkSize);
+  EXPECT_EQ(NumberOfChunks * ChunkSize, all.length);
+  heap.deallocate(all);
+}
+
+TEST(SizedStdAllocatorAdapterTest, ThatAdaptersOfTheSameAllocatorCompareEqual)
+{
+  Heap heap1, heap2;
+  alb::sized_std_allocator_adapter<int, Heap> a1(heap1);
+  alb::sized_std_allocator_adapter<double, Heap> a2(heap1);
+  alb::sized_std_allocator_adapter<int, Heap> a3(heap2);
+
+  EXPECT_TRUE(a1 == a2);
+  EXPECT_TRUE(a1 != a3);
+}
+
+TEST(SizedStlAllocatorTest, ThatMapNodesAreReturnedToTheCorrectPartOfASegregator)
+{
+  using Allocator = alb::segregator<ChunkSize, Heap, alb::mallocator>;
+  using Global = alb::global_allocator<Allocator>;
+  using Map = std::map<int, int, std::less<int>, alb::sized_stl_allocator<std::pair<const int, int>, Global>>;
+
+  EXPECT_EQ(ChunkSize, Global::instance().good_size(1));
+  EXPECT_EQ(ChunkSize + 1, Global::instance().good_size(ChunkSize + 1));
+  {
+    Map m;
+    for (int i = 0; i < 20; ++i) {
+      m[i] = 2 * i;
+    }
+    EXPECT_EQ(20u, m.size());
+    EXPECT_EQ(38, m[19]);
+  }
+  {
+    Map m;
+    for (int i = 0; i < 20; ++i) {
+      m[i] = i;
+    }
+    EXPECT_EQ(20u, m.size());
+  }
+}
@@ -0,0 +1,195 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#include <gtest/gtest.h>
+#include <alb/fallback_allocator.hpp>
+#include <alb/mallocator.hpp>
+#include <alb/tlsf_allocator.hpp>
+
+#include "TestHelpers/AllocatorBaseTest.h"
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+  const size_t AreaSize = 64 * 1024;
+}
+
+class TlsfAllocatorTest
+  : public alb::test_helpers::AllocatorBaseTest<alb::tlsf_allocator<alb::mallocator, AreaSize>> {
+protected:
+  // Checks, that the whole area is free again as one block
+  void expectCompletelyMerged()
+  {
+    auto mem = sut.allocate(sut.max_allocation);
+    EXPECT_NE(nullptr, mem.ptr);
+    sut.deallocate(mem);
+  }
+};
+
+TEST_F(TlsfAllocatorTest, ThatAllocationsAreRoundedUpToSixteenBytes)
+{
+  EXPECT_FALSE(sut.allocate(0));
+  EXPECT_FALSE(sut.allocate(sut.max_allocation + 1));
+
+  auto mem = sut.allocate(1);
+  ASSERT_NE(nullptr, mem.ptr);
+  EXPECT_EQ(16u, mem.length);
+  EXPECT_TRUE(sut.owns(mem));
+  auto mem2 = sut.allocate(1000);
+  EXPECT_EQ(1008u, mem2.length);
+  EXPECT_EQ(sut.good_size(1000), mem2.length);
+  EXPECT_EQ(0u, (static_cast<char *>(mem2.ptr) - static_cast<char *>(mem.ptr)) % 16);
+
+  this->deallocateAndCheckBlockIsThenEmpty(mem);
+  this->deallocateAndCheckBlockIsThenEmpty(mem2);
+  expectCompletelyMerged();
+}
+
+TEST_F(TlsfAllocatorTest, ThatTheWholeAreaCanBeAllocatedOnceAndThenNothingElse)
+{
+  auto mem = sut.allocate(sut.max_allocation);
+  ASSERT_NE(nullptr, mem.ptr);
+  EXPECT_FALSE(sut.allocate(1));
+  this->deallocateAndCheckBlockIsThenEmpty(mem);
+  expectCompletelyMerged();
+}
+
+TEST_F(TlsfAllocatorTest, ThatAFreedBlockIsMergedWithBothNeighbours)
+{
+  auto a = sut.allocate(100);
+  auto b = sut.allocate(200);
+  auto c = sut.allocate(300);
+  auto d = sut.allocate(sut.max_allocation - 100 - 200 - 300 - 3 * 16 - 32);
+  ASSERT_NE(nullptr, d.ptr);
+  EXPECT_FALSE(sut.allocate(1));
+
+  const auto bPtr = b.ptr;
+  sut.deallocate(a);
+  sut.deallocate(c);
+  EXPECT_FALSE(sut.allocate(600));
+  sut.deallocate(b);
+  // a, b and c are one free block again, that starts at a
+  auto merged = sut.allocate(600);
+  ASSERT_NE(nullptr, merged.ptr);
+  EXPECT_LT(merged.ptr, bPtr);
+
+  sut.deallocate(merged);
+  sut.deallocate(d);
+  expectCompletelyMerged();
+}
+
+TEST_F(TlsfAllocatorTest, ThatAnExpandGrowsIntoTheFollowingFreeBlock)
+{
+  auto mem = sut.allocate(64);
+  auto next = sut.allocate(64);
+  auto blocker = sut.allocate(64);
+  std::memset(mem.ptr, 0x42, mem.length);
+
+  EXPECT_FALSE(sut.expand(mem, 16));
+  sut.deallocate(next);
+  EXPECT_TRUE(sut.expand(mem, 64));
+  EXPECT_EQ(128u, mem.length);
+  EXPECT_FALSE(sut.expand(mem, 32));
+  EXPECT_EQ(0x42, static_cast<char *>(mem.ptr)[63]);
+
+  // The rest of the absorbed block is free again
+  sut.deallocate(blocker);
+  EXPECT_TRUE(sut.expand(mem, 1000));
+  EXPECT_EQ(1136u, mem.length);
+
+  this->deallocateAndCheckBlockIsThenEmpty(mem);
+  expectCompletelyMerged();
+}
+
+TEST_F(TlsfAllocatorTest, ThatAShrinkingReallocationReturnsTheRestInPlace)
+{
+  auto mem = sut.allocate(4096);
+  auto blocker = sut.allocate(16);
+  const auto ptr = mem.ptr;
+  EXPECT_TRUE(sut.reallocate(mem, 1024));
+  EXPECT_EQ(ptr, mem.ptr);
+  EXPECT_EQ(1024u, mem.length);
+
+  // The rest is free again, so the block can grow back in place
+  EXPECT_TRUE(sut.expand(mem, 4096 - 1024));
+  EXPECT_EQ(ptr, mem.ptr);
+  EXPECT_EQ(4096u, mem.length);
+
+  sut.deallocate(blocker);
+  this->deallocateAndCheckBlockIsThenEmpty(mem);
+  expectCompletelyMerged();
+}
+
+TEST_F(TlsfAllocatorTest, ThatAGrowingReallocationCopiesIfTheNeighbourIsUsed)
+{
+  auto mem = sut.allocate(64);
+  auto blocker = sut.allocate(64);
+  std::memset(mem.ptr, 0x17, mem.length);
+
+  const auto ptr = mem.ptr;
+  EXPECT_TRUE(sut.reallocate(mem, 256));
+  EXPECT_NE(ptr, mem.ptr);
+  EXPECT_EQ(256u, mem.length);
+  EXPECT_EQ(0x17, static_cast<char *>(mem.ptr)[63]);
+
+  sut.deallocate(blocker);
+  this->deallocateAndCheckBlockIsThenEmpty(mem);
+  expectCompletelyMerged();
+}
+
+TEST_F(TlsfAllocatorTest, ThatRandomOperationsKeepTheBlocksDisjointAndMergeEverythingAtTheEnd)
+{
+  std::mt19937 random(4711);
+  std::uniform_int_distribution<size_t> size(1, 2000);
+  std::vector<alb::block> blocks(64);
+
+  for (int i = 0; i < 20000; ++i) {
+    auto &b = blocks[random() % blocks.size()];
+    const auto pattern = static_cast<unsigned char>(reinterpret_cast<uintptr_t>(&b) / sizeof(b));
+    if (b) {
+      for (size_t j = 0; j < b.length; ++j) {
+        ASSERT_EQ(pattern, static_cast<unsigned char *>(b.ptr)[j]);
+      }
+      if (random() % 2 == 0) {
+        sut.deallocate(b);
+        continue;
+      }
+      const auto oldLength = b.length;
+      if (sut.reallocate(b, size(random))) {
+        std::memset(static_cast<char *>(b.ptr) + std::min(oldLength, b.length), pattern,
+                    b.length - std::min(oldLength, b.length));
+      }
+    }
+    else {
+      b = sut.allocate(size(random));
+      if (b) {
+        std::memset(b.ptr, pattern, b.length);
+      }
+    }
+  }
+  for (auto &b : blocks) {
+    sut.deallocate(b);
+  }
+  expectCompletelyMerged();
+}
+
+TEST(TlsfAllocatorCompositionTest, ThatItComposesWithAFallbackAllocator)
+{
+  using Tlsf = alb::tlsf_allocator<alb::mallocator, AreaSize>;
+  alb::fallback_allocator<Tlsf, alb::mallocator> sut;
+  auto small = sut.allocate(100);
+  auto large = sut.allocate(2 * AreaSize);
+  ASSERT_NE(nullptr, large.ptr);
+  EXPECT_TRUE(static_cast<Tlsf &>(sut).owns(small));
+  EXPECT_FALSE(static_cast<Tlsf &>(sut).owns(large));
+  sut.deallocate(small);
+  sut.deallocate(large);
+}
@@ -0,0 +1,214 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#include <gtest/gtest.h>
+#include <alb/heap.hpp>
+#include <alb/mallocator.hpp>
+#include <alb/shared_heap.hpp>
+#include <alb/trace_recorder.hpp>
+#include <alb/trace_replay.hpp>
+
+#include <cstdio>
+#include <memory>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace {
+  const char *TraceFile = "alb_trace_recorder_test.trace";
+
+  std::vector<alb::trace_record> readTrace()
+  {
+    std::vector<alb::trace_record> result;
+    EXPECT_TRUE(alb::for_each_trace_record(
+      TraceFile, [&result](const alb::trace_record &r) { result.push_back(r); }));
+    return result;
+  }
+
+  // Allocates 64, 128 and 256 bytes, reallocates the first one and frees all
+  template <class Recorder>
+  void recordSimpleTrace(Recorder &sut)
+  {
+    ASSERT_TRUE(sut.open(TraceFile));
+    auto a = sut.allocate(64);
+    auto b = sut.allocate(128);
+    auto c = sut.allocate(256);
+    sut.reallocate(a, 512);
+    sut.deallocate(b);
+    sut.deallocate(a);
+    sut.deallocate(c);
+    sut.close();
+  }
+
+  // The shared heap hands the addresses, that a moving reallocation releases,
+  // immediately to the other threads. They get the chance to take them, before
+  // the reallocation returns.
+  class SlowlyReallocatingHeap : public alb::shared_heap<alb::mallocator, 256, 64> {
+  public:
+    bool reallocate(alb::block &b, size_t n) noexcept
+    {
+      const auto result = shared_heap::reallocate(b, n);
+      std::this_thread::yield();
+      return result;
+    }
+  };
+}
+
+class TraceRecorderTest : public ::testing::Test {
+protected:
+  void TearDown() override
+  {
+    ::remove(TraceFile);
+  }
+};
+
+TEST_F(TraceRecorderTest, ThatAllOperationsAreWrittenInOrder)
+{
+  auto sut = std::make_unique<alb::trace_recorder<alb::mallocator, 4>>();
+  recordSimpleTrace(*sut);
+
+  auto records = readTrace();
+  ASSERT_EQ(7u, records.size());
+  EXPECT_EQ(alb::trace_operation::allocate, records[0].op);
+  EXPECT_EQ(64u, records[0].size);
+  EXPECT_EQ(0u, records[0].block);
+  EXPECT_NE(0u, records[0].result);
+  EXPECT_EQ(alb::trace_operation::reallocate, records[3].op);
+  EXPECT_EQ(512u, records[3].size);
+  EXPECT_EQ(records[0].result, records[3].block);
+  EXPECT_EQ(alb::trace_operation::deallocate, records[4].op);
+  EXPECT_EQ(records[1].result, records[4].block);
+  EXPECT_EQ(records[3].result, records[5].block);
+  for (auto &r : records) {
+    EXPECT_EQ(1u, r.success);
+  }
+}
+
+TEST_F(TraceRecorderTest, ThatNothingIsRecordedWithoutAnOpenFile)
+{
+  auto sut = std::make_unique<alb::trace_recorder<alb::mallocator>>();
+  auto mem = sut->allocate(32);
+  sut->deallocate(mem);
+  EXPECT_EQ(0u, sut->number_of_written_records());
+  EXPECT_FALSE(alb::for_each_trace_record(TraceFile, [](const alb::trace_record &) {}));
+}
+
+TEST_F(TraceRecorderTest, ThatAReplayRepeatsAllOperations)
+{
+  auto recorder = std::make_unique<alb::trace_recorder<alb::mallocator>>();
+  recordSimpleTrace(*recorder);
+
+  auto heap = std::make_unique<alb::heap<alb::mallocator, 64, 64>>();
+  alb::replay_result result;
+  ASSERT_TRUE(alb::replay_trace(*heap, TraceFile, result));
+  EXPECT_EQ(7u, result.records);
+  EXPECT_EQ(3u, result.allocations);
+  EXPECT_EQ(3u, result.deallocations);
+  EXPECT_EQ(1u, result.reallocations);
+  EXPECT_EQ(0u, result.failures);
+  EXPECT_EQ(0u, result.unmatched);
+  EXPECT_EQ(1u, result.threads);
+  EXPECT_EQ(64u + 128 + 256 + 512 - 64, result.peak_requested_bytes);
+  EXPECT_EQ(result.peak_requested_bytes, result.peak_bytes);
+  EXPECT_LT(0u, result.allocator_ticks);
+}
+
+TEST_F(TraceRecorderTest, ThatFailuresOfTheReplayedAllocatorAreCounted)
+{
+  auto recorder = std::make_unique<alb::trace_recorder<alb::mallocator>>();
+  ASSERT_TRUE(recorder->open(TraceFile));
+  std::vector<alb::block> blocks;
+  for (int i = 0; i < 4; ++i) {
+    blocks.push_back(recorder->allocate(2048));
+  }
+  for (auto &b : blocks) {
+    recorder->deallocate(b);
+  }
+  recorder->close();
+
+  // 4096 bytes can only keep two of the blocks
+  auto heap = std::make_unique<alb::heap<alb::mallocator, 64, 64>>();
+  alb::replay_result result;
+  ASSERT_TRUE(alb::replay_trace(*heap, TraceFile, result));
+  EXPECT_EQ(2u, result.failures);
+  EXPECT_EQ(2u, result.unmatched);
+  EXPECT_EQ(4096u, result.peak_bytes);
+}
+
+TEST_F(TraceRecorderTest, ThatTheSharedRecorderTracesAllThreads)
+{
+  auto sut = std::make_unique<alb::shared_trace_recorder<alb::mallocator, 16>>();
+  ASSERT_TRUE(sut->open(TraceFile));
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&sut] {
+      for (int i = 0; i < 100; ++i) {
+        auto mem = sut->allocate(16 + i);
+        sut->deallocate(mem);
+      }
+    });
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+  sut->close();
+
+  alb::mallocator allocator;
+  alb::replay_result result;
+  ASSERT_TRUE(alb::replay_trace(allocator, TraceFile, result));
+  EXPECT_EQ(800u, result.records);
+  EXPECT_EQ(400u, result.allocations);
+  EXPECT_EQ(0u, result.unmatched);
+  EXPECT_EQ(4u, result.threads);
+}
+
+TEST_F(TraceRecorderTest, ThatMovingReallocationsAndReusedAddressesAreTracedConsistently)
+{
+  auto sut = std::make_unique<alb::shared_trace_recorder<SlowlyReallocatingHeap, 16>>();
+  ASSERT_TRUE(sut->open(TraceFile));
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&sut] {
+      for (int i = 0; i < 500; ++i) {
+        auto a = sut->allocate(64);
+        auto b = sut->allocate(64);
+        sut->reallocate(a, 256);
+        sut->deallocate(b);
+        sut->deallocate(a);
+      }
+    });
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+  sut->close();
+
+  // Each block id must be released before it is handed out again
+  std::set<uint64_t> live;
+  for (auto &r : readTrace()) {
+    if (!r.success) {
+      continue;
+    }
+    if (r.block != 0) {
+      ASSERT_EQ(1u, live.erase(r.block));
+    }
+    if (r.result != 0) {
+      ASSERT_TRUE(live.insert(r.result).second);
+    }
+  }
+  EXPECT_TRUE(live.empty());
+
+  alb::mallocator allocator;
+  alb::replay_result result;
+  ASSERT_TRUE(alb::replay_trace(allocator, TraceFile, result));
+  EXPECT_EQ(10000u, result.records);
+  EXPECT_EQ(2000u, result.reallocations);
+  EXPECT_EQ(0u, result.failures);
+  EXPECT_EQ(0u, result.unmatched);
+}
@@ -0,0 +1,115 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+
+// alb-compose plans a composition of segregators, bucketizers, freelists and
+// heaps for a size profile and writes it as header, that defines the type
+// alb_replay::composition, with the predicted slack and footprint. The profile
+// is a trace of an alb::trace_recorder or a text histogram with the lines
+// "size requests [peak_live]". The header can be evaluated directly against
+// the trace with alb-replay, e.g.
+//
+//   alb-compose --trace app.trace > composition.hpp
+//   cmake -DALB_REPLAY_COMPOSITION=$PWD/composition.hpp .. && make alb-replay
+//   alb-replay app.trace
+
+#include <alb/composition_generator.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+  void print_usage(const char *program)
+  {
+    fprintf(stderr,
+            "usage: %s (--trace <file> | --histogram <file>)... [--small-limit <n>] "
+            "[--heap-limit <n>] [--levels <n>] [--buckets <n>] [--granularity <n>] "
+            "[--bucket-overhead <n>] [--chunk-overhead <n>] [--namespace <name>] "
+            "[--name <name>]\n"
+            "  --trace            a trace of an alb::trace_recorder\n"
+            "  --histogram        lines \"size requests [peak_live]\"\n"
+            "  --small-limit      largest size of the freelists (default 4096)\n"
+            "  --heap-limit       largest size of the heaps (default 1048576)\n"
+            "  --levels           maximum number of bucketizers (default 6)\n"
+            "  --buckets          maximum number of buckets per bucketizer (default 16)\n"
+            "  --granularity      the bucket edges are a multiple of it (default 8)\n"
+            "  --bucket-overhead  costs of a bucket in bytes (default 256)\n"
+            "  --chunk-overhead   costs of a heap chunk in bytes (default 16)\n"
+            "  --namespace        namespace of the type (default alb_replay)\n"
+            "  --name             name of the type (default composition)\n",
+            program);
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  alb::size_profile profile;
+  alb::composition_options options;
+  const char *nameSpace = "alb_replay";
+  const char *name = "composition";
+  const char *source = nullptr;
+
+  for (int i = 1; i < argc; ++i) {
+    if (i + 1 == argc) {
+      print_usage(argv[0]);
+      return 1;
+    }
+    const char *option = argv[i];
+    const char *value = argv[++i];
+    const auto number = static_cast<size_t>(strtoull(value, nullptr, 10));
+    if (strcmp(option, "--trace") == 0 || strcmp(option, "--histogram") == 0) {
+      const bool read = option[2] == 't' ? profile.add_trace(value) : profile.add_histogram(value);
+      if (!read) {
+        fprintf(stderr, "%s: cannot read %s\n", argv[0], value);
+        return 1;
+      }
+      source = value;
+    }
+    else if (strcmp(option, "--small-limit") == 0 && number > 0) {
+      options.small_limit = number;
+    }
+    else if (strcmp(option, "--heap-limit") == 0) {
+      options.heap_limit = number;
+    }
+    else if (strcmp(option, "--levels") == 0 && number > 0) {
+      options.max_levels = static_cast<unsigned>(number);
+    }
+    else if (strcmp(option, "--buckets") == 0 && number > 0) {
+      options.max_buckets = static_cast<unsigned>(number);
+    }
+    else if (strcmp(option, "--granularity") == 0 && number > 0) {
+      options.granularity = static_cast<unsigned>(number);
+    }
+    else if (strcmp(option, "--bucket-overhead") == 0) {
+      options.bucket_overhead = number;
+    }
+    else if (strcmp(option, "--chunk-overhead") == 0) {
+      options.chunk_overhead = number;
+    }
+    else if (strcmp(option, "--namespace") == 0) {
+      nameSpace = value;
+    }
+    else if (strcmp(option, "--name") == 0) {
+      name = value;
+    }
+    else {
+      print_usage(argv[0]);
+      return 1;
+    }
+  }
+  if (!source) {
+    print_usage(argv[0]);
+    return 1;
+  }
+
+  const auto plan = alb::plan_composition(profile, options);
+  alb::write_composition_header(stdout, plan, source, nameSpace, name);
+  return 0;
+}
@@ -0,0 +1,65 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+
+// alb-replay replays an allocation trace, that was recorded by an
+// alb::trace_recorder, against the composition that was selected at compile
+// time, see replay_composition.hpp, and reports the time, the peak footprint
+// and the number of failed operations.
+//
+// Usage: alb-replay <trace file> [repetitions]
+
+#if defined(ALB_REPLAY_COMPOSITION_HEADER)
+#include ALB_REPLAY_COMPOSITION_HEADER
+#else
+#include "replay_composition.hpp"
+#endif
+
+#include <alb/trace_replay.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+int main(int argc, char *argv[])
+{
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s <trace file> [repetitions]\n", argv[0]);
+    return 1;
+  }
+  const auto repetitions = argc > 2 ? std::max(1, atoi(argv[2])) : 1;
+
+  alb::replay_result best;
+  for (int i = 0; i < repetitions; ++i) {
+    // Some allocators, e.g. the stack_allocator, cannot be created on the heap
+    alb_replay::composition allocator;
+    alb::replay_result result;
+    if (!alb::replay_trace(allocator, argv[1], result)) {
+      fprintf(stderr, "%s: cannot read the trace %s\n", argv[0], argv[1]);
+      return 1;
+    }
+    if (i == 0 || result.seconds < best.seconds) {
+      best = result;
+    }
+  }
+
+  printf("records              %zu\n", best.records);
+  printf("threads              %zu\n", best.threads);
+  printf("allocations          %zu\n", best.allocations);
+  printf("deallocations        %zu\n", best.deallocations);
+  printf("reallocations        %zu\n", best.reallocations);
+  printf("expansions           %zu\n", best.expansions);
+  printf("failures             %zu\n", best.failures);
+  printf("unmatched            %zu\n", best.unmatched);
+  printf("peak_bytes           %zu\n", best.peak_bytes);
+  printf("peak_requested_bytes %zu\n", best.peak_requested_bytes);
+  printf("seconds              %.6f\n", best.seconds);
+  printf("allocator_ticks      %llu\n", static_cast<unsigned long long>(best.allocator_ticks));
+  return best.failures == 0 ? 0 : 2;
+}
@@ -0,0 +1,149 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+
+// alb-top attaches to the shared memory segment of a running process, in which
+// all alb::allocator_with_stats with the option SharedMemoryCounters place
+// their counters, and displays them periodically.
+//
+// Usage: alb-top <pid> [interval in ms] [number of updates]
+
+#include <alb/internal/shm_stats.hpp>
+#include <alb/internal/stats_fields.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+  using alb::internal::shm_stats::number_of_counters;
+
+  enum field : unsigned {
+#define ALB_FIELD_INDEX(name, isCounter) name,
+    ALB_STATS_SNAPSHOT_FIELDS(ALB_FIELD_INDEX)
+#undef ALB_FIELD_INDEX
+  };
+
+  struct node {
+    std::string name;
+    uint64_t counters[number_of_counters];
+    uint64_t highTide;
+  };
+
+  std::vector<node> read_nodes(const alb::internal::shm_stats::reader &reader)
+  {
+    std::vector<node> result;
+    reader.for_each_slot([&result](const char *name, const uint64_t *counters, uint64_t highTide) {
+      node n;
+      n.name = name;
+      std::copy(counters, counters + number_of_counters, n.counters);
+      n.highTide = highTide;
+      result.push_back(n);
+    });
+    return result;
+  }
+
+  const node *find(const std::vector<node> &nodes, const std::string &name)
+  {
+    for (auto &n : nodes) {
+      if (n.name == name) {
+        return &n;
+      }
+    }
+    return nullptr;
+  }
+
+  /**
+   * The hit ratio of a node with a ".../parent" node, e.g. a freelist, is the
+   * share of allocations that did not reach the parent. Otherwise it is the
+   * share of successful allocations, e.g. of the primary of a fallback_allocator.
+   */
+  double hit_ratio(const std::vector<node> &nodes, const node &n)
+  {
+    const auto requests = n.counters[num_allocate];
+    if (requests == 0) {
+      return 0.0;
+    }
+    if (auto parent = find(nodes, n.name + "/parent")) {
+      const auto misses = std::min(parent->counters[num_allocate], requests);
+      return 100.0 * (requests - misses) / requests;
+    }
+    return 100.0 * n.counters[num_allocate_ok] / requests;
+  }
+
+  double rate(uint64_t now, uint64_t before, double seconds)
+  {
+    return now >= before ? (now - before) / seconds : 0.0;
+  }
+
+  void print(const std::vector<node> &now, const std::vector<node> &before, double seconds,
+             long pid)
+  {
+    if (::isatty(STDOUT_FILENO)) {
+      std::printf("\033[H\033[2J");
+    }
+    std::printf("alb-top - process %ld - %zu allocators\n\n", pid, now.size());
+    std::printf("%-40s %12s %12s %14s %14s %7s\n", "allocator", "alloc/s", "free/s", "live bytes",
+                "high tide", "hit %");
+    for (auto &n : now) {
+      auto previous = find(before, n.name);
+      const auto allocations =
+        previous ? rate(n.counters[num_allocate], previous->counters[num_allocate], seconds) : 0.0;
+      const auto deallocations =
+        previous ? rate(n.counters[num_deallocate], previous->counters[num_deallocate], seconds)
+                 : 0.0;
+      const auto allocated = n.counters[bytes_allocated];
+      const auto deallocated = n.counters[bytes_deallocated];
+      std::printf("%-40s %12.0f %12.0f %14llu %14llu %6.1f%%\n", n.name.c_str(), allocations,
+                  deallocations,
+                  static_cast<unsigned long long>(allocated > deallocated ? allocated - deallocated
+                                                                          : 0),
+                  static_cast<unsigned long long>(n.highTide), hit_ratio(now, n));
+    }
+    std::printf("\n");
+    std::fflush(stdout);
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  if (argc < 2) {
+    std::fprintf(stderr, "Usage: %s <pid> [interval in ms] [number of updates]\n", argv[0]);
+    return 1;
+  }
+  const long pid = std::strtol(argv[1], nullptr, 10);
+  const long interval = argc > 2 ? std::strtol(argv[2], nullptr, 10) : 1000;
+  const long updates = argc > 3 ? std::strtol(argv[3], nullptr, 10) : 0;
+
+  alb::internal::shm_stats::reader reader;
+  if (!reader.open(pid)) {
+    std::fprintf(stderr, "No allocator statistics found for process %ld\n", pid);
+    return 1;
+  }
+
+  auto before = read_nodes(reader);
+  auto lastTime = std::chrono::steady_clock::now();
+  for (long i = 0; updates == 0 || i < updates; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(interval));
+    auto now = read_nodes(reader);
+    const auto currentTime = std::chrono::steady_clock::now();
+    print(now, before,
+          std::chrono::duration_cast<std::chrono::duration<double>>(currentTime - lastTime).count(),
+          pid);
+    before = std::move(now);
+    lastTime = currentTime;
+  }
+  return 0;
+}
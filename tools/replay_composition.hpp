@@ -0,0 +1,35 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#pragma once
+
+// The composition that alb-replay evaluates. An other composition is selected
+// at configuration time with a header, that defines the type
+// alb_replay::composition, e.g.
+//
+//   cmake -DALB_REPLAY_COMPOSITION=/path/to/my_composition.hpp ..
+
+#include <alb/bucketizer.hpp>
+#include <alb/cascading_allocator.hpp>
+#include <alb/freelist.hpp>
+#include <alb/heap.hpp>
+#include <alb/mallocator.hpp>
+#include <alb/segregator.hpp>
+
+namespace alb_replay {
+  using FList = alb::freelist<alb::mallocator, alb::internal::DynasticDynamicSet,
+                              alb::internal::DynasticDynamicSet>;
+
+  using composition = alb::segregator<
+    128, alb::bucketizer<FList, 1, 128, 16>,
+    alb::segregator<1024, alb::bucketizer<FList, 129, 1024, 128>,
+                    alb::segregator<4096 * 1024,
+                                    alb::cascading_allocator<alb::heap<alb::mallocator, 1024, 4096>>,
+                                    alb::mallocator>>>;
+}